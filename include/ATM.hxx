@@ -1,31 +1,34 @@
 #ifndef ATM_HXX
 #define ATM_HXX
 
+#include "Account.hxx"
 #include "Bank.hxx"
+#include "DisplayPolicy.hxx"
+#include "LatencyHistogram.hxx"
+#include "RequestTrace.hxx"
+#include "Trace.hxx"
+#include "UserRequest.hxx"
 
 #include <string>
 
-class BaseDisplay;
-class Account;
-
-// C++11 enum class
-enum class UserRequest {
-    REQUEST_INVALID = 0,
-    REQUEST_BALANCE = 1,
-    REQUEST_DEPOSIT,
-    REQUEST_WITHDRAW,
-    REQUEST_TRANSACTIONS,
-};
-
-class ATM
+// C++11/14: class template parameterized by the display policy.
+// Use BasicATM<StaticDisplayPolicy<MyDisplay>> to bind a concrete display at
+// compile time; ATM keeps the virtual BaseDisplay interface.
+template <typename DisplayPolicy>
+class BasicATM
 {
     public:
 
+        using display_type = typename DisplayPolicy::display_type;
 
-        ATM(Bank* bank, BaseDisplay* display);
-        void viewAccount(int accountNumber, std::string password);
+        BasicATM(Bank* bank, display_type* display);
+        void viewAccount(int accountNumber, const std::string& password);
         void fillUserRequest(UserRequest request, double amount);
 
+        // Logs every call from here on as a new session of the trace;
+        // nullptr stops recording
+        void setRecorder(RequestTraceWriter* recorder);
+
     private:
 
         void showBalance();
@@ -35,8 +38,117 @@ class ATM
 
        	Account* myCurrentAccount;
         Bank* myBank;
-        BaseDisplay* myDisplay;
+        DisplayPolicy myDisplay;
+        RequestTraceWriter* myRecorder;
+        std::uint32_t mySession;
 
 };
 
+using ATM = BasicATM<PolymorphicDisplayPolicy>;
+
+template <typename DisplayPolicy>
+BasicATM<DisplayPolicy>::BasicATM(Bank* bank, display_type* display):
+    myCurrentAccount(nullptr),
+    myBank(bank),
+    myDisplay(display),
+    myRecorder(nullptr),
+    mySession(0)
+{
+}
+
+template <typename DisplayPolicy>
+void BasicATM<DisplayPolicy>::setRecorder(RequestTraceWriter* recorder)
+{
+    myRecorder = recorder;
+    if (myRecorder)
+    {
+        mySession = myRecorder->openSession();
+    }
+}
+
+template <typename DisplayPolicy>
+void BasicATM<DisplayPolicy>::viewAccount(int accountNumber, const std::string& password)
+{
+    ATM_LATENCY_SCOPE(LatencyKind::VIEW_ACCOUNT);
+    ATM_TRACE_SPAN("ATM::viewAccount");
+    if (myRecorder)
+    {
+        myRecorder->recordViewAccount(mySession, accountNumber);
+    }
+    if ( !(myCurrentAccount = myBank->getAccount(accountNumber, password)) )
+    {
+        myDisplay.showInfoToUser("Invalid account");
+    }
+    ATM_TRACE_SPAN("display::commit");
+    myDisplay.commit();
+}
+
+template <typename DisplayPolicy>
+void BasicATM<DisplayPolicy>::fillUserRequest(UserRequest request, double amount)
+{
+    ATM_LATENCY_SCOPE(latencyKindFor(request));
+    ATM_TRACE_SPAN("ATM::fillUserRequest");
+    if (myRecorder)
+    {
+        myRecorder->recordRequest(mySession, request, amount);
+    }
+    if (myCurrentAccount)
+        switch (request)
+        {
+            case UserRequest::REQUEST_BALANCE:
+                showBalance(); break;
+            case UserRequest::REQUEST_DEPOSIT:
+                makeDeposit(amount); break;
+            case UserRequest::REQUEST_WITHDRAW:
+                withdraw(amount); break;
+            case UserRequest::REQUEST_TRANSACTIONS:
+                showTransations(); break;
+            case UserRequest::REQUEST_INVALID:
+            case UserRequest::REQUEST_CARRY_FORWARD:    // ledger only, never requested
+                break;
+        }
+    ATM_TRACE_SPAN("display::commit");
+    myDisplay.commit();
+}
+
+template <typename DisplayPolicy>
+void BasicATM<DisplayPolicy>::showBalance()
+{
+    double bal = myCurrentAccount->recordBalanceInquiry();
+    ATM_TRACE_SPAN("display");
+    myDisplay.showInfoToUser("Current Balance");
+    myDisplay.showBalance(bal);
+}
+
+template <typename DisplayPolicy>
+void BasicATM<DisplayPolicy>::showTransations()
+{
+    ATM_TRACE_SPAN("display");
+    myCurrentAccount->withTransactions([this] (const TransactionView& transactions)
+    {
+        myDisplay.showTransactions(transactions);
+    });
+}
+
+template <typename DisplayPolicy>
+void BasicATM<DisplayPolicy>::makeDeposit(double amount)
+{
+    auto bal = myCurrentAccount->deposit(amount);
+    ATM_TRACE_SPAN("display");
+    myDisplay.showInfoToUser("Updated Balance");
+    myDisplay.showBalance(bal);
+}
+
+template <typename DisplayPolicy>
+void BasicATM<DisplayPolicy>::withdraw(double amount)
+{
+    auto bal = myCurrentAccount->deposit(amount * -1.0);
+    ATM_TRACE_SPAN("display");
+    myDisplay.showInfoToUser("Updated Balance");
+    myDisplay.showBalance(bal);
+}
+
+// C++11: the polymorphic instantiation is compiled once, in ATM.cxx
+extern template class BasicATM<PolymorphicDisplayPolicy>;
+
 #endif // ATM_HXX
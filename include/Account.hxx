@@ -2,14 +2,24 @@
 #define ACCOUNT_HXX
 
 #include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
 #include <string>
 #include <tuple>
 #include <vector>
 #include <functional>
 #include <utility>
 //added comment
-#include "ATM.hxx"
+#include "PostingSink.hxx"
+#include "TransactionView.hxx"
+#include "UserRequest.hxx"
 
+class BaseDisplay;
+class MemoryTracker;
+
+// Accounts are safe to share between threads: every public member that
+// touches the balance, ledger or password takes the account's mutex.
 class Account
 {
     public:
@@ -22,9 +32,26 @@ class Account
 
         explicit Account(double initial);
 
+        ~Account();
+
+        // Pure read: balance inquiries are logged with recordBalanceInquiry()
         auto getBalance() const
         {
-            myTransactions.emplace_back(UserRequest::REQUEST_BALANCE, myBalance);
+            std::lock_guard<std::mutex> lock(myMutex);
+            return (myBalance);
+        }
+
+        double recordBalanceInquiry()
+        {
+            const LedgerTime time = now();
+            std::lock_guard<std::mutex> lock(myMutex);
+            appendEntry(UserRequest::REQUEST_BALANCE, myBalance, time);
+            PostingSink* sink = mySink.load(std::memory_order_acquire);
+            if (sink)
+            {
+                sink->onBalanceInquiry(myAccountNumber, myBalance, myTimes.back());
+            }
+            reportMemory();
 
             return (myBalance);
         }
@@ -42,28 +69,277 @@ class Account
 
         void setPassword(const char* password)
         {
+            std::lock_guard<std::mutex> lock(myMutex);
             myPassword = password;
+            PostingSink* sink = mySink.load(std::memory_order_acquire);
+            if (sink)
+            {
+                sink->onPasswordChanged(myAccountNumber, myPassword);
+            }
+            reportMemory();
         }
 
+        // Not synchronized with setPassword(); use checkPassword() when
+        // the password may change concurrently
         const char* getPassword()
         {
             return (myPassword.data());
         }   
+
+        bool checkPassword(const std::string& password) const
+        {
+            std::lock_guard<std::mutex> lock(myMutex);
+            return (password == myPassword);
+        }
  
         double deposit(double amount);
         
         double debit(double amount);
 
+        // Moves `amount` to another account as one atomic step: a withdrawal
+        // here and a deposit there. Returns this account's new balance.
+        double transferTo(Account& to, double amount);
+
+        // Batch jobs: appends `count` entries under one lock, applying
+        // deposits and withdrawals to the balance in order. Returns the new
+        // balance.
+        double appendPostings(const Transaction* entries, std::size_t count);
+
+        // As above, with the time of each entry instead of the clock, e.g.
+        // when replaying or importing history
+        double appendPostings(const Transaction* entries, const LedgerTime* times, std::size_t count);
+
+        // Reads the balance and posts `adjust(balance)` against it under
+        // one lock: a deposit if positive, a withdrawal of its magnitude if
+        // negative, nothing if zero. Returns the amount posted.
+        template <typename F>
+        double postAdjustment(LedgerTime time, F adjust)
+        {
+            std::lock_guard<std::mutex> lock(myMutex);
+            const double amount = adjust(myBalance);
+            if (amount > 0.0)
+            {
+                appendEntry(UserRequest::REQUEST_DEPOSIT, amount, time);
+                myBalance += amount;
+                notify(UserRequest::REQUEST_DEPOSIT, amount);
+            }
+            else if (amount < 0.0)
+            {
+                appendEntry(UserRequest::REQUEST_WITHDRAW, -amount, time);
+                myBalance -= -amount;
+                notify(UserRequest::REQUEST_WITHDRAW, -amount);
+            }
+            reportMemory();
+            return (amount);
+        }
+
+        // Replaces balance and ledger wholesale, e.g. when loading a saved
+        // bank. Entries without a time in `times` get time 0.
+        void restore(double balance, std::vector<Transaction> transactions,
+                     std::vector<LedgerTime> times = std::vector<LedgerTime>());
+
+        // Pre-sizes the ledger so the next `count` postings do not allocate
+        void reserveTransactions(std::size_t count)
+        {
+            std::lock_guard<std::mutex> lock(myMutex);
+            myTransactions.reserve(myTransactions.size() + count);
+            myTimes.reserve(myTimes.size() + count);
+            myTimeBlocks.reserve((myTransactions.capacity() + TIME_BLOCK - 1) / TIME_BLOCK);
+            reportMemory();
+        }
+
+        // Gives back ledger capacity beyond the entries held. Returns the
+        // bytes freed.
+        std::size_t compactLedger();
+
+        // Keeps the newest `keep` entries and replaces the older ones with
+        // one REQUEST_CARRY_FORWARD entry of what they add up to, at the
+        // time of the last of them. The balance and the ledger's running
+        // total are unchanged. When set, `spill` is first handed the
+        // entries to be dropped, less any carry-forward from an earlier
+        // trim; if it returns false nothing is trimmed. `spill` runs
+        // without the account locked, on a copy of the entries; a trim
+        // already under way makes this one return 0. Returns the entries
+        // dropped, not counting that carry-forward.
+        std::size_t trimLedger(std::size_t keep,
+            const std::function<bool(const TransactionView&)>& spill = nullptr);
+
+        // The account stays locked while `t` runs; it must not call back
+        // into this account
         template <typename T>
         void forEachTransaction(T t)
         {
+            std::lock_guard<std::mutex> lock(myMutex);
             std::for_each(myTransactions.begin(), myTransactions.end(), t);
         }
 
+        // Entries posted within `period` only, found through the time index
+        template <typename T>
+        void forEachTransaction(const TimeRange& period, T t)
+        {
+            std::lock_guard<std::mutex> lock(myMutex);
+            const std::pair<std::size_t, std::size_t> range = entryRange(period, 0);
+            std::for_each(myTransactions.begin() + range.first, myTransactions.begin() + range.second, t);
+        }
+
+        template <typename T>
+        void withTransactions(T t) const
+        {
+            std::lock_guard<std::mutex> lock(myMutex);
+            t(ledger());
+        }
+
+        // t(first, entries): the entries posted within `period`, where
+        // `first` is the ledger position of the first of them
+        template <typename T>
+        void withTransactions(const TimeRange& period, T t) const
+        {
+            std::lock_guard<std::mutex> lock(myMutex);
+            const std::pair<std::size_t, std::size_t> range = entryRange(period, 0);
+            t(range.first + positionOffset(), ledger().subview(range.first, range.second - range.first));
+        }
+
+        // Balance and ledger read together, under one lock
+        template <typename T>
+        void withLedger(T t) const
+        {
+            std::lock_guard<std::mutex> lock(myMutex);
+            t(myBalance, ledger());
+        }
+
+        // t(opening, first, entries) for the entries at or after ledger
+        // position `from` that were posted within `period`. `opening` is
+        // the ledger folded from the start up to `first`, the position of
+        // the first of them. Costs two binary searches and at most one
+        // index block of folding, however long the ledger.
+        template <typename T>
+        void withPeriod(std::size_t from, const TimeRange& period, T t) const
+        {
+            std::lock_guard<std::mutex> lock(myMutex);
+            const std::pair<std::size_t, std::size_t> range = entryRange(period, from);
+            t(balanceBefore(range.first), range.first + positionOffset(),
+              ledger().subview(range.first, range.second - range.first));
+        }
+
+        template <typename T>
+        void withPeriod(const TimeRange& period, T t) const
+        {
+            withPeriod(0, period, t);
+        }
+
+        // Ledger positions count every entry the account has posted, so
+        // they stay put when trimLedger() drops old entries. Positions
+        // below this one were trimmed away; views start at the
+        // carry-forward that replaced them, if any.
+        std::size_t trimmedBefore() const
+        {
+            return (myTrimmedBefore.load(std::memory_order_relaxed));
+        }
+
+        // Unsynchronized view; only valid while no other thread posts to
+        // this account. Prefer withTransactions() on shared accounts.
+        TransactionView transactions() const
+        {
+            return (ledger());
+        }
 
         int listTransactions(BaseDisplay&, UserRequest type);
+
+        int listTransactions(BaseDisplay&, UserRequest type, const TimeRange& period);
+
+        // Every later posting is also passed to `sink`; nullptr detaches
+        void setPostingSink(PostingSink* sink)
+        {
+            mySink.store(sink, std::memory_order_release);
+        }
+
+        // Changes to the memory this account holds are reported to
+        // `tracker` from now on; nullptr detaches
+        void setMemoryTracker(MemoryTracker* tracker);
+
+        // Ledger times come from this clock, read once per posting before
+        // the account is locked. Tests install a fake; nullptr restores
+        // the wall clock.
+        using Clock = LedgerTime (*)();
+        static void setClock(Clock clock);
+        static LedgerTime now();
+
+        // Ledger entries per time index block
+        static const std::size_t TIME_BLOCK = 64;
+
     private:
 
+        // Sparse time index: one block per TIME_BLOCK ledger entries, with
+        // the block's first and last entry times (times never decrease, so
+        // these are its min and max) and the ledger folded up to the block
+        struct TimeBlock
+        {
+            LedgerTime first;
+            LedgerTime last;
+            double opening;
+        };
+
+        // Appends one entry to the ledger and the index. A time earlier
+        // than the previous entry's is raised to it. Caller holds the lock.
+        void appendEntry(UserRequest type, double amount, LedgerTime time);
+
+        void rebuildTimeIndex();
+
+        // First ledger position whose time is not before `time`
+        std::size_t lowerBound(LedgerTime time) const;
+
+        // Indexes [first, second) into myTransactions of the entries at or
+        // after ledger position `from` within `period`; never the
+        // carry-forward
+        std::pair<std::size_t, std::size_t> entryRange(const TimeRange& period, std::size_t from) const;
+
+        // 1 if the ledger starts with a carry-forward
+        std::size_t carried() const
+        {
+            return ((!myTransactions.empty()
+                     && (std::get<0>(myTransactions[0]) == UserRequest::REQUEST_CARRY_FORWARD)) ? 1 : 0);
+        }
+
+        // Ledger position of myTransactions[0]
+        std::size_t positionOffset() const
+        {
+            return (myTrimmedBefore.load(std::memory_order_relaxed) - carried());
+        }
+
+        // Deposits less withdrawals over the entries before `index`
+        double balanceBefore(std::size_t index) const;
+
+        // Heap held by the ledger and password, as last told to the tracker
+        struct Footprint
+        {
+            std::size_t ledgerBytes;
+            std::size_t usedBytes;
+            std::size_t entries;
+            std::size_t credentialBytes;
+        };
+
+        Footprint footprint() const;
+
+        // Passes changes in footprint() to the tracker. Caller holds the lock.
+        void reportMemory();
+        void detachMemory();
+
+        int listEntries(BaseDisplay& display, UserRequest type, std::size_t first, std::size_t last);
+
+        TransactionView ledger() const
+        {
+            return (TransactionView(myTransactions.data(), myTransactions.size(), myTimes.data()));
+        }
+
+        void notify(UserRequest type, double amount)
+        {
+            PostingSink* sink = mySink.load(std::memory_order_acquire);
+            if (sink)
+            {
+                sink->onPosting(Posting{myAccountNumber, type, amount, myBalance, myTimes.back()});
+            }
+        }
+
         // C++11/14: deleted special functions:
         Account(const Account&) = delete;
         Account& operator=(const Account&) = delete;
@@ -72,7 +348,20 @@ class Account
         double myBalance = 0;
         std::string myPassword;
 
-        mutable std::vector<std::tuple<UserRequest, double>> myTransactions;
+        std::vector<Transaction> myTransactions;
+        std::vector<LedgerTime> myTimes;    // parallel to myTransactions
+        std::vector<TimeBlock> myTimeBlocks;
+        double myFold = 0.0;                // balanceBefore(myTransactions.size())
+        bool myTrimming = false;            // trimLedger() is spilling
+        std::size_t myRestores = 0;         // restore() calls, seen across a spill
+        std::atomic<std::size_t> myTrimmedBefore{0};    // written under the lock
+
+        static std::atomic<Clock> theClock;
+
+        mutable std::mutex myMutex;
+        std::atomic<PostingSink*> mySink{nullptr};
+        MemoryTracker* myTracker = nullptr;
+        Footprint myReported = {};
 };
 
 #endif // ACCOUNT_HXX
@@ -0,0 +1,131 @@
+#ifndef ANOMALY_DETECTOR_HXX
+#define ANOMALY_DETECTOR_HXX
+
+#include "PostingSink.hxx"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+enum class AnomalyKind
+{
+    RAPID_WITHDRAWALS,      // withdrawalBurst outflows within window
+    HIGH_VELOCITY,          // more than maxPostingsPerWindow postings in window
+    UNUSUAL_AMOUNT,         // amount far above the account's running average
+};
+
+struct Anomaly
+{
+    AnomalyKind kind;
+    Posting posting;        // the posting that triggered it
+    double observed;        // count, postings per window or amount ratio
+};
+
+// Per-account statistics; all amounts are magnitudes
+struct AccountActivity
+{
+    std::uint64_t postings = 0;
+    std::uint64_t lastSeenNs = 0;
+    double ewmaAmount = 0.0;
+    double windowPostings = 0.0;    // sliding-window estimate
+    double windowOutflow = 0.0;     // sliding-window estimate
+};
+
+// Streaming anomaly detection stage. Attach with Bank::setPostingSink().
+//
+// State is fixed-size per account and lives in a two-level table indexed
+// by account number: pages of accounts are allocated on first use and
+// published with a compare-and-swap, so the posting path takes no locks.
+// Sliding windows are estimated from the current and previous fixed
+// window (weighted by overlap); rapid withdrawals are checked exactly
+// against the times of the last withdrawalBurst outflows. Postings are
+// timed by their ledger entry, so the posting path reads no clock. An ATM
+// withdrawal arrives as a negative deposit and counts as an outflow.
+class AnomalyDetector final : public PostingSink
+{
+    public:
+
+        static const int MAX_BURST = 8;
+
+        struct Config
+        {
+            std::uint64_t windowNs = 60000000000ULL;    // one minute
+            int withdrawalBurst = 3;                    // 2..MAX_BURST
+            double maxPostingsPerWindow = 20.0;
+            double amountFactor = 10.0;                 // times the EWMA
+            std::uint64_t warmupPostings = 5;           // before UNUSUAL_AMOUNT
+            double ewmaAlpha = 0.1;
+
+            // Nanosecond clock activity() ages windows by, on the ledger's
+            // time base; Account::now() when null. Postings are placed by
+            // their ledger time, not by this clock.
+            std::uint64_t (*clock)() = nullptr;
+        };
+
+        using Callback = std::function<void(const Anomaly&)>;
+
+        AnomalyDetector(const Config& config, Callback callback);
+        ~AnomalyDetector() noexcept;
+
+        void onPosting(const Posting& posting) noexcept override;
+
+        // Safe to call while the account posts; fields are then read one
+        // at a time and may straddle a posting
+        AccountActivity activity(int account) const;
+
+        std::uint64_t anomalies() const { return (myAnomalies.load(std::memory_order_relaxed)); }
+
+    private:
+
+        static const int PAGE_BITS = 10;
+        static const std::size_t PAGE_SIZE = std::size_t(1) << PAGE_BITS;
+        static const std::size_t PAGE_COUNT = std::size_t(1) << 16;
+
+        // Current and previous fixed window
+        struct Window
+        {
+            std::uint64_t start;
+            double postingsNow;
+            double postingsBefore;
+            double outflowNow;
+            double outflowBefore;
+        };
+
+        // Postings to one account arrive one at a time (under its lock),
+        // but activity() reads from any thread: what it reads is relaxed
+        // atomics, written once per posting. The burst ring is only
+        // touched by postings.
+        struct State
+        {
+            std::atomic<std::uint64_t> postings;
+            std::atomic<std::uint64_t> lastSeen;
+            std::atomic<double> ewma;
+            std::atomic<std::uint64_t> windowStart;
+            std::atomic<double> postingsNow;
+            std::atomic<double> postingsBefore;
+            std::atomic<double> outflowNow;
+            std::atomic<double> outflowBefore;
+            std::uint64_t outflowTimes[MAX_BURST];
+            std::uint32_t outflowHead;
+        };
+
+        AnomalyDetector(const AnomalyDetector&) = delete;
+        AnomalyDetector& operator=(const AnomalyDetector&) = delete;
+
+        State* stateFor(int account) noexcept;
+        const State* findState(int account) const noexcept;
+        static Window loadWindow(const State& state) noexcept;
+        static void storeWindow(State& state, const Window& window) noexcept;
+        void advanceWindow(Window& window, std::uint64_t now) const noexcept;
+        double windowed(const Window& window, double now, double before, std::uint64_t time) const noexcept;
+        void raise(AnomalyKind kind, const Posting& posting, double observed) noexcept;
+
+        Config myConfig;
+        double myInverseWindow;
+        Callback myCallback;
+        std::atomic<State*>* myPages;
+        std::atomic<std::uint64_t> myAnomalies;
+};
+
+#endif // ANOMALY_DETECTOR_HXX
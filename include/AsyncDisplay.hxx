@@ -0,0 +1,103 @@
+#ifndef ASYNC_DISPLAY_HXX
+#define ASYNC_DISPLAY_HXX
+
+#include "BaseDisplay.hxx"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Display that moves formatting and I/O off the calling thread.
+//
+// Every call is turned into a compact 64-byte record and pushed into a
+// bounded lock-free multi-producer ring; a background thread pops the
+// records and replays them on the backend display. Known ATM messages travel
+// as message ids, other text is copied inline. Info text longer than one
+// record takes several consecutive records, claimed at once so that other
+// producers cannot interleave with it, and reaches the backend whole; it is
+// cut at what the ring can hold. Error text is truncated to TEXT_CAPACITY
+// characters.
+//
+// When the ring is full the overflow policy either makes the caller wait
+// (BLOCK) or discards the record and counts it (DROP_NEWEST), so memory is
+// bounded in both cases. shutdown(), also run by the destructor, writes out
+// every record accepted before it and commits the backend; calls that race
+// with it are either written out or counted in dropped().
+class AsyncDisplay : public BaseDisplay
+{
+    public:
+
+        enum OverflowPolicy {BLOCK, DROP_NEWEST};
+
+        static const std::size_t DEFAULT_CAPACITY = 4096;
+        static const std::size_t TEXT_CAPACITY = 44;
+
+        explicit AsyncDisplay(BaseDisplay& backend,
+                              std::size_t capacity = DEFAULT_CAPACITY,
+                              OverflowPolicy policy = BLOCK);
+        ~AsyncDisplay() noexcept;
+
+        void showInfoToUser(const char* message) override;
+        void showBalance(double balance) override;
+        void showTransaction(UserRequest request, double amount) override;
+        enum DisplayType getType() override;
+        void logError(std::string msg) override;
+        void commit() override;
+
+        void shutdown();
+
+        std::size_t dropped() const { return (myDropped.load(std::memory_order_relaxed)); }
+
+    private:
+
+        // PART: text continued in the next record
+        enum RecordKind : std::uint8_t {INFO, BALANCE, TRANSACTION, ERROR, COMMIT, SKIP, PART};
+
+        struct Record
+        {
+            std::atomic<std::size_t> sequence;
+            double amount;
+            RecordKind kind;
+            std::uint8_t request;
+            std::uint8_t messageId;
+            std::uint8_t length;
+            char text[TEXT_CAPACITY];
+        };
+
+        AsyncDisplay(const AsyncDisplay&) = delete;
+        AsyncDisplay& operator=(const AsyncDisplay&) = delete;
+
+        // `count` consecutive cells from `pos`; returns the first
+        Record* claim(std::size_t& pos, std::size_t count = 1);
+        void publish(Record* record, std::size_t pos);
+        void pushText(RecordKind kind, const char* text, std::size_t length);
+        void run();
+        bool consumeOne();
+        void replay(const Record& record);
+
+        BaseDisplay& myBackend;
+        const DisplayType myType;
+        const OverflowPolicy myPolicy;
+        const std::size_t myMask;
+        std::unique_ptr<Record[]> myRing;
+
+        // Producers and the consumer touch different cache lines
+        alignas(64) std::atomic<std::size_t> myEnqueuePos;
+        alignas(64) std::size_t myDequeuePos;
+        std::atomic<std::size_t> myDropped;
+        std::atomic<bool> myAccepting;
+        std::atomic<bool> myStopping;
+        std::atomic<bool> myConsumerIdle;
+
+        std::mutex myWakeMutex;
+        std::condition_variable myWake;
+        std::thread myConsumer;
+        std::string myText;         // consumer only: text being assembled
+};
+
+#endif // ASYNC_DISPLAY_HXX
@@ -1,11 +1,20 @@
 #ifndef BANK_HXX
 #define BANK_HXX
 
+#include <mutex>
+#include <shared_mutex>
 #include <string>
+#include <thread>
 #include <vector>
 using namespace std;
 
+#include "MemoryBudget.hxx"
+
 class Account;
+class PostingSink;
+struct AccrualReport;
+struct AccrualSchedule;
+
 class Bank
 {
     public:
@@ -14,13 +23,62 @@ class Bank
         ~Bank();
 
         // C++11/14: auto return type
-        auto getAccount(int num, string password) -> Account*;
+        auto getAccount(int num, const string& password) -> Account*;
         Account* addAccount();
 
+        // Moves `amount` between two accounts atomically; false if either
+        // account does not exist
+        bool transfer(int from, int to, double amount);
+
+        int accountCount() const;
+
+        // Back-office access for batch jobs: no password check
+        Account* accountAt(int num) const;
+
+        void reserveAccounts(int count);
+
+        // Attaches `sink` to every account, including accounts added later.
+        // One sink at a time; attach a PostingFanout to run several.
+        void setPostingSink(PostingSink* sink);
+
+        // Nightly batch: posts schedule-based interest or fees to every
+        // account. Balances are gathered into a column per shard of
+        // accounts and accruals computed with a vector kernel; each
+        // result is then posted as one ledger entry under the account's
+        // lock, recomputed first if the balance moved in between, so
+        // traffic during the batch never accrues on a stale balance.
+        // Shards run on `threads` workers (0 = one per hardware thread).
+        AccrualReport accrueInterest(const AccrualSchedule& schedule, unsigned threads = 0);
+
+        // Memory held by the bank and its accounts, kept up to date as
+        // accounts post, so this is cheap to call at any time
+        MemoryStats memoryStats() const;
+
+        // Sets or changes the budget. While one is set, a background
+        // thread runs enforceMemoryBudget() whenever memory use passes its
+        // high-water mark. A limit of 0 lifts the budget.
+        void setMemoryBudget(const MemoryBudget& budget);
+
+        // Frees memory down to the budget's low-water mark now, if it is
+        // above it. Runs one at a time.
+        MemoryBudgetReport enforceMemoryBudget();
+
     private:
 
+        // Passes the change in the directory's capacity to the tracker.
+        // Caller holds myMutex exclusively.
+        void reportDirectory(size_t capacityBefore);
+
+        // C++14: readers (lookups) share the directory, addAccount() is exclusive
+        mutable shared_timed_mutex myMutex;
         vector<Account*> myAccounts;
         int myCurrentAccountNumber;
+        PostingSink* myPostingSink = nullptr;
+
+        MemoryTracker myMemory;
+        mutex myBudgetMutex;
+        MemoryBudget myBudget;
+        thread myBudgetWorker;
 };
 
 #endif // BANK_HXX
@@ -4,6 +4,7 @@
 #include <string>
 
 enum class UserRequest;
+class TransactionView;
 
 class BaseDisplay
 {
@@ -13,13 +14,20 @@ class BaseDisplay
 
 		// C++11/14: noexcept specifier
         BaseDisplay() noexcept {};
-        ~BaseDisplay() noexcept {};
+        virtual ~BaseDisplay() noexcept {};
 
         virtual void showInfoToUser(const char* message);
         virtual void showBalance(double balance);
         virtual void showTransaction(UserRequest request, double amount);
+
+        // Shows a whole range (or one page) of ledger entries in one call.
+        // The default forwards each entry to showTransaction().
+        virtual void showTransactions(const TransactionView& transactions);
         virtual enum DisplayType getType();
         virtual void logError(std::string msg);
+
+        // Makes everything shown so far visible; ATM commits once per request
+        virtual void commit();
 };
 
 #endif // BASE_DISPLAY_HXX
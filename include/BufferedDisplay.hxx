@@ -0,0 +1,64 @@
+#ifndef BUFFERED_DISPLAY_HXX
+#define BUFFERED_DISPLAY_HXX
+
+#include "BaseDisplay.hxx"
+
+#include <cstddef>
+#include <iosfwd>
+#include <memory>
+#include <vector>
+
+#include <sys/uio.h>
+
+// Display that formats into reusable fixed-size blocks and writes them out
+// only when the pending output reaches the flush threshold or on commit().
+// With a file descriptor the blocks are handed to the kernel in a single
+// writev() call; with a stream they are written without intermediate flushes.
+class BufferedDisplay : public BaseDisplay
+{
+    public:
+
+        static const std::size_t BLOCK_SIZE = 4096;
+        static const std::size_t DEFAULT_FLUSH_THRESHOLD = 64 * 1024;
+
+        explicit BufferedDisplay(std::ostream& out,
+                                 std::size_t flushThreshold = DEFAULT_FLUSH_THRESHOLD);
+        explicit BufferedDisplay(int fd,
+                                 std::size_t flushThreshold = DEFAULT_FLUSH_THRESHOLD);
+        ~BufferedDisplay() noexcept;
+
+        void showInfoToUser(const char* message) override;
+        void showBalance(double balance) override;
+        void showTransaction(UserRequest request, double amount) override;
+        void showTransactions(const TransactionView& transactions) override;
+        void commit() override;
+
+        std::size_t pending() const { return (myPending); }
+        std::size_t writeErrors() const { return (myWriteErrors); }
+
+    private:
+
+        BufferedDisplay(const BufferedDisplay&) = delete;
+        BufferedDisplay& operator=(const BufferedDisplay&) = delete;
+
+        void append(const char* data, std::size_t length);
+        void appendAmount(double amount);
+        void appendTransaction(UserRequest request, double amount);
+        void flush();
+        void writeToDescriptor();
+        void writeToStream();
+
+        std::ostream* myStream;
+        int myFd;
+        std::size_t myFlushThreshold;
+
+        // Blocks are kept between flushes; only the first myUsedBlocks hold data
+        std::vector<std::unique_ptr<char[]>> myBlocks;
+        std::size_t myUsedBlocks = 0;
+        std::size_t myTail = 0;
+        std::size_t myPending = 0;
+        std::size_t myWriteErrors = 0;
+        std::vector<iovec> myIov;
+};
+
+#endif // BUFFERED_DISPLAY_HXX
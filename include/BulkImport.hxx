@@ -0,0 +1,73 @@
+#ifndef BULK_IMPORT_HXX
+#define BULK_IMPORT_HXX
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+class Bank;
+
+// Bulk loading of migrated accounts and history from CSV.
+//
+// The input file is memory-mapped and split into one byte range per
+// worker on line boundaries. Each worker finds commas and newlines with a
+// 16-byte SIMD scan and parses its rows in place. Bad rows are reported
+// with their line number and skipped; the rest of the file still loads.
+//
+// Accounts file, one account per line:
+//
+//     number,password
+//
+// Numbers are the bank's own account numbers and must be new, i.e. at or
+// above accountCount(), and no more than the file's row count above it.
+// Accounts are opened for every number up to the highest one listed;
+// numbers the file skips are opened without a password and counted as
+// unlisted.
+//
+// Ledger file, one entry per line, in ledger order for each account:
+//
+//     number,type,amount[,time]
+//
+// where type is D (deposit), W (withdrawal) or B (balance inquiry, amount
+// is the balance shown), and time is the LedgerTime the entry was posted,
+// in microseconds since the epoch. Entries without a time are stamped with
+// the time of the import. Entries are grouped per account and appended
+// with one appendPostings() call each, so balances follow the postings; a
+// time earlier than the one before it in the same account is raised to it.
+//
+// Fields are not quoted. A trailing '\r' is ignored and blank lines are
+// skipped. The bank must not gain accounts from elsewhere while an import
+// runs.
+struct BulkImportOptions
+{
+    unsigned threads = 0;           // 0 = one per hardware thread
+    bool header = false;            // skip the first line
+    std::size_t maxErrors = 1000;   // errors kept in the report; all are counted
+};
+
+struct ImportRowError
+{
+    std::size_t line;               // 1-based
+    const char* reason;
+};
+
+struct BulkImportReport
+{
+    std::size_t bytes = 0;
+    std::size_t rows = 0;           // non-blank data lines
+    std::size_t imported = 0;
+    std::size_t rejected = 0;
+    std::size_t unlistedAccounts = 0;
+    std::vector<ImportRowError> errors;     // by line, first maxErrors only
+    bool failed = false;            // could not open or map the file
+
+    bool ok() const { return (!failed && (rejected == 0)); }
+};
+
+BulkImportReport importAccountsCsv(Bank& bank, const std::string& path,
+                                   const BulkImportOptions& options = BulkImportOptions());
+
+BulkImportReport importLedgerCsv(Bank& bank, const std::string& path,
+                                 const BulkImportOptions& options = BulkImportOptions());
+
+#endif // BULK_IMPORT_HXX
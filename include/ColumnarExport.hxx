@@ -0,0 +1,159 @@
+#ifndef COLUMNAR_EXPORT_HXX
+#define COLUMNAR_EXPORT_HXX
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+class Bank;
+struct ColumnarFooter;
+
+// Columnar snapshot of a bank for analytics.
+//
+// The file holds two tables, accounts and ledger entries, each split into
+// row groups of up to `rowsPerGroup` rows. Every column of a row group is
+// stored as one chunk with its row count and min/max. Chunks are either
+// PLAIN arrays or RLE runs (run values followed by 32-bit run lengths).
+// The chunk index sits in a footer at the end of the file:
+//
+//     "ATMCOL2\0" | chunk data, 8-byte aligned | footer | footer offset | "ATMCOL2\0"
+//
+// Entries are written account by account in ledger order, so the entry
+// account column is one run per account and compresses to almost nothing.
+// The time chunks' min/max let a scan for a period skip row groups that
+// hold none of it.
+enum class ColumnarTable : std::uint8_t { ACCOUNTS = 0, ENTRIES = 1 };
+
+enum class ColumnarColumn : std::uint8_t {
+    ACCOUNT_NUMBER = 0,     // int32
+    ACCOUNT_BALANCE,        // double
+    ACCOUNT_ENTRIES,        // uint32, ledger length
+    ENTRY_ACCOUNT,          // int32
+    ENTRY_TYPE,             // uint8, UserRequest
+    ENTRY_AMOUNT,           // double
+    ENTRY_TIME,             // int64, LedgerTime
+};
+
+struct ColumnarExportOptions
+{
+    std::size_t rowsPerGroup = 65536;
+
+    // RLE-encode a chunk whenever that makes it smaller
+    bool compress = true;
+};
+
+struct ColumnarExportReport
+{
+    std::size_t accounts = 0;
+    std::size_t entries = 0;
+    std::size_t rowGroups = 0;      // across both tables
+    std::size_t bytes = 0;          // file size
+    bool failed = false;            // could not open, or failed writes
+
+    bool ok() const { return (!failed); }
+};
+
+// Writes the bank to `path`. Each account is locked only while its balance
+// and ledger are copied into the column buffers, so ATM traffic keeps
+// flowing; every account is consistent as of the moment it was copied.
+ColumnarExportReport exportColumnar(const Bank& bank, const std::string& path,
+                                    const ColumnarExportOptions& options = ColumnarExportOptions());
+
+// One column of one row group, pointing into the reader's mapping
+struct ColumnChunk
+{
+    enum Encoding : std::uint8_t {PLAIN = 0, RLE = 1};
+
+    Encoding encoding = PLAIN;
+    std::uint32_t rows = 0;
+    std::uint32_t runs = 0;         // RLE only
+    double min = 0.0;               // over non-NaN values; min > max when there are none
+    double max = 0.0;
+    const char* data = nullptr;
+
+    // False when no value in the chunk can fall in [low, high]
+    bool mayContain(double low, double high) const
+    {
+        return ((max >= low) && (min <= high));
+    }
+
+    // PLAIN chunks only: the values in place; nullptr for RLE
+    template <typename T>
+    const T* values() const
+    {
+        return ((encoding == PLAIN) ? reinterpret_cast<const T*>(data) : nullptr);
+    }
+
+    // Calls f(value, firstRow, count) for every run of equal values; a
+    // PLAIN chunk is a run of one per row. T must be the column's type.
+    template <typename T, typename F>
+    void forEachRun(F f) const
+    {
+        if (encoding == PLAIN)
+        {
+            const T* value = reinterpret_cast<const T*>(data);
+            for (std::uint32_t row = 0; row < rows; row++)
+            {
+                f(value[row], row, 1u);
+            }
+            return;
+        }
+        const T* value = reinterpret_cast<const T*>(data);
+        const char* lengths = data + runLengthsOffset(sizeof(T));
+        std::uint32_t row = 0;
+        for (std::uint32_t run = 0; run < runs; run++)
+        {
+            std::uint32_t count;
+            std::memcpy(&count, lengths + run * sizeof(std::uint32_t), sizeof(count));
+            f(value[run], row, count);
+            row += count;
+        }
+    }
+
+    // RLE layout: run values padded to 8 bytes, then the run lengths
+    std::size_t runLengthsOffset(std::size_t valueSize) const
+    {
+        return ((runs * valueSize + 7) & ~static_cast<std::size_t>(7));
+    }
+};
+
+// Memory-maps a file written by exportColumnar(). Chunks are read in place:
+// nothing is copied or decoded until a scan asks for it, and row groups
+// whose min/max rule out a predicate need not be touched at all.
+class ColumnarReader
+{
+    public:
+
+        explicit ColumnarReader(const std::string& path);
+        ~ColumnarReader() noexcept;
+
+        // False if the file is missing, truncated, not a columnar export or
+        // has a chunk whose layout does not match its row count
+        bool good() const { return (myBase != nullptr); }
+
+        std::size_t rows(ColumnarTable table) const;
+        std::size_t rowGroups(ColumnarTable table) const;
+
+        // Column must belong to the table of the row group
+        ColumnChunk chunk(std::size_t rowGroup, ColumnarColumn column) const;
+
+        // First row of a row group within its table
+        std::size_t firstRow(ColumnarTable table, std::size_t rowGroup) const;
+
+        static ColumnarTable tableOf(ColumnarColumn column);
+
+    private:
+
+        ColumnarReader(const ColumnarReader&) = delete;
+        ColumnarReader& operator=(const ColumnarReader&) = delete;
+
+        bool validate();
+
+        const char* myBase = nullptr;
+        std::size_t mySize = 0;
+        const ColumnarFooter* myFooter = nullptr;
+        const char* myChunks = nullptr;
+};
+
+#endif // COLUMNAR_EXPORT_HXX
@@ -0,0 +1,49 @@
+#ifndef DISPLAY_POLICY_HXX
+#define DISPLAY_POLICY_HXX
+
+#include "BaseDisplay.hxx"
+#include "TransactionView.hxx"
+
+// Display policies bind BasicATM to its output device.
+//
+// PolymorphicDisplayPolicy keeps the classic behaviour and dispatches through
+// the BaseDisplay virtual interface. StaticDisplayPolicy<D> binds the display
+// type at compile time: the calls are qualified, so they are resolved
+// statically and can be inlined even when D overrides BaseDisplay.
+
+class PolymorphicDisplayPolicy
+{
+    public:
+        using display_type = BaseDisplay;
+
+        explicit PolymorphicDisplayPolicy(BaseDisplay* display) noexcept : myDisplay(display) {}
+
+        void showInfoToUser(const char* message) { myDisplay->showInfoToUser(message); }
+        void showBalance(double balance) { myDisplay->showBalance(balance); }
+        void showTransaction(UserRequest request, double amount) { myDisplay->showTransaction(request, amount); }
+        void showTransactions(const TransactionView& transactions) { myDisplay->showTransactions(transactions); }
+        void commit() { myDisplay->commit(); }
+
+    private:
+        BaseDisplay* myDisplay;
+};
+
+template <typename Display>
+class StaticDisplayPolicy
+{
+    public:
+        using display_type = Display;
+
+        explicit StaticDisplayPolicy(Display* display) noexcept : myDisplay(display) {}
+
+        void showInfoToUser(const char* message) { myDisplay->Display::showInfoToUser(message); }
+        void showBalance(double balance) { myDisplay->Display::showBalance(balance); }
+        void showTransaction(UserRequest request, double amount) { myDisplay->Display::showTransaction(request, amount); }
+        void showTransactions(const TransactionView& transactions) { myDisplay->Display::showTransactions(transactions); }
+        void commit() { myDisplay->Display::commit(); }
+
+    private:
+        Display* myDisplay;
+};
+
+#endif // DISPLAY_POLICY_HXX
@@ -0,0 +1,69 @@
+#ifndef EVENT_SCHEDULER_HXX
+#define EVENT_SCHEDULER_HXX
+
+#include <cstddef>
+#include <cstdint>
+#include <queue>
+#include <vector>
+
+// Discrete-event scheduler over virtual time in nanoseconds. Events come
+// out in time order, and events due at the same time in the order they
+// were scheduled, so a simulation driven from it is deterministic.
+template <typename Event>
+class EventScheduler
+{
+    public:
+
+        using Time = std::uint64_t;
+
+        // Events in the past are clamped to now()
+        void schedule(Time at, const Event& event)
+        {
+            myQueue.push(Entry{(at < myNow) ? myNow : at, mySequence++, event});
+        }
+
+        void scheduleAfter(Time delay, const Event& event)
+        {
+            schedule(myNow + delay, event);
+        }
+
+        // Pops the earliest event and advances now() to its time
+        bool next(Event& event)
+        {
+            if (myQueue.empty())
+            {
+                return (false);
+            }
+            myNow = myQueue.top().at;
+            event = myQueue.top().event;
+            myQueue.pop();
+            return (true);
+        }
+
+        Time now() const { return (myNow); }
+        bool empty() const { return (myQueue.empty()); }
+        std::size_t pending() const { return (myQueue.size()); }
+
+    private:
+
+        struct Entry
+        {
+            Time at;
+            std::uint64_t sequence;
+            Event event;
+        };
+
+        struct Later
+        {
+            bool operator()(const Entry& a, const Entry& b) const
+            {
+                return ((a.at > b.at) || ((a.at == b.at) && (a.sequence > b.sequence)));
+            }
+        };
+
+        std::priority_queue<Entry, std::vector<Entry>, Later> myQueue;
+        Time myNow = 0;
+        std::uint64_t mySequence = 0;
+};
+
+#endif // EVENT_SCHEDULER_HXX
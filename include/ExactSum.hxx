@@ -0,0 +1,42 @@
+#ifndef EXACT_SUM_HXX
+#define EXACT_SUM_HXX
+
+#include <cstdint>
+
+// Error-free accumulator for doubles (a "superaccumulator"). Every finite
+// double is a multiple of 2^-1074 below 2^1024, so the exact sum of any
+// number of them fits a fixed-point integer of ~2100 bits, kept here in
+// 32-bit limbs. Adding is exact and order-independent; value() rounds the
+// exact total to the nearest double once.
+class ExactSum
+{
+    public:
+
+        ExactSum() noexcept;
+
+        void add(double value) noexcept;
+        void subtract(double value) noexcept { add(-value); }
+        void add(const ExactSum& other) noexcept;
+
+        // Correctly rounded (to nearest, ties to even) for normal results;
+        // NaN once a NaN or infinity has been added
+        double value() const noexcept;
+
+        bool isZero() const noexcept;
+
+    private:
+
+        static const int LIMB_BITS = 32;
+        static const int LIMB_COUNT = 72;
+        static const int MIN_EXPONENT = -1074;
+        // Normalize before any limb could overflow its int64
+        static const std::uint32_t ADDS_BEFORE_NORMALIZE = 1u << 30;
+
+        void normalize() noexcept;
+
+        std::int64_t myLimbs[LIMB_COUNT];
+        std::uint32_t myPendingAdds;
+        bool myNonFinite;
+};
+
+#endif // EXACT_SUM_HXX
@@ -0,0 +1,41 @@
+#ifndef FORMAT_HXX
+#define FORMAT_HXX
+
+#include "UserRequest.hxx"
+
+#include <cstddef>
+#include <system_error>
+
+// Allocation-free, locale-independent formatting for display output.
+// Functions write into [first, last) and follow std::to_chars: on success
+// ptr is one past the last character written and ec is std::errc(); if the
+// buffer is too small ec is std::errc::value_too_large and ptr == last.
+
+struct ToCharsResult
+{
+    char* ptr;
+    std::errc ec;
+};
+
+// Large enough for any formatAmount output, and for formatAmountFixed of
+// magnitudes below 2^53
+const std::size_t AMOUNT_BUFFER_SIZE = 40;
+
+// Shortest decimal text that reads back as exactly the same double.
+// Amounts are written in plain notation ("12.5", "0.07", "-3"); only
+// magnitudes outside the fast path fall back to exponent notation.
+ToCharsResult formatAmount(char* first, char* last, double value);
+
+// Fixed-point text with exactly `decimals` fractional digits (0..9).
+ToCharsResult formatAmountFixed(char* first, char* last, double value, int decimals);
+
+struct RequestName
+{
+    const char* text;
+    std::size_t length;
+};
+
+// Precomputed enumerator names, e.g. "REQUEST_DEPOSIT"
+RequestName requestName(UserRequest request);
+
+#endif // FORMAT_HXX
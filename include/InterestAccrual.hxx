@@ -0,0 +1,40 @@
+#ifndef INTEREST_ACCRUAL_HXX
+#define INTEREST_ACCRUAL_HXX
+
+#include <cstddef>
+#include <vector>
+
+// One balance band: applies to balances from `floor` up to the next
+// tier's floor. The accrual for a balance b is b * rate + fixed, so a
+// negative rate or fixed amount is a fee.
+struct RateTier
+{
+    double floor;
+    double rate;
+    double fixed;
+};
+
+struct AccrualSchedule
+{
+    // Sorted by floor; balances below the first floor accrue nothing
+    std::vector<RateTier> tiers;
+
+    // Accruals are rounded to a multiple of this (half to even); 0 = exact
+    double roundTo = 0.01;
+};
+
+struct AccrualReport
+{
+    std::size_t accounts = 0;
+    std::size_t credits = 0;       // posted as REQUEST_DEPOSIT
+    std::size_t debits = 0;        // posted as REQUEST_WITHDRAW
+    double totalCredited = 0.0;    // exact sums, rounded once
+    double totalDebited = 0.0;
+};
+
+// Column kernel: accruals[i] for balances[i], i < count. Uses SSE2 where
+// available; the scalar path gives bit-identical results.
+void computeAccruals(const double* balances, double* accruals, std::size_t count,
+    const AccrualSchedule& schedule);
+
+#endif // INTEREST_ACCRUAL_HXX
@@ -0,0 +1,140 @@
+#ifndef LATENCY_HISTOGRAM_HXX
+#define LATENCY_HISTOGRAM_HXX
+
+#include "UserRequest.hxx"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+
+// HDR-style log-linear histogram of nanosecond values. Each power of two is
+// split into 32 linear sub-buckets, so a recorded value is reported with at
+// most ~3% relative error. Values above 2^40 ns (~18 minutes) are clamped.
+//
+// record() is meant for a single writer; readers on other threads may merge
+// or query concurrently and see a slightly stale but consistent-enough view.
+class LatencyHistogram
+{
+    public:
+
+        static const int SUB_BUCKET_BITS = 5;
+        static const int SUB_BUCKET_COUNT = 1 << SUB_BUCKET_BITS;
+        static const int MAX_EXPONENT = 40;
+        static const int BUCKET_COUNT = (MAX_EXPONENT - SUB_BUCKET_BITS + 2) * SUB_BUCKET_COUNT;
+
+        LatencyHistogram() noexcept;
+
+        void record(std::uint64_t value) noexcept
+        {
+            std::atomic<std::uint64_t>& bucket = myBuckets[bucketIndex(value)];
+            bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            if (value > myMax.load(std::memory_order_relaxed))
+            {
+                myMax.store(value, std::memory_order_relaxed);
+            }
+        }
+
+        void merge(const LatencyHistogram& other) noexcept;
+        void reset() noexcept;
+
+        std::uint64_t count() const noexcept;
+        std::uint64_t max() const noexcept { return (myMax.load(std::memory_order_relaxed)); }
+
+        // Upper bound of the bucket holding the given percentile (0..100)
+        std::uint64_t valueAtPercentile(double percentile) const noexcept;
+
+        static int bucketIndex(std::uint64_t value) noexcept;
+        static std::uint64_t bucketUpperBound(int index) noexcept;
+
+    private:
+
+        LatencyHistogram(const LatencyHistogram&) = delete;
+        LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+        std::atomic<std::uint64_t> myBuckets[BUCKET_COUNT];
+        std::atomic<std::uint64_t> myMax;
+};
+
+// Request types tracked by ATM
+enum class LatencyKind {
+    VIEW_ACCOUNT = 0,
+    REQUEST_INVALID,
+    REQUEST_BALANCE,
+    REQUEST_DEPOSIT,
+    REQUEST_WITHDRAW,
+    REQUEST_TRANSACTIONS,
+    KIND_COUNT,
+};
+
+inline LatencyKind latencyKindFor(UserRequest request)
+{
+    int index = static_cast<int>(request) + 1;
+    if ((index <= 0) || (index >= static_cast<int>(LatencyKind::KIND_COUNT)))
+    {
+        return (LatencyKind::REQUEST_INVALID);
+    }
+    return (static_cast<LatencyKind>(index));
+}
+
+// Process-wide latency statistics. Every thread records into its own set of
+// histograms; summary() and dump() merge them on read.
+class LatencyStats
+{
+    public:
+
+        struct Summary
+        {
+            std::uint64_t count;
+            std::uint64_t p50;
+            std::uint64_t p99;
+            std::uint64_t p999;
+            std::uint64_t max;
+        };
+
+        static void record(LatencyKind kind, std::uint64_t nanoseconds) noexcept;
+        static Summary summary(LatencyKind kind);
+        static void merged(LatencyKind kind, LatencyHistogram& into);
+        static void dump(std::ostream& out);
+        static void reset();
+
+        static const char* kindName(LatencyKind kind);
+};
+
+// Records the lifetime of the scope into LatencyStats
+class LatencyScope
+{
+    public:
+
+        explicit LatencyScope(LatencyKind kind) noexcept :
+            myKind(kind),
+            myStart(std::chrono::steady_clock::now())
+        {
+        }
+
+        ~LatencyScope() noexcept
+        {
+            auto elapsed = std::chrono::steady_clock::now() - myStart;
+            LatencyStats::record(myKind, static_cast<std::uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+        }
+
+    private:
+
+        LatencyScope(const LatencyScope&) = delete;
+        LatencyScope& operator=(const LatencyScope&) = delete;
+
+        LatencyKind myKind;
+        std::chrono::steady_clock::time_point myStart;
+};
+
+// Instrumentation points compile to nothing unless ATM_ENABLE_LATENCY_STATS
+// is defined (CMake option ATM_LATENCY_STATS).
+#if defined(ATM_ENABLE_LATENCY_STATS) && ATM_ENABLE_LATENCY_STATS
+#define ATM_LATENCY_SCOPE(kind) LatencyScope atmLatencyScope_(kind)
+#else
+#define ATM_LATENCY_SCOPE(kind) ((void)0)
+#endif
+
+#endif // LATENCY_HISTOGRAM_HXX
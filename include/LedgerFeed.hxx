@@ -0,0 +1,129 @@
+#ifndef LEDGER_FEED_HXX
+#define LEDGER_FEED_HXX
+
+#include "PostingSink.hxx"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// One ledger mutation as seen by CDC subscribers
+struct LedgerEvent
+{
+    std::uint64_t sequence;
+    int account;
+    UserRequest type;
+    double amount;
+    double balance;
+};
+
+// Change-data-capture feed. Attach with Bank::setPostingSink() and every
+// posting gets the next sequence number (0, 1, 2, ...) and is published
+// into a lock-free broadcast ring. Postings to one account get increasing
+// sequence numbers in ledger order.
+//
+// Any number of subscribers read the ring at their own pace; each slot is
+// a seqlock, so readers never block writers. When the ring is full the
+// overflow policy either makes publishers wait for the slowest subscriber
+// (BLOCK) or lets them overwrite; a subscriber that falls behind by more
+// than the capacity then skips ahead and counts what it lost
+// (DROP_LAGGING).
+class LedgerFeed final : public PostingSink
+{
+    public:
+
+        enum OverflowPolicy {BLOCK, DROP_LAGGING};
+
+        static const std::size_t DEFAULT_CAPACITY = 65536;
+        static const std::size_t MAX_SUBSCRIBERS = 64;
+
+        class Subscription
+        {
+            public:
+
+                ~Subscription();
+
+                // Copies up to `max` events in sequence order; returns how
+                // many. Never blocks.
+                std::size_t poll(LedgerEvent* events, std::size_t max);
+
+                // Sequence of the next event this subscriber will see
+                std::uint64_t position() const { return (myNext); }
+
+                // Events skipped because they were overwritten before read
+                std::uint64_t lost() const { return (myLost); }
+
+            private:
+
+                friend class LedgerFeed;
+
+                Subscription(LedgerFeed& feed, std::size_t slot, std::uint64_t from);
+                Subscription(const Subscription&) = delete;
+                Subscription& operator=(const Subscription&) = delete;
+
+                LedgerFeed& myFeed;
+                std::size_t mySlot;
+                std::uint64_t myNext;
+                std::uint64_t myLost = 0;
+        };
+
+        explicit LedgerFeed(std::size_t capacity = DEFAULT_CAPACITY, OverflowPolicy policy = BLOCK);
+        ~LedgerFeed() noexcept;
+
+        void onPosting(const Posting& posting) noexcept override;
+
+        // Publishes one event and returns its sequence number
+        std::uint64_t publish(const Posting& posting) noexcept;
+
+        // Sequence the next posting will get
+        std::uint64_t nextSequence() const { return (myClaimed.load(std::memory_order_acquire)); }
+
+        // Oldest sequence still held by the ring
+        std::uint64_t oldestSequence() const;
+
+        std::size_t capacity() const { return (myMask + 1); }
+
+        // Starts reading at `from`, or at the next posting when omitted.
+        // Resuming from a sequence the ring no longer holds starts at the
+        // oldest one it does and counts the gap as lost. nullptr when
+        // MAX_SUBSCRIBERS are already attached.
+        std::unique_ptr<Subscription> subscribe();
+        std::unique_ptr<Subscription> subscribe(std::uint64_t from);
+
+    private:
+
+        static const std::uint64_t NO_CURSOR = ~std::uint64_t(0);
+
+        // version is 2 * sequence + 1 while being written and
+        // 2 * sequence + 2 once published; 0 means never written
+        struct Slot
+        {
+            std::atomic<std::uint64_t> version;
+            std::atomic<std::uint64_t> header;      // account and type
+            std::atomic<std::uint64_t> amount;
+            std::atomic<std::uint64_t> balance;
+        };
+
+        // One cache line each, so subscribers do not slow each other down
+        struct Cursor
+        {
+            alignas(64) std::atomic<std::uint64_t> next;
+        };
+
+        LedgerFeed(const LedgerFeed&) = delete;
+        LedgerFeed& operator=(const LedgerFeed&) = delete;
+
+        void waitForSubscribers(std::uint64_t sequence) noexcept;
+        std::uint64_t slowestCursor() const noexcept;
+
+        const OverflowPolicy myPolicy;
+        const std::size_t myMask;
+        std::unique_ptr<Slot[]> mySlots;
+
+        alignas(64) std::atomic<std::uint64_t> myClaimed;
+        alignas(64) std::atomic<std::uint64_t> myGate;   // cached slowest cursor
+        Cursor myCursors[MAX_SUBSCRIBERS];
+};
+
+#endif // LEDGER_FEED_HXX
@@ -0,0 +1,176 @@
+#ifndef LOG_SHIPPING_HXX
+#define LOG_SHIPPING_HXX
+
+#include "LatencyHistogram.hxx"
+#include "PostingSink.hxx"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <thread>
+
+class Bank;
+struct ShippingChannel;
+
+// Streams every mutation of a primary bank to a hot standby in another
+// process on the same machine.
+//
+// The primary attaches a LogShipper as the bank's posting sink. Each
+// account opening, posting, password change and balance inquiry gets a
+// sequence number and is appended to a write-ahead log file and to a
+// single-producer byte ring in POSIX shared memory (`channel` is a
+// shm_open() name such as "/atm-standby"). A StandbyReplica in the standby
+// process drains the ring into its own Bank, so failover is promote()
+// rather than a cold rebuild.
+//
+// The ring is the fast path only. When it is full the record goes to the
+// log alone and the standby catches up from the log file, so a slow or
+// absent standby never blocks the primary. A standby may also start from a
+// snapshot of the bank taken at a known sequence number; records before it
+// are skipped.
+//
+// The log is written with ordinary buffered I/O and is not synced; it
+// covers standby lag, not primary crashes. Passwords are shipped as stored,
+// so the log file is created with mode 0600 and the channel is likewise
+// private to the user running the primary.
+class LogShipper final : public PostingSink
+{
+    public:
+
+        static const std::size_t DEFAULT_RING_BYTES = 1 << 20;
+
+        // Creates (or replaces) the channel and truncates the log.
+        // `ringBytes` is rounded up to a power of two.
+        LogShipper(const std::string& channel, const std::string& logPath,
+                   std::size_t ringBytes = DEFAULT_RING_BYTES);
+        ~LogShipper() noexcept;
+
+        // False if the channel or the log could not be created
+        bool good() const;
+
+        void onPosting(const Posting& posting) noexcept override;
+        void onAccountOpened(int account) noexcept override;
+        void onPasswordChanged(int account, const std::string& password) noexcept override;
+        void onBalanceInquiry(int account, double balance, LedgerTime time) noexcept override;
+
+        // Hands buffered log records to the OS
+        void flush();
+
+        // Sequence number the next mutation will get; a snapshot taken
+        // while the bank is quiet holds every record before it
+        std::uint64_t nextSequence() const;
+
+        // Records that did not fit in the ring and were sent by log only
+        std::uint64_t ringOverflows() const;
+
+        // Password changes not shipped because the password is longer than
+        // a record can carry (64 KiB); the standby keeps the old password
+        std::uint64_t rejectedPasswords() const;
+
+        // Set once a standby on this channel has been promoted; a primary
+        // still running should stop taking requests
+        bool standbyPromoted() const;
+
+    private:
+
+        LogShipper(const LogShipper&) = delete;
+        LogShipper& operator=(const LogShipper&) = delete;
+
+        void append(std::uint8_t kind, int account, std::uint8_t type,
+                    double amount, double balance, LedgerTime time,
+                    const std::string* text) noexcept;
+
+        mutable std::mutex myMutex;
+        std::string myName;
+        ShippingChannel* myChannel = nullptr;
+        std::size_t myMappedBytes = 0;
+        std::ofstream myLog;
+        std::uint64_t myNextSequence = 0;
+        std::uint64_t myOverflows = 0;
+        std::uint64_t myRejectedPasswords = 0;
+};
+
+// Standby side of a LogShipper channel. Applies shipped records to `bank`
+// in sequence order, either from poll() calls or from a background thread
+// started with start(). Only one replica may drain a channel at a time.
+class StandbyReplica
+{
+    public:
+
+        struct Lag
+        {
+            std::uint64_t published;    // records shipped by the primary
+            std::uint64_t applied;      // records applied here
+            std::uint64_t records;      // published - applied
+            std::uint64_t nanoseconds;  // age of the newest applied record while behind, else 0
+        };
+
+        // `bank` must hold exactly the records before `fromSequence`: empty
+        // for 0, or loaded from a snapshot taken at that sequence
+        StandbyReplica(Bank& bank, const std::string& channel, const std::string& logPath,
+                       std::uint64_t fromSequence = 0);
+        ~StandbyReplica() noexcept;
+
+        // False if the channel does not exist yet or is not a LogShipper ring
+        bool good() const;
+
+        // Applies up to `max` records that are available now, from the ring
+        // or, for records the ring dropped, from the log. Returns the number
+        // applied. Not to be mixed with a running start() thread.
+        std::size_t poll(std::size_t max = std::numeric_limits<std::size_t>::max());
+
+        void start();
+        void stop();
+
+        // Stops the background thread, marks the channel as taken over and
+        // then applies everything the primary has published, from the ring
+        // or the log. The bank is then ready to serve. Returns the next
+        // sequence number; records a primary still running publishes after
+        // the drain are not applied, so it should stop taking requests
+        // once standbyPromoted() is set.
+        std::uint64_t promote();
+
+        Lag lag() const;
+
+        // Nanoseconds from a record being shipped to it being applied
+        const LatencyHistogram& applyDelay() const { return (myApplyDelay); }
+
+        // Records applied from the log rather than the ring
+        std::uint64_t caughtUp() const { return (myCaughtUp.load(std::memory_order_relaxed)); }
+
+        // Records that did not reproduce the primary's state: a balance
+        // that differs after a posting, or an unexpected account number
+        std::uint64_t divergences() const { return (myDivergences.load(std::memory_order_relaxed)); }
+
+    private:
+
+        struct Record;
+
+        StandbyReplica(const StandbyReplica&) = delete;
+        StandbyReplica& operator=(const StandbyReplica&) = delete;
+
+        void catchUp(std::uint64_t until);
+        void apply(const Record& record, std::uint64_t now);
+
+        Bank& myBank;
+        ShippingChannel* myChannel = nullptr;
+        std::size_t myMappedBytes = 0;
+        std::string myLogPath;
+        std::ifstream myLog;
+        std::uint64_t myLogOffset = 0;
+
+        std::atomic<std::uint64_t> myNext;
+        std::atomic<std::uint64_t> myLastApplied{0};     // primary timestamp, ns
+        std::atomic<std::uint64_t> myCaughtUp{0};
+        std::atomic<std::uint64_t> myDivergences{0};
+        LatencyHistogram myApplyDelay;
+
+        std::thread myThread;
+        std::atomic<bool> myStopping{false};
+};
+
+#endif // LOG_SHIPPING_HXX
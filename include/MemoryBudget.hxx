@@ -0,0 +1,156 @@
+#ifndef MEMORY_BUDGET_HXX
+#define MEMORY_BUDGET_HXX
+
+#include "TransactionView.hxx"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Heap used by a bank, by component. Figures are what the containers have
+// allocated (capacity, not size), without allocator overhead.
+struct MemoryStats
+{
+    std::size_t accounts = 0;
+    std::size_t directoryBytes = 0;     // the bank's table of accounts
+    std::size_t accountBytes = 0;       // the Account objects themselves
+    std::size_t ledgerBytes = 0;        // ledger entries, times and time index
+    std::size_t ledgerUsedBytes = 0;    // of ledgerBytes, what holds entries
+    std::size_t ledgerEntries = 0;
+    std::size_t credentialBytes = 0;    // passwords too long to live inside the string
+
+    std::size_t total() const
+    {
+        return (directoryBytes + accountBytes + ledgerBytes + credentialBytes);
+    }
+};
+
+// Optional cap on a bank's memory. Once the total passes
+// limitBytes * highWater, the bank frees memory until it is back under
+// limitBytes * lowWater:
+//
+//   1. compaction: ledgers give back capacity they are not using;
+//   2. trimming: the longest ledgers drop their oldest entries, keeping the
+//      newest keepEntries. The dropped entries are replaced by one
+//      REQUEST_CARRY_FORWARD entry of what they add up to, stamped with
+//      the time of the last of them, so balances, reconciliation and
+//      statement opening balances do not change. Statements and queries
+//      do not list it.
+//   3. spilling: with a spill directory, trimmed entries are first
+//      appended to <spillDirectory>/ledger-<account>.spill, to be read
+//      back with loadSpilledLedger(). Carry-forwards are never spilled, so
+//      the spill file followed by the live ledger after its carry-forward
+//      is the account's full history. A ledger whose spill cannot be
+//      written is not trimmed.
+//
+// Ledger positions (statement cursors, query matches) count every entry
+// ever posted, so they still line up after trimming; statement runs count
+// cursors that pointed at trimmed entries in trimmedCursors. Trimming only
+// affects this bank: a hot standby keeps its full ledgers.
+struct MemoryBudget
+{
+    std::size_t limitBytes = 0;         // 0 = no budget
+    double highWater = 0.9;
+    double lowWater = 0.75;
+    std::size_t keepEntries = 256;      // newest entries every ledger keeps
+    std::string spillDirectory;         // empty = trimmed entries are dropped
+};
+
+struct MemoryBudgetReport
+{
+    std::size_t bytesBefore = 0;
+    std::size_t bytesAfter = 0;
+    std::size_t compactedAccounts = 0;
+    std::size_t trimmedAccounts = 0;
+    std::size_t trimmedEntries = 0;     // carry-forward entries not counted
+    std::size_t spilledEntries = 0;
+    std::size_t spillFailures = 0;      // accounts left untrimmed
+
+    bool withinBudget = true;           // bytesAfter <= limitBytes
+};
+
+// Running totals behind Bank::memoryStats(). Accounts report changes to
+// their own footprint as they happen, so reading the totals does not walk
+// the bank. Allocation sizes change rarely (when a container grows) and
+// go to shared counters; ledger use changes with every posting and is
+// spread over per-account stripes so that busy accounts do not contend.
+class MemoryTracker
+{
+    public:
+
+        enum Component {DIRECTORY, ACCOUNTS, LEDGER, CREDENTIALS, COMPONENTS};
+
+        static const std::size_t STRIPES = 16;
+
+        void addBytes(Component component, std::int64_t delta)
+        {
+            myBytes[component].fetch_add(delta, std::memory_order_relaxed);
+            const std::int64_t total = myTotal.fetch_add(delta, std::memory_order_relaxed) + delta;
+            const std::int64_t highWater = myHighWater.load(std::memory_order_relaxed);
+            if ((delta > 0) && (highWater != 0) && (total > highWater)
+                && !myPressure.exchange(true, std::memory_order_acq_rel))
+            {
+                myWake.notify_one();
+            }
+        }
+
+        void addUsage(int account, std::int64_t usedBytes, std::int64_t entries)
+        {
+            Stripe& stripe = myStripes[static_cast<std::size_t>(account) % STRIPES];
+            stripe.usedBytes.fetch_add(usedBytes, std::memory_order_relaxed);
+            stripe.entries.fetch_add(entries, std::memory_order_relaxed);
+        }
+
+        MemoryStats stats() const;
+
+        std::size_t totalBytes() const
+        {
+            const std::int64_t total = myTotal.load(std::memory_order_relaxed);
+            return ((total > 0) ? static_cast<std::size_t>(total) : 0);
+        }
+
+        // Total above which addBytes() raises pressure; 0 = never
+        void setHighWater(std::size_t bytes);
+
+        // Blocks until pressure is raised or stopWaiting() is called, and
+        // clears it. False once stopWaiting() has been called.
+        bool awaitPressure();
+        void stopWaiting();
+
+    private:
+
+        // Padded to a cache line rather than aligned, so that Bank keeps
+        // its natural alignment and plain new (C++14) still suits it
+        struct Stripe
+        {
+            std::atomic<std::int64_t> usedBytes{0};
+            std::atomic<std::int64_t> entries{0};
+            char pad[64 - 2 * sizeof(std::atomic<std::int64_t>)];
+        };
+
+        std::atomic<std::int64_t> myBytes[COMPONENTS] = {};
+        std::atomic<std::int64_t> myTotal{0};
+        std::atomic<std::int64_t> myHighWater{0};
+        Stripe myStripes[STRIPES];
+
+        std::atomic<bool> myPressure{false};
+        std::mutex myWakeMutex;
+        std::condition_variable myWake;
+        bool myStopping = false;
+};
+
+// Appends entries to an account's spill file in `directory`. On failure
+// the file is cut back to what it held before.
+bool spillLedger(const std::string& directory, int account, const TransactionView& entries);
+
+// Everything spilled for an account, oldest first; false if the file is
+// missing or damaged
+bool loadSpilledLedger(const std::string& directory, int account,
+                       std::vector<Transaction>& transactions, std::vector<LedgerTime>& times);
+
+#endif // MEMORY_BUDGET_HXX
@@ -0,0 +1,20 @@
+#ifndef NULL_DISPLAY_HXX
+#define NULL_DISPLAY_HXX
+
+#include "BaseDisplay.hxx"
+
+// Display that discards all output. Used by benchmarks and load tools so
+// that display cost does not skew the measured library paths.
+class NullDisplay final : public BaseDisplay
+{
+    public:
+
+        void showInfoToUser(const char*) override {}
+        void showBalance(double) override {}
+        void showTransaction(UserRequest, double) override {}
+        void showTransactions(const TransactionView&) override {}
+        void logError(std::string) override {}
+        void commit() override {}
+};
+
+#endif // NULL_DISPLAY_HXX
@@ -0,0 +1,52 @@
+#ifndef PARALLEL_FOR_HXX
+#define PARALLEL_FOR_HXX
+
+#include <algorithm>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+// Number of workers batch jobs use when the caller passes 0
+inline unsigned defaultThreadCount()
+{
+    unsigned count = std::thread::hardware_concurrency();
+    return (count == 0 ? 1 : count);
+}
+
+// Splits [0, count) into one contiguous range per worker and runs
+// fn(worker, begin, end) for each range; the calling thread takes the first
+// range. Ranges are derived from count and threads only, so a job whose
+// results depend on the range, not on timing, is deterministic.
+template <typename Fn>
+void parallelForRanges(std::size_t count, unsigned threads, Fn fn)
+{
+    if (threads == 0)
+    {
+        threads = defaultThreadCount();
+    }
+    threads = static_cast<unsigned>(std::max<std::size_t>(1, std::min<std::size_t>(threads, count)));
+
+    const std::size_t chunk = count / threads;
+    const std::size_t extra = count % threads;
+    auto rangeBegin = [chunk, extra](unsigned worker)
+    {
+        return (worker * chunk + std::min<std::size_t>(worker, extra));
+    };
+
+    std::vector<std::thread> workers;
+    for (unsigned worker = 1; worker < threads; worker++)
+    {
+        workers.emplace_back([&fn, &rangeBegin, worker]()
+        {
+            fn(worker, rangeBegin(worker), rangeBegin(worker + 1));
+        });
+    }
+    fn(0u, rangeBegin(0), rangeBegin(1));
+
+    for (std::thread& t : workers)
+    {
+        t.join();
+    }
+}
+
+#endif // PARALLEL_FOR_HXX
@@ -0,0 +1,108 @@
+#ifndef POSTING_SINK_HXX
+#define POSTING_SINK_HXX
+
+#include "TransactionView.hxx"
+#include "UserRequest.hxx"
+
+#include <string>
+#include <vector>
+
+// One money movement on one account, as appended to its ledger
+struct Posting
+{
+    int account;
+    UserRequest type;       // REQUEST_DEPOSIT or REQUEST_WITHDRAW
+    double amount;
+    double balance;         // after the posting
+    LedgerTime time;        // of the ledger entry
+};
+
+// Pipeline stage fed every posting as it happens. onPosting() runs on the
+// posting thread with the account locked, so calls for one account arrive
+// in ledger order and never overlap; calls for different accounts may run
+// concurrently. It must be quick and must not call back into the account.
+//
+// Sinks that mirror the whole bank, such as log shipping, also need the
+// mutations that move no money; those hooks default to doing nothing.
+// onAccountOpened() runs with the bank's directory locked, before the new
+// account can be posted to.
+class PostingSink
+{
+    public:
+
+        virtual ~PostingSink() noexcept {}
+
+        virtual void onPosting(const Posting& posting) noexcept = 0;
+
+        virtual void onAccountOpened(int account) noexcept
+        {
+            (void)account;
+        }
+
+        virtual void onPasswordChanged(int account, const std::string& password) noexcept
+        {
+            (void)account;
+            (void)password;
+        }
+
+        // recordBalanceInquiry() appends a REQUEST_BALANCE entry to the ledger
+        virtual void onBalanceInquiry(int account, double balance, LedgerTime time) noexcept
+        {
+            (void)account;
+            (void)balance;
+            (void)time;
+        }
+};
+
+// Feeds every call to several sinks in the order they were added, so
+// stages such as anomaly detection, a ledger feed and log shipping can run
+// on one bank. Add the sinks before attaching the fan-out; it is not
+// changed while postings flow. Each sink sees the same calls it would
+// see attached alone, and the fan-out adds their costs to the posting path.
+class PostingFanout final : public PostingSink
+{
+    public:
+
+        void add(PostingSink* sink)
+        {
+            mySinks.push_back(sink);
+        }
+
+        void onPosting(const Posting& posting) noexcept override
+        {
+            for (PostingSink* sink : mySinks)
+            {
+                sink->onPosting(posting);
+            }
+        }
+
+        void onAccountOpened(int account) noexcept override
+        {
+            for (PostingSink* sink : mySinks)
+            {
+                sink->onAccountOpened(account);
+            }
+        }
+
+        void onPasswordChanged(int account, const std::string& password) noexcept override
+        {
+            for (PostingSink* sink : mySinks)
+            {
+                sink->onPasswordChanged(account, password);
+            }
+        }
+
+        void onBalanceInquiry(int account, double balance, LedgerTime time) noexcept override
+        {
+            for (PostingSink* sink : mySinks)
+            {
+                sink->onBalanceInquiry(account, balance, time);
+            }
+        }
+
+    private:
+
+        std::vector<PostingSink*> mySinks;
+};
+
+#endif // POSTING_SINK_HXX
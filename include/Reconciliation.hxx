@@ -0,0 +1,43 @@
+#ifndef RECONCILIATION_HXX
+#define RECONCILIATION_HXX
+
+#include <cstddef>
+#include <vector>
+
+class Bank;
+
+// An account whose balance is not what its ledger says it should be
+struct ReconciliationMismatch
+{
+    int account;
+    double balance;     // what the account holds
+    double expected;    // the ledger replayed in posting order
+    double exactLedger; // the ledger summed exactly
+};
+
+struct ReconciliationReport
+{
+    std::size_t accounts = 0;
+    std::size_t postings = 0;
+    std::size_t inquiries = 0;  // REQUEST_BALANCE entries, not postings
+
+    // In account order
+    std::vector<ReconciliationMismatch> mismatches;
+
+    // Bank-wide totals, each summed exactly and rounded once. They do not
+    // depend on the thread count. ledgerTotal - controlTotal is the
+    // rounding the balances have picked up along the way.
+    double controlTotal = 0.0;  // sum of all balances
+    double ledgerTotal = 0.0;   // sum of all postings
+
+    bool balanced() const { return (mismatches.empty()); }
+};
+
+// Checks every account's balance against its ledger. A balance is the
+// running double sum of its postings (deposits add, withdrawals subtract),
+// so the check replays that sum in posting order and compares bit for bit;
+// balance inquiries are skipped. Accounts are split across `threads`
+// workers (0 = one per hardware thread).
+ReconciliationReport reconcileBank(const Bank& bank, unsigned threads = 0);
+
+#endif // RECONCILIATION_HXX
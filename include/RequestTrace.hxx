@@ -0,0 +1,70 @@
+#ifndef REQUEST_TRACE_HXX
+#define REQUEST_TRACE_HXX
+
+#include "UserRequest.hxx"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// One recorded ATM call. Passwords are never recorded; replay looks them up
+// from the bank it runs against.
+struct RequestTraceRecord
+{
+    enum class Kind : std::uint8_t { VIEW_ACCOUNT, USER_REQUEST };
+
+    std::uint64_t offset = 0;     // ns since recording started
+    std::uint32_t session = 0;    // one session per recorded ATM
+    Kind kind = Kind::USER_REQUEST;
+    UserRequest request = UserRequest::REQUEST_INVALID;
+    int account = 0;              // VIEW_ACCOUNT only
+    double amount = 0.0;          // deposits and withdrawals only
+};
+
+// Appends ATM calls to a compact binary trace: a tag byte, varint time
+// delta and session, then the account number or amount when the call has
+// one. Safe to share between ATMs on different threads.
+class RequestTraceWriter
+{
+    public:
+
+        explicit RequestTraceWriter(const std::string& path);
+        ~RequestTraceWriter();
+
+        bool good() const;
+        bool close();
+
+        std::uint32_t openSession() noexcept
+        {
+            return (myNextSession.fetch_add(1, std::memory_order_relaxed));
+        }
+
+        void recordViewAccount(std::uint32_t session, int account);
+        void recordRequest(std::uint32_t session, UserRequest request, double amount);
+
+        std::uint64_t recordCount() const;
+
+    private:
+
+        RequestTraceWriter(const RequestTraceWriter&) = delete;
+        RequestTraceWriter& operator=(const RequestTraceWriter&) = delete;
+
+        void append(const RequestTraceRecord& record);
+
+        mutable std::mutex myMutex;
+        std::ofstream myOut;
+        std::chrono::steady_clock::time_point myStart;
+        std::uint64_t myLastOffset = 0;
+        std::uint64_t myCount = 0;
+        std::atomic<std::uint32_t> myNextSession;
+};
+
+// Reads a whole trace written by RequestTraceWriter. Returns false if the
+// file is missing, not a trace, or truncated.
+bool loadRequestTrace(const std::string& path, std::vector<RequestTraceRecord>& records);
+
+#endif // REQUEST_TRACE_HXX
@@ -0,0 +1,73 @@
+#ifndef STATEMENT_ENGINE_HXX
+#define STATEMENT_ENGINE_HXX
+
+#include "TransactionView.hxx"
+#include "UserRequest.hxx"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+class Bank;
+
+struct StatementOptions
+{
+    // Files are written as <directory>/<prefix>-<shard>.txt
+    std::string directory = ".";
+    std::string prefix = "statements";
+
+    // Shards are contiguous account ranges, each with its own file and
+    // worker thread (0 = one per hardware thread)
+    unsigned shards = 0;
+
+    // Ledger entry types listed on a statement; balances always count
+    // every posting
+    unsigned requestTypes = POSTING_REQUESTS;
+
+    // Only entries posted within this period are listed, e.g. one month.
+    // The opening balance comes from the ledger's time index, so a
+    // statement costs the same however much history precedes the period.
+    TimeRange period;
+
+    // Optional per-account ledger positions, indexed by account number.
+    // When set, a statement covers the entries after the position and
+    // the position is advanced past the last entry covered, so the next
+    // run starts where this one stopped. Missing entries count as 0.
+    // Positions survive ledger trimming (see Account::trimmedBefore()).
+    std::vector<std::size_t>* cursors = nullptr;
+};
+
+struct StatementReport
+{
+    std::size_t accounts = 0;
+    std::size_t entries = 0;        // entries listed across all statements
+    std::vector<std::string> files;
+    std::size_t failedShards = 0;   // could not open, or failed writes
+
+    // Cursors that pointed at entries trimmed away by a memory budget
+    // before a statement listed them; those statements start at the
+    // oldest entry still held (the rest are in the spill files)
+    std::size_t trimmedCursors = 0;
+
+    bool ok() const { return (failedShards == 0); }
+};
+
+// Renders per-account statements: opening balance, the period's entries,
+// closing balance. Shards stream through a BufferedDisplay on their
+// file, so memory use does not grow with the size of the bank.
+class StatementEngine
+{
+    public:
+
+        explicit StatementEngine(const StatementOptions& options);
+
+        StatementReport run(Bank& bank);
+
+    private:
+
+        std::string shardPath(unsigned shard) const;
+
+        StatementOptions myOptions;
+};
+
+#endif // STATEMENT_ENGINE_HXX
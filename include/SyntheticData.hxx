@@ -0,0 +1,119 @@
+#ifndef SYNTHETIC_DATA_HXX
+#define SYNTHETIC_DATA_HXX
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+// Small, fast, seedable generator (SplitMix64). Cheap enough to create one
+// per account, which keeps generated data independent of thread count.
+class SplitMix64
+{
+    public:
+
+        using result_type = std::uint64_t;
+
+        explicit SplitMix64(std::uint64_t seed) noexcept : myState(seed) {}
+
+        static constexpr result_type min() { return (0); }
+        static constexpr result_type max() { return (std::numeric_limits<result_type>::max()); }
+
+        result_type operator()() noexcept
+        {
+            std::uint64_t z = (myState += 0x9e3779b97f4a7c15ULL);
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+            return (z ^ (z >> 31));
+        }
+
+        // Uniform in [0, 1)
+        double uniform() noexcept
+        {
+            return (static_cast<double>((*this)() >> 11) * (1.0 / 9007199254740992.0));
+        }
+
+    private:
+
+        std::uint64_t myState;
+};
+
+// Zipf distribution over 1..n with exponent s > 0, sampled in O(1) by
+// rejection-inversion (Hoermann and Derflinger), so n can be in the millions.
+class ZipfDistribution
+{
+    public:
+
+        ZipfDistribution(std::uint64_t n, double exponent) noexcept :
+            myN(n == 0 ? 1 : n),
+            myExponent(exponent),
+            myHIntegralX1(hIntegral(1.5) - 1.0),
+            myHIntegralN(hIntegral(static_cast<double>(myN) + 0.5)),
+            myS(2.0 - hIntegralInverse(hIntegral(2.5) - h(2.0)))
+        {
+        }
+
+        std::uint64_t operator()(SplitMix64& rng) const noexcept
+        {
+            for (;;)
+            {
+                double u = myHIntegralN + rng.uniform() * (myHIntegralX1 - myHIntegralN);
+                double x = hIntegralInverse(u);
+                double k = std::floor(x + 0.5);
+                if (k < 1.0)
+                {
+                    k = 1.0;
+                }
+                else if (k > static_cast<double>(myN))
+                {
+                    k = static_cast<double>(myN);
+                }
+                if ((k - x <= myS) || (u >= hIntegral(k + 0.5) - h(k)))
+                {
+                    return (static_cast<std::uint64_t>(k));
+                }
+            }
+        }
+
+    private:
+
+        double h(double x) const noexcept
+        {
+            return (std::exp(-myExponent * std::log(x)));
+        }
+
+        double hIntegral(double x) const noexcept
+        {
+            double logX = std::log(x);
+            return (helper2((1.0 - myExponent) * logX) * logX);
+        }
+
+        double hIntegralInverse(double x) const noexcept
+        {
+            double t = x * (1.0 - myExponent);
+            if (t < -1.0)
+            {
+                t = -1.0;
+            }
+            return (std::exp(helper1(t) * x));
+        }
+
+        // log1p(x) / x, stable near zero
+        static double helper1(double x) noexcept
+        {
+            return (std::fabs(x) > 1e-8 ? std::log1p(x) / x : 1.0 - x * (0.5 - x * (1.0 / 3.0 - 0.25 * x)));
+        }
+
+        // expm1(x) / x, stable near zero
+        static double helper2(double x) noexcept
+        {
+            return (std::fabs(x) > 1e-8 ? std::expm1(x) / x : 1.0 + x * 0.5 * (1.0 + x * (1.0 / 3.0) * (1.0 + 0.25 * x)));
+        }
+
+        std::uint64_t myN;
+        double myExponent;
+        double myHIntegralX1;
+        double myHIntegralN;
+        double myS;
+};
+
+#endif // SYNTHETIC_DATA_HXX
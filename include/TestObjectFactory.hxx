@@ -1,5 +1,27 @@
+#ifndef TEST_OBJECT_FACTORY_HXX
+#define TEST_OBJECT_FACTORY_HXX
+
+#include <cstdint>
+#include <string>
+
+#include "TransactionView.hxx"
+
 class Bank;
 
+// Shape of a generated bank. Ledger lengths follow a Zipf distribution, so
+// most accounts are quiet and a few are very active; which accounts are hot
+// is scattered across account numbers by the seed.
+struct SyntheticBankSpec
+{
+    int accounts = 1000;
+    std::uint64_t seed = 1;
+    int maxLedgerLength = 1000;
+    double ledgerSkew = 1.5;
+    LedgerTime firstTime = 1704067200000000;    // 2024-01-01 00:00 UTC
+    double meanGap = 3600e6;                    // microseconds between entries
+    unsigned threads = 0;   // 0 = one per hardware thread
+};
+
 class TestObjectFactory {
   private:
         TestObjectFactory() {};
@@ -7,9 +29,24 @@ class TestObjectFactory {
         ~TestObjectFactory() {};
         Bank* bankWithTwoAccounts();
 
+        // Deterministic for a given spec, whatever the thread count.
+        // Account n gets password passwordFor(n).
+        Bank* syntheticBank(const SyntheticBankSpec& spec);
+        static std::string passwordFor(int accountNumber);
+
+        // Binary snapshot of accounts, passwords, balances and ledgers.
+        // The bank must not be modified while it is saved.
+        bool saveBank(Bank& bank, const std::string& path);
+
+        // nullptr if the file is missing, truncated or holds lengths it
+        // is too short for
+        Bank* loadBank(const std::string& path);
+
   static TestObjectFactory* getInstance();
 
   private:
         static TestObjectFactory* theInstance;
 
 };
+
+#endif // TEST_OBJECT_FACTORY_HXX
@@ -0,0 +1,73 @@
+#ifndef TRACE_HXX
+#define TRACE_HXX
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+
+// Span tracing for the request pipeline, exported as Chrome trace JSON
+// (chrome://tracing, https://ui.perfetto.dev).
+//
+// Each thread records completed spans into its own fixed-size ring buffer,
+// overwriting the oldest spans when it is full. Instrumentation points are
+// compiled in with ATM_ENABLE_TRACING (CMake option ATM_TRACING); at run time
+// they cost one relaxed load until Trace::setEnabled(true) is called.
+class Trace
+{
+    public:
+
+        static const std::size_t EVENTS_PER_THREAD = 16384;
+
+        static void setEnabled(bool enabled) noexcept;
+        static bool enabled() noexcept { return (theEnabled.load(std::memory_order_relaxed)); }
+
+        // `name` must have static storage duration (a string literal)
+        static void record(const char* name, std::uint64_t startNs, std::uint64_t durationNs) noexcept;
+        static std::uint64_t now() noexcept;
+
+        static void writeChromeJson(std::ostream& out);
+        static void clear();
+
+    private:
+
+        static std::atomic<bool> theEnabled;
+};
+
+class TraceSpan
+{
+    public:
+
+        explicit TraceSpan(const char* name) noexcept :
+            myName(Trace::enabled() ? name : nullptr),
+            myStart(myName ? Trace::now() : 0)
+        {
+        }
+
+        ~TraceSpan() noexcept
+        {
+            if (myName)
+            {
+                Trace::record(myName, myStart, Trace::now() - myStart);
+            }
+        }
+
+    private:
+
+        TraceSpan(const TraceSpan&) = delete;
+        TraceSpan& operator=(const TraceSpan&) = delete;
+
+        const char* myName;
+        std::uint64_t myStart;
+};
+
+#define ATM_TRACE_CONCAT_(a, b) a##b
+#define ATM_TRACE_CONCAT(a, b) ATM_TRACE_CONCAT_(a, b)
+
+#if defined(ATM_ENABLE_TRACING) && ATM_ENABLE_TRACING
+#define ATM_TRACE_SPAN(name) TraceSpan ATM_TRACE_CONCAT(atmTraceSpan_, __LINE__)(name)
+#else
+#define ATM_TRACE_SPAN(name) ((void)0)
+#endif
+
+#endif // TRACE_HXX
@@ -0,0 +1,74 @@
+#ifndef TRANSACTION_QUERY_HXX
+#define TRANSACTION_QUERY_HXX
+
+#include "TransactionView.hxx"
+#include "UserRequest.hxx"
+
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+class Bank;
+
+// "All withdrawals over 500 in the last 100 entries of each account":
+//
+//     TransactionQuery query;
+//     query.requestTypes = requestBit(UserRequest::REQUEST_WITHDRAW);
+//     query.minAmount = 500.0;
+//     query.lastEntries = 100;
+//     query.topK = 20;
+struct TransactionQuery
+{
+    unsigned requestTypes = POSTING_REQUESTS;
+    double minAmount = -std::numeric_limits<double>::infinity();   // inclusive
+    double maxAmount = std::numeric_limits<double>::infinity();    // inclusive
+
+    // Only entries posted within the period; each ledger's time index
+    // finds them without scanning the rest
+    TimeRange period;
+
+    // Only the newest N entries of each ledger (of the period, if set);
+    // 0 = all of them
+    std::size_t lastEntries = 0;
+
+    bool groupByAccount = false;
+    std::size_t topK = 0;           // largest matching amounts, bank-wide
+
+    unsigned threads = 0;           // 0 = one per hardware thread
+};
+
+struct QueryMatch
+{
+    int account;
+    std::size_t entry;              // position in the account's ledger
+    UserRequest type;
+    double amount;
+};
+
+struct AccountAggregate
+{
+    int account;
+    std::size_t count;
+    double sum;
+};
+
+struct QueryResult
+{
+    std::size_t accounts = 0;       // accounts scanned
+    std::size_t entries = 0;        // ledger entries scanned
+    std::size_t count = 0;          // entries matched
+    double sum = 0.0;               // of matched amounts, exact then rounded
+
+    // groupByAccount: accounts with at least one match, in account order
+    std::vector<AccountAggregate> groups;
+
+    // topK: by amount, largest first; ties in account and entry order
+    std::vector<QueryMatch> top;
+};
+
+// Scans every account in parallel. Each account is locked only while its
+// own ledger is scanned, so ATM traffic keeps flowing; results reflect
+// each account as of the moment it was scanned.
+QueryResult runQuery(const Bank& bank, const TransactionQuery& query);
+
+#endif // TRANSACTION_QUERY_HXX
@@ -0,0 +1,93 @@
+#ifndef TRANSACTION_VIEW_HXX
+#define TRANSACTION_VIEW_HXX
+
+#include "UserRequest.hxx"
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <tuple>
+
+// One ledger entry: request type and amount
+using Transaction = std::tuple<UserRequest, double>;
+
+// When a ledger entry was posted: microseconds since the Unix epoch. Each
+// account's entry times never decrease; 0 means the time is unknown, e.g.
+// for entries restored from a snapshot that did not record times.
+using LedgerTime = std::int64_t;
+
+// Half-open interval [from, to) of ledger times; the default covers all time
+struct TimeRange
+{
+    LedgerTime from = std::numeric_limits<LedgerTime>::min();
+    LedgerTime to = std::numeric_limits<LedgerTime>::max();
+
+    bool contains(LedgerTime time) const { return ((time >= from) && (time < to)); }
+};
+
+// Non-owning view of a contiguous run of ledger entries. A view obtained
+// from an Account is valid until the account's ledger is next modified,
+// and carries the entries' times alongside.
+class TransactionView
+{
+    public:
+
+        using const_iterator = const Transaction*;
+
+        TransactionView() noexcept : myFirst(nullptr), mySize(0), myTimes(nullptr) {}
+        TransactionView(const Transaction* first, std::size_t size, const LedgerTime* times = nullptr) noexcept :
+            myFirst(first), mySize(size), myTimes(times) {}
+
+        const_iterator begin() const { return (myFirst); }
+        const_iterator end() const { return (myFirst + mySize); }
+        std::size_t size() const { return (mySize); }
+        bool empty() const { return (mySize == 0); }
+        const Transaction& operator[](std::size_t i) const { return (myFirst[i]); }
+
+        // Time of entry i; 0 for views built without times
+        bool hasTimes() const { return (myTimes != nullptr); }
+        LedgerTime time(std::size_t i) const { return (myTimes ? myTimes[i] : 0); }
+        const LedgerTime* times() const { return (myTimes); }
+
+        // Entries [offset, offset + count), clamped to the view
+        TransactionView subview(std::size_t offset, std::size_t count) const
+        {
+            if (offset > mySize)
+            {
+                offset = mySize;
+            }
+            if (count > mySize - offset)
+            {
+                count = mySize - offset;
+            }
+            return (TransactionView(myFirst + offset, count, myTimes ? myTimes + offset : nullptr));
+        }
+
+        // Pages of pageSize entries; the last page may be shorter. A page
+        // size of 0 gives no pages, and a page past the last is empty.
+        std::size_t pageCount(std::size_t pageSize) const
+        {
+            if (pageSize == 0)
+            {
+                return (0);
+            }
+            return (mySize / pageSize + ((mySize % pageSize) != 0));
+        }
+
+        TransactionView page(std::size_t index, std::size_t pageSize) const
+        {
+            if (index >= pageCount(pageSize))
+            {
+                return (subview(mySize, 0));
+            }
+            return (subview(index * pageSize, pageSize));
+        }
+
+    private:
+
+        const Transaction* myFirst;
+        std::size_t mySize;
+        const LedgerTime* myTimes;
+};
+
+#endif // TRANSACTION_VIEW_HXX
@@ -0,0 +1,25 @@
+#ifndef USER_REQUEST_HXX
+#define USER_REQUEST_HXX
+
+// C++11 enum class
+enum class UserRequest {
+    REQUEST_INVALID = 0,
+    REQUEST_BALANCE = 1,
+    REQUEST_DEPOSIT,
+    REQUEST_WITHDRAW,
+    REQUEST_TRANSACTIONS,
+    // Ledger only: stands in for entries trimmed from the front of a
+    // ledger, with their signed total as its amount
+    REQUEST_CARRY_FORWARD,
+};
+
+// Bit for `request` in a set of request types
+inline constexpr unsigned requestBit(UserRequest request)
+{
+    return (1u << static_cast<unsigned>(request));
+}
+
+// Ledger entries that move money
+const unsigned POSTING_REQUESTS = requestBit(UserRequest::REQUEST_DEPOSIT) | requestBit(UserRequest::REQUEST_WITHDRAW);
+
+#endif // USER_REQUEST_HXX
@@ -1,46 +1,432 @@
 #include "Account.hxx"
-#include "ATM.hxx"
+#include "UserRequest.hxx"
 #include "BaseDisplay.hxx"
+#include "MemoryBudget.hxx"
+#include "Trace.hxx"
 
+#include <chrono>
+#include <ctime>
 #include <utility>
 
+namespace
+{
+    LedgerTime wallClock()
+    {
+#ifdef CLOCK_REALTIME_COARSE
+        // A few milliseconds of resolution is plenty for ledger times and
+        // much cheaper to read than the precise clock
+        struct timespec now;
+        if (::clock_gettime(CLOCK_REALTIME_COARSE, &now) == 0)
+        {
+            return (static_cast<LedgerTime>(now.tv_sec) * 1000000 + now.tv_nsec / 1000);
+        }
+#endif
+        return (std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count());
+    }
+}
+
+const std::size_t Account::TIME_BLOCK;
+std::atomic<Account::Clock> Account::theClock{&wallClock};
+
+void Account::setClock(Clock clock)
+{
+    theClock.store(clock ? clock : &wallClock, std::memory_order_release);
+}
+
+LedgerTime Account::now()
+{
+    return (theClock.load(std::memory_order_acquire)());
+}
+
 // C++11/14: move constructor
-Account::Account(Account&& a):
-    myAccountNumber(a.myAccountNumber),
-    myBalance(a.myBalance),
-    myPassword(std::move(a.myPassword)),
-    myTransactions(std::move(a.myTransactions))
+Account::Account(Account&& a)
 {
+    std::lock_guard<std::mutex> lock(a.myMutex);
+    myAccountNumber = a.myAccountNumber;
+    myBalance = a.myBalance;
+    myPassword = std::move(a.myPassword);
+    myTransactions = std::move(a.myTransactions);
+    myTimes = std::move(a.myTimes);
+    myTimeBlocks = std::move(a.myTimeBlocks);
+    myFold = a.myFold;
+    myTrimmedBefore.store(a.myTrimmedBefore.load());
+    mySink.store(a.mySink.load());
+    a.reportMemory();
+}
 
+Account::~Account()
+{
+    detachMemory();
 }
 
 Account::Account(double initial): myBalance(initial)
 {
 	if (initial) { // parasoft-suppress MISRACPP2023-7_0_2-a "ok in this case"
-	    myTransactions.emplace_back(UserRequest::REQUEST_DEPOSIT, initial);
+	    appendEntry(UserRequest::REQUEST_DEPOSIT, initial, now());
 	} else {
-	    myTransactions.emplace_back(UserRequest::REQUEST_WITHDRAW, initial);
+	    appendEntry(UserRequest::REQUEST_WITHDRAW, initial, now());
 	}
 }
 
+void Account::appendEntry(UserRequest type, double amount, LedgerTime time)
+{
+    if (!myTimes.empty() && (time < myTimes.back()))
+    {
+        time = myTimes.back();
+    }
+
+    if (myTransactions.size() % TIME_BLOCK == 0)
+    {
+        myTimeBlocks.push_back(TimeBlock{time, time, myFold});
+    }
+    else
+    {
+        myTimeBlocks.back().last = time;
+    }
+
+    myTransactions.emplace_back(type, amount);
+    myTimes.push_back(time);
+    if ((type == UserRequest::REQUEST_DEPOSIT) || (type == UserRequest::REQUEST_CARRY_FORWARD))
+    {
+        myFold += amount;
+    }
+    else if (type == UserRequest::REQUEST_WITHDRAW)
+    {
+        myFold -= amount;
+    }
+}
+
+void Account::restore(double balance, std::vector<Transaction> transactions, std::vector<LedgerTime> times)
+{
+    std::lock_guard<std::mutex> lock(myMutex);
+    myRestores++;
+    myBalance = balance;
+    myTransactions = std::move(transactions);
+    myTimes = std::move(times);
+    myTimes.resize(myTransactions.size(), 0);
+    myTrimmedBefore.store(carried(), std::memory_order_relaxed);
+    rebuildTimeIndex();
+    reportMemory();
+}
+
+void Account::rebuildTimeIndex()
+{
+    myTimeBlocks.clear();
+    myTimeBlocks.reserve((myTransactions.size() + TIME_BLOCK - 1) / TIME_BLOCK);
+    myFold = 0.0;
+    for (std::size_t i = 0; i < myTransactions.size(); i++)
+    {
+        if ((i != 0) && (myTimes[i] < myTimes[i - 1]))
+        {
+            myTimes[i] = myTimes[i - 1];
+        }
+
+        if (i % TIME_BLOCK == 0)
+        {
+            myTimeBlocks.push_back(TimeBlock{myTimes[i], myTimes[i], myFold});
+        }
+        else
+        {
+            myTimeBlocks.back().last = myTimes[i];
+        }
+
+        const UserRequest type = std::get<0>(myTransactions[i]);
+        if ((type == UserRequest::REQUEST_DEPOSIT) || (type == UserRequest::REQUEST_CARRY_FORWARD))
+        {
+            myFold += std::get<1>(myTransactions[i]);
+        }
+        else if (type == UserRequest::REQUEST_WITHDRAW)
+        {
+            myFold -= std::get<1>(myTransactions[i]);
+        }
+    }
+}
+
+std::size_t Account::lowerBound(LedgerTime time) const
+{
+    // The first block that ends at or after `time` holds the answer,
+    // unless no block does
+    auto block = std::lower_bound(myTimeBlocks.begin(), myTimeBlocks.end(), time,
+        [](const TimeBlock& b, LedgerTime t)
+        {
+            return (b.last < t);
+        });
+    if (block == myTimeBlocks.end())
+    {
+        return (myTransactions.size());
+    }
+
+    const std::size_t first = static_cast<std::size_t>(block - myTimeBlocks.begin()) * TIME_BLOCK;
+    const std::size_t last = std::min(first + TIME_BLOCK, myTimes.size());
+    return (static_cast<std::size_t>(
+        std::lower_bound(myTimes.begin() + first, myTimes.begin() + last, time) - myTimes.begin()));
+}
+
+std::pair<std::size_t, std::size_t> Account::entryRange(const TimeRange& period, std::size_t from) const
+{
+    const std::size_t offset = positionOffset();
+    std::size_t first = std::min(std::max(from, offset + carried()) - offset, myTransactions.size());
+    if (period.from != TimeRange().from)
+    {
+        first = std::max(first, lowerBound(period.from));
+    }
+
+    std::size_t last = myTransactions.size();
+    if (period.to != TimeRange().to)
+    {
+        last = std::max(first, lowerBound(period.to));
+    }
+    return (std::make_pair(first, last));
+}
+
+double Account::balanceBefore(std::size_t index) const
+{
+    const std::size_t block = index / TIME_BLOCK;
+    if (block >= myTimeBlocks.size())
+    {
+        return (myFold);
+    }
+
+    double balance = myTimeBlocks[block].opening;
+    for (std::size_t i = block * TIME_BLOCK; i < index; i++)
+    {
+        const UserRequest type = std::get<0>(myTransactions[i]);
+        if ((type == UserRequest::REQUEST_DEPOSIT) || (type == UserRequest::REQUEST_CARRY_FORWARD))
+        {
+            balance += std::get<1>(myTransactions[i]);
+        }
+        else if (type == UserRequest::REQUEST_WITHDRAW)
+        {
+            balance -= std::get<1>(myTransactions[i]);
+        }
+    }
+    return (balance);
+}
+
 double Account::deposit(double amount)
 {
-    myTransactions.emplace_back(UserRequest::REQUEST_DEPOSIT, amount);
+    ATM_TRACE_SPAN("Account::deposit");
+    const LedgerTime time = now();
+    std::lock_guard<std::mutex> lock(myMutex);
+    appendEntry(UserRequest::REQUEST_DEPOSIT, amount, time);
 
     myBalance += amount;
-    return (getBalance());
+    notify(UserRequest::REQUEST_DEPOSIT, amount);
+    reportMemory();
+    return (myBalance);
 }
 
 
 double Account::debit(double amount)
 {
-    myTransactions.emplace_back(UserRequest::REQUEST_WITHDRAW, amount);
+    ATM_TRACE_SPAN("Account::debit");
+    const LedgerTime time = now();
+    std::lock_guard<std::mutex> lock(myMutex);
+    appendEntry(UserRequest::REQUEST_WITHDRAW, amount, time);
+    myBalance -= amount;
+    notify(UserRequest::REQUEST_WITHDRAW, amount);
+    reportMemory();
+    return (myBalance);
+}
+
+double Account::transferTo(Account& to, double amount)
+{
+    if (&to == this)
+    {
+        return (getBalance());
+    }
+
+    // Both sides of a transfer carry the same time
+    const LedgerTime time = now();
+
+    // C++11: deadlock-free locking of both accounts
+    std::unique_lock<std::mutex> fromLock(myMutex, std::defer_lock);
+    std::unique_lock<std::mutex> toLock(to.myMutex, std::defer_lock);
+    std::lock(fromLock, toLock);
+
+    appendEntry(UserRequest::REQUEST_WITHDRAW, amount, time);
     myBalance -= amount;
-    return (getBalance());
+    to.appendEntry(UserRequest::REQUEST_DEPOSIT, amount, time);
+    to.myBalance += amount;
+    notify(UserRequest::REQUEST_WITHDRAW, amount);
+    to.notify(UserRequest::REQUEST_DEPOSIT, amount);
+    reportMemory();
+    to.reportMemory();
+    return (myBalance);
+}
+
+double Account::appendPostings(const Transaction* entries, std::size_t count)
+{
+    return (appendPostings(entries, nullptr, count));
+}
+
+double Account::appendPostings(const Transaction* entries, const LedgerTime* times, std::size_t count)
+{
+    const LedgerTime time = times ? 0 : now();
+    std::lock_guard<std::mutex> lock(myMutex);
+    for (std::size_t i = 0; i < count; i++)
+    {
+        appendEntry(std::get<0>(entries[i]), std::get<1>(entries[i]), times ? times[i] : time);
+        if (std::get<0>(entries[i]) == UserRequest::REQUEST_DEPOSIT)
+        {
+            myBalance += std::get<1>(entries[i]);
+            notify(UserRequest::REQUEST_DEPOSIT, std::get<1>(entries[i]));
+        }
+        else if (std::get<0>(entries[i]) == UserRequest::REQUEST_WITHDRAW)
+        {
+            myBalance -= std::get<1>(entries[i]);
+            notify(UserRequest::REQUEST_WITHDRAW, std::get<1>(entries[i]));
+        }
+        else if (std::get<0>(entries[i]) == UserRequest::REQUEST_CARRY_FORWARD)
+        {
+            myBalance += std::get<1>(entries[i]);
+        }
+    }
+    reportMemory();
+    return (myBalance);
+}
+
+std::size_t Account::compactLedger()
+{
+    std::lock_guard<std::mutex> lock(myMutex);
+    const std::size_t before = footprint().ledgerBytes;
+    myTransactions.shrink_to_fit();
+    myTimes.shrink_to_fit();
+    myTimeBlocks.shrink_to_fit();
+    reportMemory();
+    return (before - footprint().ledgerBytes);
+}
+
+std::size_t Account::trimLedger(std::size_t keep, const std::function<bool(const TransactionView&)>& spill)
+{
+    std::unique_lock<std::mutex> lock(myMutex);
+    if (myTrimming || (myTransactions.size() <= keep + 1))
+    {
+        return (0);
+    }
+    const std::size_t cut = myTransactions.size() - keep;
+
+    // A carry-forward can only be the first entry, left by an earlier
+    // trim; what it stands for has already been spilled
+    const std::size_t carry = carried();
+    if (spill)
+    {
+        // Spilled from a copy, without the lock, so postings do not wait
+        // on the disk. Postings only append and myTrimming keeps other
+        // trims out, so entries before `cut` stay put unless restore()
+        // replaces the ledger meanwhile; the trim is then abandoned.
+        const std::vector<Transaction> dropped(myTransactions.begin() + carry, myTransactions.begin() + cut);
+        const std::vector<LedgerTime> droppedTimes(myTimes.begin() + carry, myTimes.begin() + cut);
+        const std::size_t restores = myRestores;
+        myTrimming = true;
+        lock.unlock();
+        const bool spilled = spill(TransactionView(dropped.data(), dropped.size(), droppedTimes.data()));
+        lock.lock();
+        myTrimming = false;
+        if (!spilled || (myRestores != restores))
+        {
+            return (0);
+        }
+    }
+
+    // Rebuilt rather than erased from, so the old buffers are freed
+    std::vector<Transaction> transactions;
+    std::vector<LedgerTime> times;
+    transactions.reserve(keep + 1);
+    times.reserve(keep + 1);
+    transactions.emplace_back(UserRequest::REQUEST_CARRY_FORWARD, balanceBefore(cut));
+    times.push_back(myTimes[cut - 1]);
+    transactions.insert(transactions.end(), myTransactions.begin() + cut, myTransactions.end());
+    times.insert(times.end(), myTimes.begin() + cut, myTimes.end());
+
+    myTrimmedBefore.store(positionOffset() + cut, std::memory_order_relaxed);
+    myTransactions.swap(transactions);
+    myTimes.swap(times);
+    std::vector<TimeBlock>().swap(myTimeBlocks);
+    rebuildTimeIndex();
+    reportMemory();
+    return (cut - carry);
+}
+
+void Account::setMemoryTracker(MemoryTracker* tracker)
+{
+    std::lock_guard<std::mutex> lock(myMutex);
+    detachMemory();
+    myTracker = tracker;
+    reportMemory();
+}
+
+Account::Footprint Account::footprint() const
+{
+    // Short passwords live inside the string object itself
+    static const std::size_t inlineCapacity = std::string().capacity();
+
+    Footprint current;
+    current.ledgerBytes = myTransactions.capacity() * sizeof(Transaction)
+        + myTimes.capacity() * sizeof(LedgerTime) + myTimeBlocks.capacity() * sizeof(TimeBlock);
+    current.usedBytes = myTransactions.size() * sizeof(Transaction)
+        + myTimes.size() * sizeof(LedgerTime) + myTimeBlocks.size() * sizeof(TimeBlock);
+    current.entries = myTransactions.size();
+    current.credentialBytes = (myPassword.capacity() > inlineCapacity) ? myPassword.capacity() + 1 : 0;
+    return (current);
+}
+
+void Account::reportMemory()
+{
+    if (!myTracker)
+    {
+        return;
+    }
+
+    const Footprint current = footprint();
+    if (current.ledgerBytes != myReported.ledgerBytes)
+    {
+        myTracker->addBytes(MemoryTracker::LEDGER,
+            static_cast<std::int64_t>(current.ledgerBytes) - static_cast<std::int64_t>(myReported.ledgerBytes));
+    }
+    if (current.credentialBytes != myReported.credentialBytes)
+    {
+        myTracker->addBytes(MemoryTracker::CREDENTIALS,
+            static_cast<std::int64_t>(current.credentialBytes) - static_cast<std::int64_t>(myReported.credentialBytes));
+    }
+    if ((current.usedBytes != myReported.usedBytes) || (current.entries != myReported.entries))
+    {
+        myTracker->addUsage(myAccountNumber,
+            static_cast<std::int64_t>(current.usedBytes) - static_cast<std::int64_t>(myReported.usedBytes),
+            static_cast<std::int64_t>(current.entries) - static_cast<std::int64_t>(myReported.entries));
+    }
+    myReported = current;
+}
+
+void Account::detachMemory()
+{
+    if (myTracker)
+    {
+        myTracker->addBytes(MemoryTracker::LEDGER, -static_cast<std::int64_t>(myReported.ledgerBytes));
+        myTracker->addBytes(MemoryTracker::CREDENTIALS, -static_cast<std::int64_t>(myReported.credentialBytes));
+        myTracker->addUsage(myAccountNumber, -static_cast<std::int64_t>(myReported.usedBytes),
+            -static_cast<std::int64_t>(myReported.entries));
+    }
+    myTracker = nullptr;
+    myReported = Footprint();
 }
 
 int Account::listTransactions(BaseDisplay& display, UserRequest type) {
 
+	std::lock_guard<std::mutex> lock(myMutex);
+	return listEntries(display, type, 0, myTransactions.size());
+}
+
+int Account::listTransactions(BaseDisplay& display, UserRequest type, const TimeRange& period) {
+
+	std::lock_guard<std::mutex> lock(myMutex);
+	const std::pair<std::size_t, std::size_t> range = entryRange(period, 0);
+	return listEntries(display, type, range.first, range.second);
+}
+
+int Account::listEntries(BaseDisplay& display, UserRequest type, std::size_t first, std::size_t last) {
+
 	int transactionsCount = 0;
 
 	if (display.getType() == BaseDisplay::UNKNOWN) {
@@ -49,21 +435,20 @@ int Account::listTransactions(BaseDisplay& display, UserRequest type) {
 	}
 
 	// C++11/14: for-each statement:
-	for(auto&& tuple : myTransactions) {
+	for(auto&& tuple : ledger().subview(first, last - first)) {
 		display.showBalance(std::get<1>(tuple));
 	}
 
 
+	display.showTransactions(ledger().subview(first, last - first));
+
 	// C++11/14: lambda expression
-	std::for_each(
-			myTransactions.begin(),
-			myTransactions.end(),
-			[display, &transactionsCount, type](std::tuple<UserRequest, double> tuple) mutable
+	transactionsCount = static_cast<int>(std::count_if(
+			myTransactions.begin() + first,
+			myTransactions.begin() + last,
+			[type](const Transaction& tuple)
 			{
-				display.showTransaction(std::get<0>(tuple), std::get<1>(tuple));
-				if (std::get<0>(tuple) == type) {
-				    transactionsCount++;
-				}
-			});
+				return (std::get<0>(tuple) == type);
+			}));
     return transactionsCount;
 }
@@ -0,0 +1,239 @@
+#include "AnomalyDetector.hxx"
+#include "Account.hxx"
+
+#include <algorithm>
+#include <cmath>
+#include <new>
+
+const int AnomalyDetector::MAX_BURST;
+const int AnomalyDetector::PAGE_BITS;
+const std::size_t AnomalyDetector::PAGE_SIZE;
+const std::size_t AnomalyDetector::PAGE_COUNT;
+
+namespace
+{
+    std::uint64_t toNanoseconds(LedgerTime time)
+    {
+        return ((time > 0) ? static_cast<std::uint64_t>(time) * 1000 : 0);
+    }
+
+    std::uint64_t ledgerNanoseconds()
+    {
+        return (toNanoseconds(Account::now()));
+    }
+}
+
+AnomalyDetector::AnomalyDetector(const Config& config, Callback callback) :
+    myConfig(config),
+    myInverseWindow(0.0),
+    myCallback(std::move(callback)),
+    myPages(new std::atomic<State*>[PAGE_COUNT]),
+    myAnomalies(0)
+{
+    myConfig.withdrawalBurst = std::max(2, std::min(myConfig.withdrawalBurst, MAX_BURST));
+    myConfig.windowNs = std::max<std::uint64_t>(myConfig.windowNs, 1);
+    myInverseWindow = 1.0 / static_cast<double>(myConfig.windowNs);
+    if (!myConfig.clock)
+    {
+        myConfig.clock = ledgerNanoseconds;
+    }
+    for (std::size_t i = 0; i < PAGE_COUNT; i++)
+    {
+        myPages[i].store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+AnomalyDetector::~AnomalyDetector() noexcept
+{
+    for (std::size_t i = 0; i < PAGE_COUNT; i++)
+    {
+        delete[] myPages[i].load(std::memory_order_relaxed);
+    }
+    delete[] myPages;
+}
+
+AnomalyDetector::State* AnomalyDetector::stateFor(int account) noexcept
+{
+    const std::size_t index = static_cast<std::size_t>(account);
+    const std::size_t page = index >> PAGE_BITS;
+    if ((account < 0) || (page >= PAGE_COUNT))
+    {
+        return (nullptr);
+    }
+
+    State* states = myPages[page].load(std::memory_order_acquire);
+    if (!states)
+    {
+        // First posting on this page: allocate, and if another thread got
+        // there first use its page instead
+        State* fresh = new (std::nothrow) State[PAGE_SIZE]();
+        if (!fresh)
+        {
+            return (nullptr);
+        }
+        if (myPages[page].compare_exchange_strong(states, fresh, std::memory_order_acq_rel))
+        {
+            states = fresh;
+        }
+        else
+        {
+            delete[] fresh;
+        }
+    }
+    return (states + (index & (PAGE_SIZE - 1)));
+}
+
+const AnomalyDetector::State* AnomalyDetector::findState(int account) const noexcept
+{
+    const std::size_t index = static_cast<std::size_t>(account);
+    const std::size_t page = index >> PAGE_BITS;
+    if ((account < 0) || (page >= PAGE_COUNT))
+    {
+        return (nullptr);
+    }
+    const State* states = myPages[page].load(std::memory_order_acquire);
+    return (states ? states + (index & (PAGE_SIZE - 1)) : nullptr);
+}
+
+AnomalyDetector::Window AnomalyDetector::loadWindow(const State& state) noexcept
+{
+    Window window;
+    window.start = state.windowStart.load(std::memory_order_relaxed);
+    window.postingsNow = state.postingsNow.load(std::memory_order_relaxed);
+    window.postingsBefore = state.postingsBefore.load(std::memory_order_relaxed);
+    window.outflowNow = state.outflowNow.load(std::memory_order_relaxed);
+    window.outflowBefore = state.outflowBefore.load(std::memory_order_relaxed);
+    return (window);
+}
+
+void AnomalyDetector::storeWindow(State& state, const Window& window) noexcept
+{
+    state.windowStart.store(window.start, std::memory_order_relaxed);
+    state.postingsNow.store(window.postingsNow, std::memory_order_relaxed);
+    state.postingsBefore.store(window.postingsBefore, std::memory_order_relaxed);
+    state.outflowNow.store(window.outflowNow, std::memory_order_relaxed);
+    state.outflowBefore.store(window.outflowBefore, std::memory_order_relaxed);
+}
+
+// Fixed windows of windowNs; the previous one is kept for the estimate
+void AnomalyDetector::advanceWindow(Window& window, std::uint64_t now) const noexcept
+{
+    if (now < window.start + myConfig.windowNs)
+    {
+        return;
+    }
+    const bool adjacent = now < window.start + 2 * myConfig.windowNs;
+    window.postingsBefore = adjacent ? window.postingsNow : 0.0;
+    window.outflowBefore = adjacent ? window.outflowNow : 0.0;
+    window.postingsNow = 0.0;
+    window.outflowNow = 0.0;
+    window.start = now - (now - window.start) % myConfig.windowNs;
+}
+
+// Current window plus the part of the previous one the sliding window
+// still overlaps
+double AnomalyDetector::windowed(const Window& window, double now, double before, std::uint64_t time) const noexcept
+{
+    const double elapsed = static_cast<double>(time - window.start) * myInverseWindow;
+    return (now + before * (1.0 - std::min(elapsed, 1.0)));
+}
+
+void AnomalyDetector::onPosting(const Posting& posting) noexcept
+{
+    State* state = stateFor(posting.account);
+    if (!state)
+    {
+        return;
+    }
+
+    // Ledger times are monotonic per account, and already read
+    const std::uint64_t now = toNanoseconds(posting.time);
+    const double flow = (posting.type == UserRequest::REQUEST_WITHDRAW) ? -posting.amount : posting.amount;
+    const double magnitude = std::fabs(flow);
+
+    std::uint64_t postings = state->postings.load(std::memory_order_relaxed);
+    double ewma = state->ewma.load(std::memory_order_relaxed);
+    Window window = loadWindow(*state);
+    if (postings == 0)
+    {
+        window.start = now;
+        ewma = magnitude;
+    }
+    advanceWindow(window, now);
+
+    // Compare against the average before this posting moves it
+    if ((postings >= myConfig.warmupPostings) && (ewma > 0.0)
+        && (magnitude > myConfig.amountFactor * ewma))
+    {
+        raise(AnomalyKind::UNUSUAL_AMOUNT, posting, magnitude / ewma);
+    }
+    ewma += myConfig.ewmaAlpha * (magnitude - ewma);
+
+    postings++;
+    window.postingsNow += 1.0;
+    const double velocity = windowed(window, window.postingsNow, window.postingsBefore, now);
+    if (velocity > myConfig.maxPostingsPerWindow)
+    {
+        raise(AnomalyKind::HIGH_VELOCITY, posting, velocity);
+    }
+
+    if (flow < 0.0)
+    {
+        window.outflowNow += magnitude;
+
+        // Ring of the last MAX_BURST outflow times; the burst fires when
+        // the withdrawalBurst-th most recent is still inside the window
+        const std::uint32_t head = state->outflowHead++;
+        state->outflowTimes[head % MAX_BURST] = now;
+        const int burst = myConfig.withdrawalBurst;
+        if (head + 1 >= static_cast<std::uint32_t>(burst))
+        {
+            const std::uint64_t oldest = state->outflowTimes[(head + 1 - burst) % MAX_BURST];
+            if (now - oldest < myConfig.windowNs)
+            {
+                raise(AnomalyKind::RAPID_WITHDRAWALS, posting, burst);
+            }
+        }
+    }
+
+    storeWindow(*state, window);
+    state->ewma.store(ewma, std::memory_order_relaxed);
+    state->lastSeen.store(now, std::memory_order_relaxed);
+    state->postings.store(postings, std::memory_order_relaxed);
+}
+
+void AnomalyDetector::raise(AnomalyKind kind, const Posting& posting, double observed) noexcept
+{
+    myAnomalies.fetch_add(1, std::memory_order_relaxed);
+    if (myCallback)
+    {
+        try
+        {
+            myCallback(Anomaly{kind, posting, observed});
+        }
+        catch (...)
+        {
+            // A failing consumer must not fail the posting
+        }
+    }
+}
+
+AccountActivity AnomalyDetector::activity(int account) const
+{
+    AccountActivity result;
+    const State* state = findState(account);
+    const std::uint64_t postings = state ? state->postings.load(std::memory_order_relaxed) : 0;
+    if (postings)
+    {
+        const std::uint64_t lastSeen = state->lastSeen.load(std::memory_order_relaxed);
+        const std::uint64_t now = std::max(myConfig.clock(), lastSeen);
+        Window window = loadWindow(*state);
+        advanceWindow(window, now);
+        result.postings = postings;
+        result.lastSeenNs = lastSeen;
+        result.ewmaAmount = state->ewma.load(std::memory_order_relaxed);
+        result.windowPostings = windowed(window, window.postingsNow, window.postingsBefore, now);
+        result.windowOutflow = windowed(window, window.outflowNow, window.outflowBefore, now);
+    }
+    return (result);
+}
@@ -0,0 +1,341 @@
+#include "AsyncDisplay.hxx"
+#include "UserRequest.hxx"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+namespace
+{
+    // Messages ATM shows to the user travel as ids; 0 means inline text
+    const char* const KNOWN_MESSAGES[] = {
+        "Invalid account",
+        "Current Balance",
+        "Updated Balance",
+    };
+
+    std::uint8_t messageIdFor(const char* message)
+    {
+        const std::size_t count = sizeof(KNOWN_MESSAGES) / sizeof(KNOWN_MESSAGES[0]);
+        for (std::size_t i = 0; i < count; i++)
+        {
+            if ((message == KNOWN_MESSAGES[i]) || (std::strcmp(message, KNOWN_MESSAGES[i]) == 0))
+            {
+                return static_cast<std::uint8_t>(i + 1);
+            }
+        }
+        return 0;
+    }
+
+    std::size_t roundUpToPowerOfTwo(std::size_t value)
+    {
+        std::size_t result = 2;
+        while (result < value)
+        {
+            result <<= 1;
+        }
+        return result;
+    }
+}
+
+const std::size_t AsyncDisplay::DEFAULT_CAPACITY;
+const std::size_t AsyncDisplay::TEXT_CAPACITY;
+
+AsyncDisplay::AsyncDisplay(BaseDisplay& backend, std::size_t capacity, OverflowPolicy policy):
+    myBackend(backend),
+    myType(backend.getType()),
+    myPolicy(policy),
+    myMask(roundUpToPowerOfTwo(capacity) - 1),
+    myRing(new Record[myMask + 1]),
+    myEnqueuePos(0),
+    myDequeuePos(0),
+    myDropped(0),
+    myAccepting(true),
+    myStopping(false),
+    myConsumerIdle(false)
+{
+    for (std::size_t i = 0; i <= myMask; i++)
+    {
+        myRing[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    myConsumer = std::thread(&AsyncDisplay::run, this);
+}
+
+AsyncDisplay::~AsyncDisplay() noexcept
+{
+    shutdown();
+}
+
+void AsyncDisplay::showInfoToUser(const char* message)
+{
+    if (!message)
+    {
+        return;
+    }
+
+    std::uint8_t id = messageIdFor(message);
+    if (id != 0)
+    {
+        std::size_t pos;
+        if (Record* record = claim(pos))
+        {
+            record->kind = INFO;
+            record->messageId = id;
+            record->length = 0;
+            publish(record, pos);
+        }
+        return;
+    }
+    pushText(INFO, message, std::strlen(message));
+}
+
+void AsyncDisplay::showBalance(double balance)
+{
+    std::size_t pos;
+    if (Record* record = claim(pos))
+    {
+        record->kind = BALANCE;
+        record->amount = balance;
+        publish(record, pos);
+    }
+}
+
+void AsyncDisplay::showTransaction(UserRequest request, double amount)
+{
+    std::size_t pos;
+    if (Record* record = claim(pos))
+    {
+        record->kind = TRANSACTION;
+        record->request = static_cast<std::uint8_t>(request);
+        record->amount = amount;
+        publish(record, pos);
+    }
+}
+
+BaseDisplay::DisplayType AsyncDisplay::getType()
+{
+    return (myType);
+}
+
+void AsyncDisplay::logError(std::string msg)
+{
+    pushText(ERROR, msg.data(), std::min(msg.size(), TEXT_CAPACITY));
+}
+
+void AsyncDisplay::commit()
+{
+    std::size_t pos;
+    if (Record* record = claim(pos))
+    {
+        record->kind = COMMIT;
+        publish(record, pos);
+    }
+}
+
+void AsyncDisplay::shutdown()
+{
+    bool accepting = true;
+    if (!myAccepting.compare_exchange_strong(accepting, false))
+    {
+        return;
+    }
+
+    myStopping.store(true);
+    {
+        std::lock_guard<std::mutex> lock(myWakeMutex);
+        myWake.notify_one();
+    }
+    myConsumer.join();
+}
+
+// Vyukov-style bounded queue: a cell is free for position pos when its
+// sequence equals pos, and holds a record for the consumer at pos + 1.
+// Only the producer that claims a position changes a free cell, so cells
+// that are free for their positions when the claim succeeds are all ours.
+AsyncDisplay::Record* AsyncDisplay::claim(std::size_t& pos, std::size_t count)
+{
+    pos = myEnqueuePos.load(std::memory_order_relaxed);
+    for (;;)
+    {
+        if (!myAccepting.load(std::memory_order_relaxed))
+        {
+            myDropped.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+
+        Record* record = &myRing[pos & myMask];
+        std::size_t sequence = record->sequence.load(std::memory_order_acquire);
+        std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(sequence - pos);
+        for (std::size_t i = 1; (diff == 0) && (i < count); i++)
+        {
+            // A later cell still in use means the ring is too full
+            sequence = myRing[(pos + i) & myMask].sequence.load(std::memory_order_acquire);
+            diff = static_cast<std::ptrdiff_t>(sequence - (pos + i));
+        }
+
+        if (diff == 0)
+        {
+            if (myEnqueuePos.compare_exchange_weak(pos, pos + count, std::memory_order_seq_cst,
+                                                   std::memory_order_relaxed))
+            {
+                // shutdown() may have stopped accepting after the check
+                // above, and the consumer may be gone already. Seen here
+                // (all seq_cst), the cells are skipped and the call counted
+                // as dropped; not seen, the consumer saw the claim and
+                // waits for it.
+                if (!myAccepting.load(std::memory_order_seq_cst))
+                {
+                    for (std::size_t i = 0; i < count; i++)
+                    {
+                        Record* skipped = &myRing[(pos + i) & myMask];
+                        skipped->kind = SKIP;
+                        publish(skipped, pos + i);
+                    }
+                    myDropped.fetch_add(1, std::memory_order_relaxed);
+                    return nullptr;
+                }
+                return record;
+            }
+        }
+        else if (diff < 0)
+        {
+            // Ring is full
+            if (myPolicy == DROP_NEWEST)
+            {
+                myDropped.fetch_add(1, std::memory_order_relaxed);
+                return nullptr;
+            }
+            std::this_thread::yield();
+            pos = myEnqueuePos.load(std::memory_order_relaxed);
+        }
+        else
+        {
+            pos = myEnqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+void AsyncDisplay::publish(Record* record, std::size_t pos)
+{
+    record->sequence.store(pos + 1, std::memory_order_seq_cst);
+    if (myConsumerIdle.load(std::memory_order_seq_cst))
+    {
+        std::lock_guard<std::mutex> lock(myWakeMutex);
+        myWake.notify_one();
+    }
+}
+
+// Text longer than one record goes in consecutive cells claimed together,
+// PART records and then one of `kind`, so the consumer sees the whole
+// message before any other producer's record
+void AsyncDisplay::pushText(RecordKind kind, const char* text, std::size_t length)
+{
+    length = std::min(length, (myMask + 1) * TEXT_CAPACITY);
+    const std::size_t count = std::max<std::size_t>((length + TEXT_CAPACITY - 1) / TEXT_CAPACITY, 1);
+    std::size_t pos;
+    if (!claim(pos, count))
+    {
+        return;
+    }
+
+    for (std::size_t i = 0; i < count; i++)
+    {
+        const std::size_t chunk = std::min(length, TEXT_CAPACITY);
+        Record* record = &myRing[(pos + i) & myMask];
+        record->kind = (i + 1 < count) ? PART : kind;
+        record->messageId = 0;
+        record->length = static_cast<std::uint8_t>(chunk);
+        std::memcpy(record->text, text, chunk);
+        publish(record, pos + i);
+
+        text += chunk;
+        length -= chunk;
+    }
+}
+
+void AsyncDisplay::run()
+{
+    for (;;)
+    {
+        if (consumeOne())
+        {
+            continue;
+        }
+
+        if (myStopping.load())
+        {
+            // Every claimed cell gets published; wait for stragglers
+            if (myEnqueuePos.load() == myDequeuePos)
+            {
+                break;
+            }
+            std::this_thread::yield();
+            continue;
+        }
+
+        myConsumerIdle.store(true, std::memory_order_seq_cst);
+        if (!consumeOne())
+        {
+            std::unique_lock<std::mutex> lock(myWakeMutex);
+            if (!myStopping.load())
+            {
+                myWake.wait_for(lock, std::chrono::milliseconds(1));
+            }
+        }
+        myConsumerIdle.store(false, std::memory_order_relaxed);
+    }
+
+    myBackend.commit();
+}
+
+bool AsyncDisplay::consumeOne()
+{
+    Record* record = &myRing[myDequeuePos & myMask];
+    if (record->sequence.load(std::memory_order_acquire) != myDequeuePos + 1)
+    {
+        return false;
+    }
+
+    replay(*record);
+    record->sequence.store(myDequeuePos + myMask + 1, std::memory_order_release);
+    myDequeuePos++;
+    return true;
+}
+
+void AsyncDisplay::replay(const Record& record)
+{
+    switch (record.kind)
+    {
+        case INFO:
+            if (record.messageId != 0)
+            {
+                myBackend.showInfoToUser(KNOWN_MESSAGES[record.messageId - 1]);
+            }
+            else
+            {
+                myText.append(record.text, record.length);
+                myBackend.showInfoToUser(myText.c_str());
+                myText.clear();
+            }
+            break;
+        case BALANCE:
+            myBackend.showBalance(record.amount);
+            break;
+        case TRANSACTION:
+            myBackend.showTransaction(static_cast<UserRequest>(record.request), record.amount);
+            break;
+        case ERROR:
+            myText.append(record.text, record.length);
+            myBackend.logError(myText);
+            myText.clear();
+            break;
+        case PART:
+            myText.append(record.text, record.length);
+            break;
+        case COMMIT:
+            myBackend.commit();
+            break;
+        case SKIP:
+            break;
+    }
+}
@@ -1,5 +1,14 @@
 #include "Bank.hxx"
 #include "Account.hxx"
+#include "ExactSum.hxx"
+#include "InterestAccrual.hxx"
+#include "ParallelFor.hxx"
+#include "Trace.hxx"
+
+#include <algorithm>
+#include <functional>
+#include <mutex>
+#include <utility>
 
 Bank::Bank() : myAccounts()
 {
@@ -8,18 +17,30 @@ Bank::Bank() : myAccounts()
 
 Bank::~Bank()
 {
-    // NYI: Clean up account list
+    if (myBudgetWorker.joinable())
+    {
+        myMemory.stopWaiting();
+        myBudgetWorker.join();
+    }
+    for (Account* account : myAccounts)
+    {
+        delete account;
+    }
 }
 
 // Get acount number. Only return valid object if password is correct
-Account* Bank::getAccount(int num, std::string password)
+Account* Bank::getAccount(int num, const std::string& password)
 {
+    ATM_TRACE_SPAN("Bank::getAccount");
     Account* userAccount = nullptr;
-    if (myAccounts.size() > num)
     {
-        userAccount = (Account*)myAccounts[num];
+        std::shared_lock<std::shared_timed_mutex> lock(myMutex);
+        if (myAccounts.size() > num)
+        {
+            userAccount = (Account*)myAccounts[num];
+        }
     }
-    if ((userAccount != nullptr) && (password.compare(userAccount->getPassword()) != 0))
+    if ((userAccount != nullptr) && !userAccount->checkPassword(password))
     {
         // account wrong if account number does not match
         userAccount = NULL;
@@ -34,8 +55,288 @@ Account* Bank::getAccount(int num, std::string password)
 Account* Bank::addAccount()
 {
     Account* userAccount = new Account();
+    std::lock_guard<std::shared_timed_mutex> lock(myMutex);
     userAccount->setAccountNumber(myCurrentAccountNumber++);
+    userAccount->setPostingSink(myPostingSink);
+    userAccount->setMemoryTracker(&myMemory);
+    myMemory.addBytes(MemoryTracker::ACCOUNTS, sizeof(Account));
+    const size_t capacity = myAccounts.capacity();
     myAccounts.push_back(userAccount);
+    reportDirectory(capacity);
+    if (myPostingSink)
+    {
+        myPostingSink->onAccountOpened(userAccount->getAccountNumber());
+    }
     return userAccount;
 }
 
+bool Bank::transfer(int from, int to, double amount)
+{
+    Account* source = nullptr;
+    Account* target = nullptr;
+    {
+        std::shared_lock<std::shared_timed_mutex> lock(myMutex);
+        if ((from < 0) || (to < 0) || (myAccounts.size() <= static_cast<size_t>(std::max(from, to))))
+        {
+            return false;
+        }
+        source = myAccounts[from];
+        target = myAccounts[to];
+    }
+    source->transferTo(*target, amount);
+    return true;
+}
+
+int Bank::accountCount() const
+{
+    std::shared_lock<std::shared_timed_mutex> lock(myMutex);
+    return static_cast<int>(myAccounts.size());
+}
+
+Account* Bank::accountAt(int num) const
+{
+    std::shared_lock<std::shared_timed_mutex> lock(myMutex);
+    if ((num < 0) || (myAccounts.size() <= static_cast<size_t>(num)))
+    {
+        return nullptr;
+    }
+    return myAccounts[num];
+}
+
+void Bank::setPostingSink(PostingSink* sink)
+{
+    std::lock_guard<std::shared_timed_mutex> lock(myMutex);
+    myPostingSink = sink;
+    for (Account* account : myAccounts)
+    {
+        account->setPostingSink(sink);
+    }
+}
+
+void Bank::reserveAccounts(int count)
+{
+    std::lock_guard<std::shared_timed_mutex> lock(myMutex);
+    const size_t capacity = myAccounts.capacity();
+    myAccounts.reserve(myAccounts.size() + static_cast<size_t>(std::max(count, 0)));
+    reportDirectory(capacity);
+}
+
+void Bank::reportDirectory(size_t capacityBefore)
+{
+    if (myAccounts.capacity() != capacityBefore)
+    {
+        myMemory.addBytes(MemoryTracker::DIRECTORY,
+            (static_cast<std::int64_t>(myAccounts.capacity()) - static_cast<std::int64_t>(capacityBefore))
+            * static_cast<std::int64_t>(sizeof(Account*)));
+    }
+}
+
+MemoryStats Bank::memoryStats() const
+{
+    MemoryStats stats = myMemory.stats();
+    stats.accounts = static_cast<size_t>(accountCount());
+    return stats;
+}
+
+void Bank::setMemoryBudget(const MemoryBudget& budget)
+{
+    {
+        std::lock_guard<std::mutex> lock(myBudgetMutex);
+        myBudget = budget;
+        if ((budget.limitBytes != 0) && !myBudgetWorker.joinable())
+        {
+            myBudgetWorker = std::thread([this]()
+            {
+                while (myMemory.awaitPressure())
+                {
+                    enforceMemoryBudget();
+                }
+            });
+        }
+    }
+    myMemory.setHighWater(static_cast<size_t>(static_cast<double>(budget.limitBytes) * budget.highWater));
+}
+
+MemoryBudgetReport Bank::enforceMemoryBudget()
+{
+    std::lock_guard<std::mutex> lock(myBudgetMutex);
+    MemoryBudgetReport report;
+    report.bytesBefore = myMemory.totalBytes();
+    report.bytesAfter = report.bytesBefore;
+    if (myBudget.limitBytes == 0)
+    {
+        return report;
+    }
+
+    const size_t target = static_cast<size_t>(static_cast<double>(myBudget.limitBytes) * myBudget.lowWater);
+    std::vector<Account*> accounts;
+    {
+        std::shared_lock<std::shared_timed_mutex> directoryLock(myMutex);
+        accounts = myAccounts;
+    }
+
+    // Compaction first: it loses nothing
+    for (Account* account : accounts)
+    {
+        if (myMemory.totalBytes() <= target)
+        {
+            break;
+        }
+        if (account->compactLedger() != 0)
+        {
+            report.compactedAccounts++;
+        }
+    }
+
+    // Then trimming, longest ledgers first: they free the most per lock taken
+    const size_t keep = myBudget.keepEntries;
+    std::vector<std::pair<size_t, Account*> > ledgers;
+    if (myMemory.totalBytes() > target)
+    {
+        for (Account* account : accounts)
+        {
+            size_t length = 0;
+            account->withTransactions([&length](const TransactionView& ledger)
+            {
+                length = ledger.size();
+            });
+            if (length > keep + 1)
+            {
+                ledgers.emplace_back(length, account);
+            }
+        }
+        std::stable_sort(ledgers.begin(), ledgers.end(),
+            [](const std::pair<size_t, Account*>& a, const std::pair<size_t, Account*>& b)
+            {
+                return (a.first > b.first);
+            });
+    }
+
+    const std::string& directory = myBudget.spillDirectory;
+    for (const std::pair<size_t, Account*>& ledger : ledgers)
+    {
+        if (myMemory.totalBytes() <= target)
+        {
+            break;
+        }
+        Account* account = ledger.second;
+        const int number = account->getAccountNumber();
+        std::function<bool(const TransactionView&)> spill;
+        if (!directory.empty())
+        {
+            spill = [&](const TransactionView& entries)
+            {
+                if (!spillLedger(directory, number, entries))
+                {
+                    report.spillFailures++;
+                    return (false);
+                }
+                report.spilledEntries += entries.size();
+                return (true);
+            };
+        }
+
+        const size_t trimmed = account->trimLedger(keep, spill);
+        if (trimmed != 0)
+        {
+            report.trimmedAccounts++;
+            report.trimmedEntries += trimmed;
+        }
+    }
+
+    report.bytesAfter = myMemory.totalBytes();
+    report.withinBudget = (report.bytesAfter <= myBudget.limitBytes);
+    return report;
+}
+
+
+AccrualReport Bank::accrueInterest(const AccrualSchedule& schedule, unsigned threads)
+{
+    // Accounts per column: big enough for the kernel, small enough to stay in cache
+    const std::size_t SHARD_SIZE = 4096;
+
+    struct WorkerTotals
+    {
+        AccrualReport report;
+        ExactSum credited;
+        ExactSum debited;
+    };
+
+    const std::size_t count = static_cast<std::size_t>(accountCount());
+    if (threads == 0)
+    {
+        threads = defaultThreadCount();
+    }
+    std::vector<WorkerTotals> workers(threads);
+
+    parallelForRanges(count, threads, [&](unsigned worker, std::size_t begin, std::size_t end)
+    {
+        WorkerTotals& totals = workers[worker];
+        std::vector<Account*> accounts;
+        std::vector<double> balances;
+        std::vector<double> accruals;
+        accounts.reserve(SHARD_SIZE);
+        balances.reserve(SHARD_SIZE);
+        accruals.resize(SHARD_SIZE);
+
+        for (std::size_t shard = begin; shard < end; shard += SHARD_SIZE)
+        {
+            const std::size_t shardEnd = std::min(end, shard + SHARD_SIZE);
+            accounts.clear();
+            balances.clear();
+            {
+                std::shared_lock<std::shared_timed_mutex> lock(myMutex);
+                accounts.assign(myAccounts.begin() + shard, myAccounts.begin() + shardEnd);
+            }
+            for (Account* account : accounts)
+            {
+                balances.push_back(account->getBalance());
+            }
+
+            computeAccruals(balances.data(), accruals.data(), balances.size(), schedule);
+
+            // Each accrual is posted against the balance as it stands under
+            // the account's lock; one that moved since it was gathered is
+            // recomputed on its own
+            const LedgerTime time = Account::now();
+            for (std::size_t i = 0; i < accounts.size(); i++)
+            {
+                const double accrual = accounts[i]->postAdjustment(time, [&](double balance)
+                {
+                    double amount = accruals[i];
+                    if (!(balance == balances[i]))
+                    {
+                        computeAccruals(&balance, &amount, 1, schedule);
+                    }
+                    return (amount);
+                });
+                if (accrual > 0.0)
+                {
+                    totals.credited.add(accrual);
+                    totals.report.credits++;
+                }
+                else if (accrual < 0.0)
+                {
+                    totals.debited.add(-accrual);
+                    totals.report.debits++;
+                }
+            }
+            totals.report.accounts += accounts.size();
+        }
+    });
+
+    AccrualReport report;
+    ExactSum credited;
+    ExactSum debited;
+    for (const WorkerTotals& totals : workers)
+    {
+        report.accounts += totals.report.accounts;
+        report.credits += totals.report.credits;
+        report.debits += totals.report.debits;
+        credited.add(totals.credited);
+        debited.add(totals.debited);
+    }
+    report.totalCredited = credited.value();
+    report.totalDebited = debited.value();
+    return (report);
+}
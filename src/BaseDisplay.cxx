@@ -1,9 +1,19 @@
 #include "BaseDisplay.hxx"
-#include "ATM.hxx"
+#include "Format.hxx"
+#include "TransactionView.hxx"
 
 #include <iostream>
 using namespace std;
 
+// Writes " : <amount>" and ends the line
+static void writeAmountLine(double amount)
+{
+    char text[AMOUNT_BUFFER_SIZE + 4] = " : ";
+    char* end = formatAmount(text + 3, text + sizeof(text) - 1, amount).ptr;
+    *end++ = '\n';
+    cout.write(text, end - text);
+}
+
 void BaseDisplay::showInfoToUser(const char* message)
 {
     if (message)
@@ -14,30 +24,28 @@ void BaseDisplay::showInfoToUser(const char* message)
 
 void BaseDisplay::showBalance(double balance)
 {
-    cout << " : " << balance << endl;
+    writeAmountLine(balance);
 }
 
 BaseDisplay::DisplayType BaseDisplay::getType() {return SECURE;}
 void BaseDisplay::logError(std::string msg) {};
 
+void BaseDisplay::commit()
+{
+    cout.flush();
+}
+
 void BaseDisplay::showTransaction(UserRequest request, double amount)
 {
-    switch (request) {
-        case UserRequest::REQUEST_TRANSACTIONS:
-            cout << "REQUEST_TRANSACTIONS";
-            break;
-        case UserRequest::REQUEST_BALANCE:
-            cout << "REQUEST_BALANCE";
-            break;
-        case UserRequest::REQUEST_DEPOSIT:
-            cout << "REQUEST_DEPOSIT";
-            break;
-        case UserRequest::REQUEST_INVALID:
-            cout << "REQUEST_INVALID";
-            break;
-        case UserRequest::REQUEST_WITHDRAW:
-            cout << "REQUEST_WITHDRAW";
-            break;
+    RequestName name = requestName(request);
+    cout.write(name.text, name.length);
+    writeAmountLine(amount);
+}
+
+void BaseDisplay::showTransactions(const TransactionView& transactions)
+{
+    for (const Transaction& transaction : transactions)
+    {
+        showTransaction(std::get<0>(transaction), std::get<1>(transaction));
     }
-    cout << " : " << amount << endl;
 }
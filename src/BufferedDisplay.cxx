@@ -0,0 +1,193 @@
+#include "BufferedDisplay.hxx"
+#include "Format.hxx"
+#include "TransactionView.hxx"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <ostream>
+
+#include <limits.h>
+#include <unistd.h>
+
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+
+const std::size_t BufferedDisplay::BLOCK_SIZE;
+const std::size_t BufferedDisplay::DEFAULT_FLUSH_THRESHOLD;
+
+BufferedDisplay::BufferedDisplay(std::ostream& out, std::size_t flushThreshold):
+    myStream(&out),
+    myFd(-1),
+    myFlushThreshold(flushThreshold)
+{
+}
+
+BufferedDisplay::BufferedDisplay(int fd, std::size_t flushThreshold):
+    myStream(nullptr),
+    myFd(fd),
+    myFlushThreshold(flushThreshold)
+{
+}
+
+BufferedDisplay::~BufferedDisplay() noexcept
+{
+    flush();
+}
+
+void BufferedDisplay::showInfoToUser(const char* message)
+{
+    if (message)
+    {
+        append(message, std::strlen(message));
+    }
+}
+
+void BufferedDisplay::showBalance(double balance)
+{
+    append(" : ", 3);
+    appendAmount(balance);
+    append("\n", 1);
+}
+
+void BufferedDisplay::showTransaction(UserRequest request, double amount)
+{
+    appendTransaction(request, amount);
+}
+
+void BufferedDisplay::showTransactions(const TransactionView& transactions)
+{
+    for (const Transaction& transaction : transactions)
+    {
+        appendTransaction(std::get<0>(transaction), std::get<1>(transaction));
+    }
+}
+
+void BufferedDisplay::commit()
+{
+    flush();
+    if (myStream)
+    {
+        myStream->flush();
+    }
+}
+
+void BufferedDisplay::append(const char* data, std::size_t length)
+{
+    while (length > 0)
+    {
+        if ((myUsedBlocks == 0) || (myTail == BLOCK_SIZE))
+        {
+            if (myUsedBlocks == myBlocks.size())
+            {
+                myBlocks.emplace_back(new char[BLOCK_SIZE]);
+            }
+            myUsedBlocks++;
+            myTail = 0;
+        }
+
+        std::size_t chunk = std::min(length, BLOCK_SIZE - myTail);
+        std::memcpy(myBlocks[myUsedBlocks - 1].get() + myTail, data, chunk);
+        myTail += chunk;
+        myPending += chunk;
+        data += chunk;
+        length -= chunk;
+    }
+
+    if (myPending >= myFlushThreshold)
+    {
+        flush();
+    }
+}
+
+void BufferedDisplay::appendAmount(double amount)
+{
+    char text[AMOUNT_BUFFER_SIZE];
+    ToCharsResult result = formatAmount(text, text + sizeof(text), amount);
+    append(text, static_cast<std::size_t>(result.ptr - text));
+}
+
+void BufferedDisplay::appendTransaction(UserRequest request, double amount)
+{
+    RequestName name = requestName(request);
+    append(name.text, name.length);
+    append(" : ", 3);
+    appendAmount(amount);
+    append("\n", 1);
+}
+
+void BufferedDisplay::flush()
+{
+    if (myPending == 0)
+    {
+        return;
+    }
+
+    if (myStream)
+    {
+        writeToStream();
+    }
+    else
+    {
+        writeToDescriptor();
+    }
+
+    myUsedBlocks = 0;
+    myTail = 0;
+    myPending = 0;
+}
+
+void BufferedDisplay::writeToStream()
+{
+    for (std::size_t i = 0; i < myUsedBlocks; i++)
+    {
+        std::size_t length = (i + 1 == myUsedBlocks) ? myTail : BLOCK_SIZE;
+        myStream->write(myBlocks[i].get(), static_cast<std::streamsize>(length));
+    }
+    if (!*myStream)
+    {
+        myWriteErrors++;
+        myStream->clear();
+    }
+}
+
+void BufferedDisplay::writeToDescriptor()
+{
+    std::vector<iovec>& iov = myIov;
+    iov.resize(myUsedBlocks);
+    for (std::size_t i = 0; i < myUsedBlocks; i++)
+    {
+        iov[i].iov_base = myBlocks[i].get();
+        iov[i].iov_len = (i + 1 == myUsedBlocks) ? myTail : BLOCK_SIZE;
+    }
+
+    std::size_t first = 0;
+    while (first < iov.size())
+    {
+        int count = static_cast<int>(std::min<std::size_t>(iov.size() - first, IOV_MAX));
+        ssize_t written = ::writev(myFd, &iov[first], count);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            myWriteErrors++;
+            return;
+        }
+
+        // Skip what the kernel accepted; a short write resumes mid-block
+        std::size_t remaining = static_cast<std::size_t>(written);
+        while ((first < iov.size()) && (remaining >= iov[first].iov_len))
+        {
+            remaining -= iov[first].iov_len;
+            first++;
+        }
+        if (remaining > 0)
+        {
+            iov[first].iov_base = static_cast<char*>(iov[first].iov_base) + remaining;
+            iov[first].iov_len -= remaining;
+        }
+    }
+}
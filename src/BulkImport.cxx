@@ -0,0 +1,600 @@
+#include "BulkImport.hxx"
+
+#include "Account.hxx"
+#include "Bank.hxx"
+#include "ParallelFor.hxx"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+    const std::size_t MAX_FIELDS = 4;
+
+    // Exact doubles for the fast decimal path
+    const double POWERS_OF_TEN[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+    struct Field
+    {
+        const char* begin;
+        const char* end;
+
+        std::size_t size() const { return (static_cast<std::size_t>(end - begin)); }
+    };
+
+    // Read-only mapping of a whole input file
+    class MappedInput
+    {
+        public:
+
+            explicit MappedInput(const std::string& path)
+            {
+                int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+                if (fd < 0)
+                {
+                    return;
+                }
+                struct stat info;
+                if (::fstat(fd, &info) == 0)
+                {
+                    mySize = static_cast<std::size_t>(info.st_size);
+                    myGood = true;
+                    if (mySize > 0)
+                    {
+                        void* mapping = ::mmap(nullptr, mySize, PROT_READ, MAP_PRIVATE, fd, 0);
+                        if (mapping == MAP_FAILED)
+                        {
+                            myGood = false;
+                        }
+                        else
+                        {
+                            myData = static_cast<const char*>(mapping);
+                            ::madvise(mapping, mySize, MADV_SEQUENTIAL);
+                        }
+                    }
+                }
+                ::close(fd);
+            }
+
+            ~MappedInput()
+            {
+                if (myData)
+                {
+                    ::munmap(const_cast<char*>(myData), mySize);
+                }
+            }
+
+            bool good() const { return (myGood); }
+            const char* data() const { return (myData); }
+            std::size_t size() const { return (myGood ? mySize : 0); }
+
+        private:
+
+            MappedInput(const MappedInput&) = delete;
+            MappedInput& operator=(const MappedInput&) = delete;
+
+            const char* myData = nullptr;
+            std::size_t mySize = 0;
+            bool myGood = false;
+    };
+
+    // Splits the lines from `p` into fields and calls row(fields, count,
+    // line) for every non-blank one; `line` counts from 0 at `p` and count
+    // is MAX_FIELDS + 1 for lines with too many fields. Stops after the
+    // line whose newline is at or past `stop - 1`, or at `end`. Returns the
+    // number of lines seen, blank ones included.
+    template <typename Row>
+    std::size_t scanLines(const char* p, const char* stop, const char* end, Row row)
+    {
+        Field fields[MAX_FIELDS];
+        std::size_t count = 0;
+        std::size_t lines = 0;
+        const char* fieldStart = p;
+
+        auto endField = [&](const char* at)
+        {
+            if (count < MAX_FIELDS)
+            {
+                fields[count] = Field{fieldStart, at};
+            }
+            count++;
+            fieldStart = at + 1;
+        };
+        auto endLine = [&]()
+        {
+            if ((count <= MAX_FIELDS) && (fields[count - 1].end != fields[count - 1].begin)
+                && (fields[count - 1].end[-1] == '\r'))
+            {
+                fields[count - 1].end--;
+            }
+            if ((count > 1) || (fields[0].end != fields[0].begin))
+            {
+                row(static_cast<const Field*>(fields), std::min(count, MAX_FIELDS + 1), lines);
+            }
+            lines++;
+            count = 0;
+        };
+        // True once the line that belongs to the next range is reached
+        auto delimiter = [&](const char* at)
+        {
+            endField(at);
+            if (*at != '\n')
+            {
+                return (false);
+            }
+            endLine();
+            return (at + 1 >= stop);
+        };
+
+        if (p >= stop)
+        {
+            return (0);
+        }
+        const char* cursor = p;
+
+#if defined(__SSE2__)
+        // Sixteen bytes per step: one compare per delimiter, then walk the
+        // set bits of the combined mask
+        const __m128i comma = _mm_set1_epi8(',');
+        const __m128i newline = _mm_set1_epi8('\n');
+        for (; cursor + 16 <= end; cursor += 16)
+        {
+            const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(cursor));
+            unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(
+                _mm_or_si128(_mm_cmpeq_epi8(block, comma), _mm_cmpeq_epi8(block, newline))));
+            while (mask != 0)
+            {
+                const int bit = __builtin_ctz(mask);
+                mask &= mask - 1;
+                if (delimiter(cursor + bit))
+                {
+                    return (lines);
+                }
+            }
+        }
+#endif
+
+        for (; cursor < end; cursor++)
+        {
+            if (((*cursor == ',') || (*cursor == '\n')) && delimiter(cursor))
+            {
+                return (lines);
+            }
+        }
+
+        // Last line of the file, without a newline
+        if ((fieldStart < end) || (count > 0))
+        {
+            endField(end);
+            endLine();
+        }
+        return (lines);
+    }
+
+    bool parseAccountNumber(const Field& field, int& number)
+    {
+        if ((field.size() == 0) || (field.size() > 10))
+        {
+            return (false);
+        }
+        std::int64_t value = 0;
+        for (const char* p = field.begin; p != field.end; p++)
+        {
+            if ((*p < '0') || (*p > '9'))
+            {
+                return (false);
+            }
+            value = value * 10 + (*p - '0');
+        }
+        if (value > INT_MAX)
+        {
+            return (false);
+        }
+        number = static_cast<int>(value);
+        return (true);
+    }
+
+    // Ledger times are whole microseconds since the epoch
+    bool parseTime(const Field& field, LedgerTime& time)
+    {
+        if ((field.size() == 0) || (field.size() > 18))
+        {
+            return (false);
+        }
+        time = 0;
+        for (const char* p = field.begin; p != field.end; p++)
+        {
+            if ((*p < '0') || (*p > '9'))
+            {
+                return (false);
+            }
+            time = time * 10 + (*p - '0');
+        }
+        return (true);
+    }
+
+    // Plain decimals with at most 19 digits and a mantissa below 2^53 are
+    // one exact division, so correctly rounded; anything else (exponents,
+    // long fractions) goes through strtod
+    bool parseAmount(const Field& field, double& amount)
+    {
+        const char* p = field.begin;
+        bool negative = false;
+        if ((p != field.end) && ((*p == '-') || (*p == '+')))
+        {
+            negative = (*p == '-');
+            p++;
+        }
+
+        std::uint64_t mantissa = 0;
+        int digits = 0;
+        int fractionDigits = 0;
+        bool dot = false;
+        bool simple = true;
+        for (; p != field.end; p++)
+        {
+            if ((*p >= '0') && (*p <= '9'))
+            {
+                mantissa = mantissa * 10 + static_cast<std::uint64_t>(*p - '0');
+                digits++;
+                fractionDigits += dot ? 1 : 0;
+            }
+            else if ((*p == '.') && !dot)
+            {
+                dot = true;
+            }
+            else
+            {
+                simple = false;
+                break;
+            }
+        }
+
+        if (simple && (digits > 0) && (digits <= 19) && (mantissa <= (1ull << 53)) && (fractionDigits <= 22))
+        {
+            const double value = static_cast<double>(mantissa) / POWERS_OF_TEN[fractionDigits];
+            amount = negative ? -value : value;
+            return (true);
+        }
+
+        char buffer[64];
+        if ((field.size() == 0) || (field.size() >= sizeof(buffer)))
+        {
+            return (false);
+        }
+        std::memcpy(buffer, field.begin, field.size());
+        buffer[field.size()] = '\0';
+        char* parsedEnd = nullptr;
+        amount = std::strtod(buffer, &parsedEnd);
+        return ((parsedEnd == buffer + field.size()) && std::isfinite(amount));
+    }
+
+    // Rows and errors of one worker's byte range; lines are local until
+    // the ranges are stitched together
+    template <typename Row>
+    struct ParseWorker
+    {
+        std::size_t lines = 0;
+        std::size_t rows = 0;
+        std::size_t rejected = 0;
+        std::vector<Row> parsed;
+        std::vector<ImportRowError> errors;
+
+        void reject(std::size_t line, const char* reason, std::size_t maxErrors)
+        {
+            rejected++;
+            if (errors.size() < maxErrors)
+            {
+                errors.push_back(ImportRowError{line, reason});
+            }
+        }
+    };
+
+    // Parses the file in parallel. parse(fields, count, row) fills `row`
+    // and returns nullptr, or returns why the line was rejected. Row line
+    // numbers and errors come back 1-based for the whole file.
+    template <typename Row, typename Parse>
+    std::vector<ParseWorker<Row> > parseCsv(const MappedInput& input, const BulkImportOptions& options,
+                                            BulkImportReport& report, Parse parse)
+    {
+        const std::size_t size = input.size();
+        const char* data = input.data();
+        unsigned threads = (options.threads == 0) ? defaultThreadCount() : options.threads;
+        threads = static_cast<unsigned>(std::max<std::size_t>(1, std::min<std::size_t>(threads, size)));
+        std::vector<ParseWorker<Row> > workers(threads);
+
+        if (size > 0)
+        {
+            parallelForRanges(size, threads, [&](unsigned worker, std::size_t begin, std::size_t end)
+            {
+                ParseWorker<Row>& result = workers[worker];
+                // A line belongs to the range holding its first byte
+                const char* p = data + begin;
+                if (begin > 0)
+                {
+                    const void* newline = std::memchr(data + begin - 1, '\n', size - begin + 1);
+                    p = newline ? static_cast<const char*>(newline) + 1 : data + size;
+                }
+                const bool skipHeader = options.header && (begin == 0);
+
+                result.lines = scanLines(p, data + end, data + size,
+                    [&](const Field* fields, std::size_t count, std::size_t line)
+                {
+                    if (skipHeader && (line == 0))
+                    {
+                        return;
+                    }
+                    result.rows++;
+                    Row row;
+                    row.line = line;
+                    const char* reason = parse(fields, count, row);
+                    if (reason)
+                    {
+                        result.reject(line, reason, options.maxErrors);
+                    }
+                    else
+                    {
+                        result.parsed.push_back(row);
+                    }
+                });
+            });
+        }
+
+        std::size_t base = 1;
+        for (ParseWorker<Row>& worker : workers)
+        {
+            for (Row& row : worker.parsed)
+            {
+                row.line += base;
+            }
+            for (ImportRowError& error : worker.errors)
+            {
+                error.line += base;
+                report.errors.push_back(error);
+            }
+            report.rows += worker.rows;
+            report.rejected += worker.rejected;
+            base += worker.lines;
+        }
+        return (workers);
+    }
+
+    void addError(BulkImportReport& report, std::size_t line, const char* reason)
+    {
+        report.rejected++;
+        report.errors.push_back(ImportRowError{line, reason});
+    }
+
+    // Keeps the first maxErrors errors in line order
+    void finishErrors(BulkImportReport& report, std::size_t maxErrors)
+    {
+        std::stable_sort(report.errors.begin(), report.errors.end(),
+            [](const ImportRowError& a, const ImportRowError& b)
+        {
+            return (a.line < b.line);
+        });
+        if (report.errors.size() > maxErrors)
+        {
+            report.errors.resize(maxErrors);
+        }
+    }
+
+    struct AccountRow
+    {
+        std::size_t line;
+        int number;
+        const char* password;
+        std::size_t passwordLength;
+    };
+
+    struct LedgerRow
+    {
+        std::size_t line;
+        int account;
+        UserRequest type;
+        double amount;
+        LedgerTime time;
+    };
+}
+
+BulkImportReport importAccountsCsv(Bank& bank, const std::string& path, const BulkImportOptions& options)
+{
+    BulkImportReport report;
+    MappedInput input(path);
+    if (!input.good())
+    {
+        report.failed = true;
+        return (report);
+    }
+    report.bytes = input.size();
+
+    std::vector<ParseWorker<AccountRow> > workers = parseCsv<AccountRow>(input, options, report,
+        [](const Field* fields, std::size_t count, AccountRow& row) -> const char*
+    {
+        if (count != 2)
+        {
+            return ("expected number,password");
+        }
+        if (!parseAccountNumber(fields[0], row.number))
+        {
+            return ("invalid account number");
+        }
+        if ((fields[1].size() > 0) && (*fields[1].begin == '"'))
+        {
+            return ("quoted fields are not supported");
+        }
+        row.password = fields[1].begin;
+        row.passwordLength = fields[1].size();
+        return (nullptr);
+    });
+
+    // Numbers are only known to be new and unique once every range is in.
+    // A file may skip numbers, but not open more accounts than it has rows.
+    const std::int64_t base = bank.accountCount();
+    const std::int64_t limit = base + static_cast<std::int64_t>(report.rows);
+    std::int64_t highest = base - 1;
+    for (const ParseWorker<AccountRow>& worker : workers)
+    {
+        for (const AccountRow& row : worker.parsed)
+        {
+            if (row.number <= limit)
+            {
+                highest = std::max<std::int64_t>(highest, row.number);
+            }
+        }
+    }
+    std::vector<const AccountRow*> listed(static_cast<std::size_t>(highest - base + 1), nullptr);
+    for (const ParseWorker<AccountRow>& worker : workers)
+    {
+        for (const AccountRow& row : worker.parsed)
+        {
+            if (row.number < base)
+            {
+                addError(report, row.line, "account already exists");
+            }
+            else if (row.number > limit)
+            {
+                addError(report, row.line, "account number too far ahead");
+            }
+            else if (listed[static_cast<std::size_t>(row.number - base)])
+            {
+                addError(report, row.line, "duplicate account");
+            }
+            else
+            {
+                listed[static_cast<std::size_t>(row.number - base)] = &row;
+            }
+        }
+    }
+
+    bank.reserveAccounts(static_cast<int>(listed.size()));
+    std::string password;
+    for (const AccountRow* row : listed)
+    {
+        Account* account = bank.addAccount();
+        if (row)
+        {
+            password.assign(row->password, row->passwordLength);
+            account->setPassword(password.c_str());
+            report.imported++;
+        }
+        else
+        {
+            report.unlistedAccounts++;
+        }
+    }
+    finishErrors(report, options.maxErrors);
+    return (report);
+}
+
+BulkImportReport importLedgerCsv(Bank& bank, const std::string& path, const BulkImportOptions& options)
+{
+    BulkImportReport report;
+    MappedInput input(path);
+    if (!input.good())
+    {
+        report.failed = true;
+        return (report);
+    }
+    report.bytes = input.size();
+
+    // One time for every entry that does not bring its own
+    const LedgerTime importTime = Account::now();
+    const int accounts = bank.accountCount();
+    std::vector<ParseWorker<LedgerRow> > workers = parseCsv<LedgerRow>(input, options, report,
+        [accounts, importTime](const Field* fields, std::size_t count, LedgerRow& row) -> const char*
+    {
+        if ((count != 3) && (count != 4))
+        {
+            return ("expected number,type,amount[,time]");
+        }
+        if (!parseAccountNumber(fields[0], row.account))
+        {
+            return ("invalid account number");
+        }
+        if (row.account >= accounts)
+        {
+            return ("unknown account");
+        }
+        if (fields[1].size() != 1)
+        {
+            return ("unknown entry type");
+        }
+        switch (*fields[1].begin)
+        {
+            case 'D': row.type = UserRequest::REQUEST_DEPOSIT; break;
+            case 'W': row.type = UserRequest::REQUEST_WITHDRAW; break;
+            case 'B': row.type = UserRequest::REQUEST_BALANCE; break;
+            default: return ("unknown entry type");
+        }
+        if (!parseAmount(fields[2], row.amount)
+            || ((row.type != UserRequest::REQUEST_BALANCE) && !(row.amount >= 0.0)))
+        {
+            return ("invalid amount");
+        }
+        row.time = importTime;
+        if ((count == 4) && !parseTime(fields[3], row.time))
+        {
+            return ("invalid time");
+        }
+        return (nullptr);
+    });
+
+    // Group by account, keeping file order within each account
+    std::vector<std::size_t> offsets(static_cast<std::size_t>(accounts) + 1, 0);
+    for (const ParseWorker<LedgerRow>& worker : workers)
+    {
+        for (const LedgerRow& row : worker.parsed)
+        {
+            offsets[row.account + 1]++;
+        }
+    }
+    for (std::size_t i = 1; i < offsets.size(); i++)
+    {
+        offsets[i] += offsets[i - 1];
+    }
+    std::vector<Transaction> entries(offsets.back());
+    std::vector<LedgerTime> times(offsets.back());
+    std::vector<std::size_t> next(offsets.begin(), offsets.end() - 1);
+    for (ParseWorker<LedgerRow>& worker : workers)
+    {
+        for (const LedgerRow& row : worker.parsed)
+        {
+            times[next[row.account]] = row.time;
+            entries[next[row.account]++] = Transaction(row.type, row.amount);
+        }
+        std::vector<LedgerRow>().swap(worker.parsed);
+    }
+
+    parallelForRanges(static_cast<std::size_t>(accounts), options.threads,
+        [&](unsigned, std::size_t begin, std::size_t end)
+    {
+        for (std::size_t account = begin; account < end; account++)
+        {
+            const std::size_t count = offsets[account + 1] - offsets[account];
+            if (count > 0)
+            {
+                bank.accountAt(static_cast<int>(account))->appendPostings(&entries[offsets[account]],
+                    &times[offsets[account]], count);
+            }
+        }
+    });
+    report.imported = entries.size();
+    finishErrors(report, options.maxErrors);
+    return (report);
+}
@@ -0,0 +1,449 @@
+#include "ColumnarExport.hxx"
+
+#include "Account.hxx"
+#include "Bank.hxx"
+
+#include <algorithm>
+#include <fstream>
+#include <limits>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+    const char COLUMNAR_FILE_MAGIC[8] = {'A', 'T', 'M', 'C', 'O', 'L', '2', '\0'};
+
+    // Columns of each table, and the ColumnarColumn value of its first
+    const std::uint32_t TABLE_COLUMNS[2] = {3, 4};
+    const std::uint32_t FIRST_COLUMN[2] = {0, 3};
+    const std::size_t TRAILER_SIZE = sizeof(std::uint64_t) + sizeof(COLUMNAR_FILE_MAGIC);
+
+    struct ChunkRecord
+    {
+        std::uint64_t offset;
+        std::uint64_t bytes;
+        double min;
+        double max;
+        std::uint32_t rows;
+        std::uint32_t runs;
+        std::uint8_t encoding;
+        std::uint8_t reserved[7];
+    };
+
+    std::size_t columnSize(ColumnarColumn column)
+    {
+        switch (column)
+        {
+            case ColumnarColumn::ACCOUNT_BALANCE:
+            case ColumnarColumn::ENTRY_AMOUNT:
+                return (sizeof(double));
+            case ColumnarColumn::ENTRY_TYPE:
+                return (sizeof(std::uint8_t));
+            case ColumnarColumn::ENTRY_TIME:
+                return (sizeof(std::int64_t));
+            default:
+                return (sizeof(std::int32_t));
+        }
+    }
+
+    std::size_t padTo8(std::size_t bytes)
+    {
+        return ((bytes + 7) & ~static_cast<std::size_t>(7));
+    }
+
+    // Appends column chunks to the file and remembers where they went
+    class ChunkWriter
+    {
+        public:
+
+            ChunkWriter(std::ofstream& out, bool compress) :
+                myOut(out),
+                myCompress(compress),
+                myOffset(sizeof(COLUMNAR_FILE_MAGIC))
+            {
+            }
+
+            template <typename T>
+            void write(const T* values, std::size_t rows, std::vector<ChunkRecord>& index)
+            {
+                ChunkRecord record = {};
+                record.offset = myOffset;
+                record.rows = static_cast<std::uint32_t>(rows);
+                record.min = std::numeric_limits<double>::infinity();
+                record.max = -std::numeric_limits<double>::infinity();
+
+                // Runs compare bit patterns, so NaNs and signed zeros survive
+                std::uint32_t runs = 0;
+                for (std::size_t i = 0; i < rows; i++)
+                {
+                    const double value = static_cast<double>(values[i]);
+                    record.min = (value < record.min) ? value : record.min;
+                    record.max = (value > record.max) ? value : record.max;
+                    if ((i == 0) || (std::memcmp(&values[i], &values[i - 1], sizeof(T)) != 0))
+                    {
+                        runs++;
+                    }
+                }
+
+                const std::size_t plainBytes = padTo8(rows * sizeof(T));
+                const std::size_t rleBytes = padTo8(padTo8(runs * sizeof(T)) + runs * sizeof(std::uint32_t));
+                if (myCompress && (rleBytes < plainBytes))
+                {
+                    myRunValues.resize(runs * sizeof(T));
+                    myRunLengths.clear();
+                    std::size_t run = 0;
+                    for (std::size_t i = 0; i < rows; i++)
+                    {
+                        if ((i == 0) || (std::memcmp(&values[i], &values[i - 1], sizeof(T)) != 0))
+                        {
+                            std::memcpy(&myRunValues[run++ * sizeof(T)], &values[i], sizeof(T));
+                            myRunLengths.push_back(0);
+                        }
+                        myRunLengths.back()++;
+                    }
+                    put(myRunValues.data(), myRunValues.size());
+                    pad();
+                    put(reinterpret_cast<const char*>(myRunLengths.data()), runs * sizeof(std::uint32_t));
+                    record.encoding = ColumnChunk::RLE;
+                    record.runs = runs;
+                }
+                else
+                {
+                    put(reinterpret_cast<const char*>(values), rows * sizeof(T));
+                    record.encoding = ColumnChunk::PLAIN;
+                }
+                pad();
+                record.bytes = myOffset - record.offset;
+                index.push_back(record);
+            }
+
+            void put(const char* bytes, std::size_t size)
+            {
+                myOut.write(bytes, static_cast<std::streamsize>(size));
+                myOffset += size;
+            }
+
+            std::uint64_t offset() const { return (myOffset); }
+
+        private:
+
+            void pad()
+            {
+                static const char zeros[8] = {};
+                put(zeros, padTo8(static_cast<std::size_t>(myOffset)) - static_cast<std::size_t>(myOffset));
+            }
+
+            std::ofstream& myOut;
+            bool myCompress;
+            std::uint64_t myOffset;
+            std::vector<char> myRunValues;
+            std::vector<std::uint32_t> myRunLengths;
+    };
+}
+
+// Row counts and chunk index, written after the last chunk
+struct ColumnarFooter
+{
+    std::uint64_t rows[2];
+    std::uint32_t rowsPerGroup;
+    std::uint32_t groups[2];
+    std::uint32_t columns[2];
+    std::uint32_t reserved;
+};
+
+ColumnarExportReport exportColumnar(const Bank& bank, const std::string& path,
+                                    const ColumnarExportOptions& options)
+{
+    ColumnarExportReport report;
+    const std::size_t groupRows = std::max<std::size_t>(1,
+        std::min<std::size_t>(options.rowsPerGroup, std::numeric_limits<std::uint32_t>::max()));
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out)
+    {
+        report.failed = true;
+        return (report);
+    }
+    out.write(COLUMNAR_FILE_MAGIC, sizeof(COLUMNAR_FILE_MAGIC));
+    ChunkWriter writer(out, options.compress);
+
+    std::vector<std::int32_t> numbers;
+    std::vector<double> balances;
+    std::vector<std::uint32_t> ledgerLengths;
+    std::vector<std::int32_t> entryAccounts;
+    std::vector<std::uint8_t> entryTypes;
+    std::vector<double> entryAmounts;
+    std::vector<std::int64_t> entryTimes;
+    std::vector<ChunkRecord> accountChunks;
+    std::vector<ChunkRecord> entryChunks;
+
+    auto flushAccounts = [&]()
+    {
+        writer.write(numbers.data(), numbers.size(), accountChunks);
+        writer.write(balances.data(), balances.size(), accountChunks);
+        writer.write(ledgerLengths.data(), ledgerLengths.size(), accountChunks);
+        numbers.clear();
+        balances.clear();
+        ledgerLengths.clear();
+    };
+
+    // Writes whole row groups, or everything that is left when `all` is set
+    auto flushEntries = [&](bool all)
+    {
+        std::size_t first = 0;
+        while ((entryAmounts.size() - first >= groupRows) || (all && (first < entryAmounts.size())))
+        {
+            const std::size_t rows = std::min(groupRows, entryAmounts.size() - first);
+            writer.write(entryAccounts.data() + first, rows, entryChunks);
+            writer.write(entryTypes.data() + first, rows, entryChunks);
+            writer.write(entryAmounts.data() + first, rows, entryChunks);
+            writer.write(entryTimes.data() + first, rows, entryChunks);
+            first += rows;
+        }
+        entryAccounts.erase(entryAccounts.begin(), entryAccounts.begin() + first);
+        entryTypes.erase(entryTypes.begin(), entryTypes.begin() + first);
+        entryAmounts.erase(entryAmounts.begin(), entryAmounts.begin() + first);
+        entryTimes.erase(entryTimes.begin(), entryTimes.begin() + first);
+    };
+
+    const int count = bank.accountCount();
+    for (int n = 0; n < count; n++)
+    {
+        Account* account = bank.accountAt(n);
+        account->withLedger([&](double balance, TransactionView ledger)
+        {
+            numbers.push_back(account->getAccountNumber());
+            balances.push_back(balance);
+            ledgerLengths.push_back(static_cast<std::uint32_t>(ledger.size()));
+            for (std::size_t i = 0; i < ledger.size(); i++)
+            {
+                entryAccounts.push_back(account->getAccountNumber());
+                entryTypes.push_back(static_cast<std::uint8_t>(std::get<0>(ledger[i])));
+                entryAmounts.push_back(std::get<1>(ledger[i]));
+                entryTimes.push_back(ledger.time(i));
+            }
+            report.entries += ledger.size();
+        });
+        report.accounts++;
+
+        if (numbers.size() == groupRows)
+        {
+            flushAccounts();
+        }
+        if (entryAmounts.size() >= groupRows)
+        {
+            flushEntries(false);
+        }
+    }
+    if (!numbers.empty())
+    {
+        flushAccounts();
+    }
+    flushEntries(true);
+
+    ColumnarFooter footer = {};
+    footer.rows[0] = report.accounts;
+    footer.rows[1] = report.entries;
+    footer.rowsPerGroup = static_cast<std::uint32_t>(groupRows);
+    footer.groups[0] = static_cast<std::uint32_t>(accountChunks.size() / TABLE_COLUMNS[0]);
+    footer.groups[1] = static_cast<std::uint32_t>(entryChunks.size() / TABLE_COLUMNS[1]);
+    footer.columns[0] = TABLE_COLUMNS[0];
+    footer.columns[1] = TABLE_COLUMNS[1];
+
+    const std::uint64_t footerOffset = writer.offset();
+    writer.put(reinterpret_cast<const char*>(&footer), sizeof(footer));
+    writer.put(reinterpret_cast<const char*>(accountChunks.data()), accountChunks.size() * sizeof(ChunkRecord));
+    writer.put(reinterpret_cast<const char*>(entryChunks.data()), entryChunks.size() * sizeof(ChunkRecord));
+    writer.put(reinterpret_cast<const char*>(&footerOffset), sizeof(footerOffset));
+    writer.put(COLUMNAR_FILE_MAGIC, sizeof(COLUMNAR_FILE_MAGIC));
+
+    report.rowGroups = footer.groups[0] + footer.groups[1];
+    report.bytes = static_cast<std::size_t>(writer.offset());
+    out.close();
+    report.failed = out.fail();
+    return (report);
+}
+
+
+ColumnarReader::ColumnarReader(const std::string& path)
+{
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return;
+    }
+    struct stat info;
+    void* mapping = MAP_FAILED;
+    if ((::fstat(fd, &info) == 0) && (info.st_size > 0))
+    {
+        mapping = ::mmap(nullptr, static_cast<std::size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    ::close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        return;
+    }
+
+    myBase = static_cast<const char*>(mapping);
+    mySize = static_cast<std::size_t>(info.st_size);
+    if (!validate())
+    {
+        ::munmap(const_cast<char*>(myBase), mySize);
+        myBase = nullptr;
+        mySize = 0;
+        myFooter = nullptr;
+        myChunks = nullptr;
+    }
+}
+
+ColumnarReader::~ColumnarReader() noexcept
+{
+    if (myBase)
+    {
+        ::munmap(const_cast<char*>(myBase), mySize);
+    }
+}
+
+bool ColumnarReader::validate()
+{
+    const std::size_t minimum = sizeof(COLUMNAR_FILE_MAGIC) + sizeof(ColumnarFooter) + TRAILER_SIZE;
+    if ((mySize < minimum)
+        || (std::memcmp(myBase, COLUMNAR_FILE_MAGIC, sizeof(COLUMNAR_FILE_MAGIC)) != 0)
+        || (std::memcmp(myBase + mySize - sizeof(COLUMNAR_FILE_MAGIC), COLUMNAR_FILE_MAGIC,
+                        sizeof(COLUMNAR_FILE_MAGIC)) != 0))
+    {
+        return (false);
+    }
+
+    std::uint64_t footerOffset = 0;
+    std::memcpy(&footerOffset, myBase + mySize - TRAILER_SIZE, sizeof(footerOffset));
+    if ((footerOffset < sizeof(COLUMNAR_FILE_MAGIC)) || (footerOffset % 8 != 0)
+        || (footerOffset > mySize - TRAILER_SIZE - sizeof(ColumnarFooter)))
+    {
+        return (false);
+    }
+    const ColumnarFooter* footer = reinterpret_cast<const ColumnarFooter*>(myBase + footerOffset);
+    if ((footer->rowsPerGroup == 0)
+        || (footer->columns[0] != TABLE_COLUMNS[0]) || (footer->columns[1] != TABLE_COLUMNS[1]))
+    {
+        return (false);
+    }
+    for (int table = 0; table < 2; table++)
+    {
+        if (footer->groups[table] != (footer->rows[table] + footer->rowsPerGroup - 1) / footer->rowsPerGroup)
+        {
+            return (false);
+        }
+    }
+
+    const std::size_t accountChunks = static_cast<std::size_t>(footer->groups[0]) * TABLE_COLUMNS[0];
+    const std::size_t chunkCount = accountChunks + static_cast<std::size_t>(footer->groups[1]) * TABLE_COLUMNS[1];
+    if (footerOffset + sizeof(ColumnarFooter) + chunkCount * sizeof(ChunkRecord) + TRAILER_SIZE != mySize)
+    {
+        return (false);
+    }
+    myFooter = footer;
+    myChunks = myBase + footerOffset + sizeof(ColumnarFooter);
+
+    for (std::size_t index = 0; index < chunkCount; index++)
+    {
+        ChunkRecord record;
+        std::memcpy(&record, myChunks + index * sizeof(ChunkRecord), sizeof(record));
+        const int table = (index < accountChunks) ? 0 : 1;
+        const std::size_t local = table ? index - accountChunks : index;
+        const std::uint64_t group = local / TABLE_COLUMNS[table];
+        const std::size_t size = columnSize(static_cast<ColumnarColumn>(FIRST_COLUMN[table] + local % TABLE_COLUMNS[table]));
+        const std::uint64_t expectedRows = std::min<std::uint64_t>(footer->rowsPerGroup,
+            footer->rows[table] - group * footer->rowsPerGroup);
+
+        std::uint64_t needed = static_cast<std::uint64_t>(record.rows) * size;
+        if (record.encoding == ColumnChunk::RLE)
+        {
+            needed = padTo8(record.runs * size) + static_cast<std::uint64_t>(record.runs) * sizeof(std::uint32_t);
+        }
+        else if (record.encoding != ColumnChunk::PLAIN)
+        {
+            return (false);
+        }
+        if ((record.rows != expectedRows) || (record.runs > record.rows)
+            || (record.offset < sizeof(COLUMNAR_FILE_MAGIC)) || (record.offset % 8 != 0)
+            || (record.offset > footerOffset) || (record.bytes > footerOffset - record.offset)
+            || (needed > record.bytes))
+        {
+            return (false);
+        }
+
+        // Readers walk runs without bounds checks, so the runs must cover
+        // the chunk's rows exactly
+        if (record.encoding == ColumnChunk::RLE)
+        {
+            const char* lengths = myBase + record.offset + padTo8(record.runs * size);
+            std::uint64_t covered = 0;
+            for (std::uint32_t run = 0; run < record.runs; run++)
+            {
+                std::uint32_t count = 0;
+                std::memcpy(&count, lengths + run * sizeof(std::uint32_t), sizeof(count));
+                if (count == 0)
+                {
+                    return (false);
+                }
+                covered += count;
+            }
+            if (covered != record.rows)
+            {
+                return (false);
+            }
+        }
+    }
+    return (true);
+}
+
+std::size_t ColumnarReader::rows(ColumnarTable table) const
+{
+    return (myFooter ? static_cast<std::size_t>(myFooter->rows[static_cast<int>(table)]) : 0);
+}
+
+std::size_t ColumnarReader::rowGroups(ColumnarTable table) const
+{
+    return (myFooter ? myFooter->groups[static_cast<int>(table)] : 0);
+}
+
+std::size_t ColumnarReader::firstRow(ColumnarTable table, std::size_t rowGroup) const
+{
+    (void)table;
+    return (myFooter ? rowGroup * myFooter->rowsPerGroup : 0);
+}
+
+ColumnarTable ColumnarReader::tableOf(ColumnarColumn column)
+{
+    return ((static_cast<std::uint32_t>(column) < FIRST_COLUMN[1]) ? ColumnarTable::ACCOUNTS : ColumnarTable::ENTRIES);
+}
+
+ColumnChunk ColumnarReader::chunk(std::size_t rowGroup, ColumnarColumn column) const
+{
+    ColumnChunk view;
+    const int table = static_cast<int>(tableOf(column));
+    if (!myFooter || (rowGroup >= myFooter->groups[table]))
+    {
+        return (view);
+    }
+    std::size_t index = rowGroup * TABLE_COLUMNS[table] + (static_cast<std::uint32_t>(column) - FIRST_COLUMN[table]);
+    if (table == 1)
+    {
+        index += static_cast<std::size_t>(myFooter->groups[0]) * TABLE_COLUMNS[0];
+    }
+
+    ChunkRecord record;
+    std::memcpy(&record, myChunks + index * sizeof(ChunkRecord), sizeof(record));
+    view.encoding = static_cast<ColumnChunk::Encoding>(record.encoding);
+    view.rows = record.rows;
+    view.runs = record.runs;
+    view.min = record.min;
+    view.max = record.max;
+    view.data = myBase + record.offset;
+    return (view);
+}
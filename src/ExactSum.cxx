@@ -0,0 +1,157 @@
+#include "ExactSum.hxx"
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+const int ExactSum::LIMB_BITS;
+const int ExactSum::LIMB_COUNT;
+const int ExactSum::MIN_EXPONENT;
+const std::uint32_t ExactSum::ADDS_BEFORE_NORMALIZE;
+
+ExactSum::ExactSum() noexcept :
+    myPendingAdds(0),
+    myNonFinite(false)
+{
+    std::memset(myLimbs, 0, sizeof(myLimbs));
+}
+
+void ExactSum::add(double value) noexcept
+{
+    std::uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    const int biased = static_cast<int>((bits >> 52) & 0x7ff);
+    std::uint64_t mantissa = bits & ((std::uint64_t(1) << 52) - 1);
+
+    if (biased == 0x7ff)
+    {
+        myNonFinite = true;
+        return;
+    }
+    if (biased != 0)
+    {
+        mantissa |= std::uint64_t(1) << 52;
+    }
+    if (mantissa == 0)
+    {
+        return;
+    }
+
+    // value = mantissa * 2^exponent, placed at bit `offset` of the integer
+    const int exponent = (biased == 0) ? MIN_EXPONENT : biased - 1075;
+    const int offset = exponent - MIN_EXPONENT;
+    const int limb = offset / LIMB_BITS;
+    const int shift = offset % LIMB_BITS;
+
+    const std::uint64_t low = mantissa << shift;
+    const std::uint64_t high = (shift == 0) ? 0 : (mantissa >> (64 - shift));
+    const std::int64_t sign = (bits >> 63) ? -1 : 1;
+
+    myLimbs[limb] += sign * static_cast<std::int64_t>(low & 0xffffffffu);
+    myLimbs[limb + 1] += sign * static_cast<std::int64_t>(low >> 32);
+    myLimbs[limb + 2] += sign * static_cast<std::int64_t>(high);
+
+    if (++myPendingAdds == ADDS_BEFORE_NORMALIZE)
+    {
+        normalize();
+    }
+}
+
+void ExactSum::add(const ExactSum& other) noexcept
+{
+    ExactSum normalized(other);
+    normalized.normalize();
+    normalize();
+    for (int i = 0; i < LIMB_COUNT; i++)
+    {
+        myLimbs[i] += normalized.myLimbs[i];
+    }
+    myNonFinite = myNonFinite || other.myNonFinite;
+    normalize();
+}
+
+// Carries into the next limb, leaving every limb but the top one in
+// [0, 2^32); the top limb carries the sign
+void ExactSum::normalize() noexcept
+{
+    for (int i = 0; i < LIMB_COUNT - 1; i++)
+    {
+        const std::int64_t carry = myLimbs[i] >> LIMB_BITS;
+        myLimbs[i] -= carry * (std::int64_t(1) << LIMB_BITS);
+        myLimbs[i + 1] += carry;
+    }
+    myPendingAdds = 0;
+}
+
+bool ExactSum::isZero() const noexcept
+{
+    ExactSum copy(*this);
+    copy.normalize();
+    for (int i = 0; i < LIMB_COUNT; i++)
+    {
+        if (copy.myLimbs[i] != 0)
+        {
+            return (false);
+        }
+    }
+    return (!myNonFinite);
+}
+
+double ExactSum::value() const noexcept
+{
+    if (myNonFinite)
+    {
+        return (std::numeric_limits<double>::quiet_NaN());
+    }
+
+    ExactSum magnitude(*this);
+    magnitude.normalize();
+    const bool negative = magnitude.myLimbs[LIMB_COUNT - 1] < 0;
+    if (negative)
+    {
+        for (int i = 0; i < LIMB_COUNT; i++)
+        {
+            magnitude.myLimbs[i] = -magnitude.myLimbs[i];
+        }
+        magnitude.normalize();
+    }
+
+    int top = LIMB_COUNT - 1;
+    while ((top >= 0) && (magnitude.myLimbs[top] == 0))
+    {
+        top--;
+    }
+    if (top < 0)
+    {
+        return (0.0);
+    }
+
+    // Gather the 64 most significant bits, folding everything below them
+    // into a sticky low bit so the uint64 -> double conversion rounds right
+    auto limbAt = [&magnitude](int i) -> std::uint64_t
+    {
+        return ((i >= 0) ? static_cast<std::uint64_t>(magnitude.myLimbs[i]) : 0);
+    };
+
+    int topBits = 0;
+    while ((topBits < LIMB_BITS) && (limbAt(top) >> topBits))
+    {
+        topBits++;
+    }
+
+    std::uint64_t head = (limbAt(top) << (64 - topBits)) | (limbAt(top - 1) << (32 - topBits))
+        | (limbAt(top - 2) >> topBits);
+    bool sticky = (topBits != 0) && ((limbAt(top - 2) & ((std::uint64_t(1) << topBits) - 1)) != 0);
+    for (int i = top - 3; (i >= 0) && !sticky; i--)
+    {
+        sticky = (magnitude.myLimbs[i] != 0);
+    }
+    if (sticky)
+    {
+        head |= 1;
+    }
+
+    const int headExponent = top * LIMB_BITS + topBits - 64 + MIN_EXPONENT;
+    const double result = std::ldexp(static_cast<double>(head), headExponent);
+    return (negative ? -result : result);
+}
@@ -0,0 +1,207 @@
+#include "Format.hxx"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <locale.h>
+
+namespace
+{
+    const RequestName REQUEST_NAMES[] = {
+        {"REQUEST_INVALID", sizeof("REQUEST_INVALID") - 1},
+        {"REQUEST_BALANCE", sizeof("REQUEST_BALANCE") - 1},
+        {"REQUEST_DEPOSIT", sizeof("REQUEST_DEPOSIT") - 1},
+        {"REQUEST_WITHDRAW", sizeof("REQUEST_WITHDRAW") - 1},
+        {"REQUEST_TRANSACTIONS", sizeof("REQUEST_TRANSACTIONS") - 1},
+        {"REQUEST_CARRY_FORWARD", sizeof("REQUEST_CARRY_FORWARD") - 1},
+    };
+
+    // Exact powers of ten; every entry is representable in a double
+    const double POWERS_OF_TEN[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9,
+        1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17,
+    };
+    const int MAX_FRACTION_DIGITS = 17;
+
+    // Largest integer below which every integer is exactly representable
+    const double EXACT_INTEGER_LIMIT = 9007199254740992.0;
+
+    ToCharsResult tooLarge(char* last)
+    {
+        return {last, std::errc::value_too_large};
+    }
+
+    ToCharsResult copyText(char* first, char* last, const char* text, std::size_t length)
+    {
+        if (static_cast<std::size_t>(last - first) < length)
+        {
+            return tooLarge(last);
+        }
+        std::memcpy(first, text, length);
+        return {first + length, std::errc()};
+    }
+
+    // Writes sign, digits of `mantissa` and a decimal point `decimals` digits
+    // from the right, with leading zeros as needed ("0.05").
+    ToCharsResult writeScaled(char* first, char* last, bool negative,
+                              unsigned long long mantissa, int decimals)
+    {
+        char digits[24];
+        int count = 0;
+        do
+        {
+            digits[count++] = static_cast<char>('0' + (mantissa % 10));
+            mantissa /= 10;
+        } while (mantissa != 0);
+
+        while (count <= decimals)
+        {
+            digits[count++] = '0';
+        }
+
+        std::size_t length = static_cast<std::size_t>(count) + (negative ? 1 : 0) + (decimals > 0 ? 1 : 0);
+        if (static_cast<std::size_t>(last - first) < length)
+        {
+            return tooLarge(last);
+        }
+
+        char* out = first;
+        if (negative)
+        {
+            *out++ = '-';
+        }
+        for (int i = count - 1; i >= 0; i--)
+        {
+            *out++ = digits[i];
+            if ((i == decimals) && (decimals > 0))
+            {
+                *out++ = '.';
+            }
+        }
+        return {out, std::errc()};
+    }
+
+    ToCharsResult formatNonFinite(char* first, char* last, double value)
+    {
+        if (std::isnan(value))
+        {
+            return copyText(first, last, "nan", 3);
+        }
+        return value < 0 ? copyText(first, last, "-inf", 4) : copyText(first, last, "inf", 3);
+    }
+
+    // snprintf and strtod follow LC_NUMERIC, so the slow paths switch the
+    // calling thread to the "C" locale while they run. Like the fast
+    // paths, they then write '.' whatever the program's locale.
+    class ClassicNumericScope
+    {
+        public:
+
+            ClassicNumericScope() : myPrevious(uselocale(classicLocale())) {}
+            ~ClassicNumericScope() { uselocale(myPrevious); }
+
+        private:
+
+            // If newlocale() fails, uselocale((locale_t) 0) changes nothing
+            static locale_t classicLocale()
+            {
+                static const locale_t theClassic = newlocale(LC_NUMERIC_MASK, "C", static_cast<locale_t>(0));
+                return (theClassic);
+            }
+
+            locale_t myPrevious;
+    };
+
+    // Slow path for magnitudes the scaled-integer search cannot cover
+    ToCharsResult formatGeneral(char* first, char* last, double value)
+    {
+        ClassicNumericScope classic;
+        char text[AMOUNT_BUFFER_SIZE];
+        int length = 0;
+        for (int precision = 1; precision <= 17; precision++)
+        {
+            length = std::snprintf(text, sizeof(text), "%.*g", precision, value);
+            if (std::strtod(text, nullptr) == value)
+            {
+                break;
+            }
+        }
+        return copyText(first, last, text, static_cast<std::size_t>(length));
+    }
+}
+
+ToCharsResult formatAmount(char* first, char* last, double value)
+{
+    if (!std::isfinite(value))
+    {
+        return formatNonFinite(first, last, value);
+    }
+
+    bool negative = std::signbit(value);
+    double magnitude = std::fabs(value);
+
+    // Find the fewest fractional digits k such that some integer n gives
+    // n / 10^k == magnitude. Both operands are exact, so the division is
+    // correctly rounded and matches what strtod returns for the text.
+    for (int k = 0; k <= MAX_FRACTION_DIGITS; k++)
+    {
+        double scaled = magnitude * POWERS_OF_TEN[k];
+        if (scaled >= EXACT_INTEGER_LIMIT)
+        {
+            break;
+        }
+
+        double nearest = std::floor(scaled + 0.5);
+        const double candidates[] = {nearest, nearest - 1.0, nearest + 1.0};
+        for (double candidate : candidates)
+        {
+            if ((candidate >= 0.0) && (candidate / POWERS_OF_TEN[k] == magnitude))
+            {
+                return writeScaled(first, last, negative,
+                                   static_cast<unsigned long long>(candidate), k);
+            }
+        }
+    }
+
+    return formatGeneral(first, last, value);
+}
+
+ToCharsResult formatAmountFixed(char* first, char* last, double value, int decimals)
+{
+    if (!std::isfinite(value))
+    {
+        return formatNonFinite(first, last, value);
+    }
+    if (decimals < 0)
+    {
+        decimals = 0;
+    }
+    if (decimals > 9)
+    {
+        decimals = 9;
+    }
+
+    double scaled = std::fabs(value) * POWERS_OF_TEN[decimals];
+    if (scaled < EXACT_INTEGER_LIMIT)
+    {
+        unsigned long long mantissa = static_cast<unsigned long long>(std::floor(scaled + 0.5));
+        return writeScaled(first, last, (mantissa != 0) && std::signbit(value), mantissa, decimals);
+    }
+
+    ClassicNumericScope classic;
+    char text[AMOUNT_BUFFER_SIZE + 320];
+    int length = std::snprintf(text, sizeof(text), "%.*f", decimals, value);
+    return copyText(first, last, text, static_cast<std::size_t>(length));
+}
+
+RequestName requestName(UserRequest request)
+{
+    std::size_t index = static_cast<std::size_t>(request);
+    if (index < sizeof(REQUEST_NAMES) / sizeof(REQUEST_NAMES[0]))
+    {
+        return REQUEST_NAMES[index];
+    }
+    return {"", 0};
+}
@@ -0,0 +1,89 @@
+#include "InterestAccrual.hxx"
+
+#include <cmath>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+    // Adding and subtracting 1.5 * 2^52 rounds to an integer, half to
+    // even, for |x| < 2^51; written the same way in both kernels so they
+    // agree bit for bit
+    const double ROUNDING_MAGIC = 6755399441055744.0;
+    const double ROUNDING_LIMIT = 2251799813685248.0;
+
+    double accrueScalar(double balance, const AccrualSchedule& schedule, double scale)
+    {
+        double rate = 0.0;
+        double fixed = 0.0;
+        for (const RateTier& tier : schedule.tiers)
+        {
+            if (balance >= tier.floor)
+            {
+                rate = tier.rate;
+                fixed = tier.fixed;
+            }
+        }
+
+        double accrual = balance * rate + fixed;
+        if (scale > 0.0)
+        {
+            double units = accrual * scale;
+            if (std::fabs(units) < ROUNDING_LIMIT)
+            {
+                accrual = ((units + ROUNDING_MAGIC) - ROUNDING_MAGIC) / scale;
+            }
+        }
+        return (accrual);
+    }
+}
+
+void computeAccruals(const double* balances, double* accruals, std::size_t count,
+    const AccrualSchedule& schedule)
+{
+    // Whole units are divided by the units per 1.0 rather than multiplied
+    // by roundTo: 57 / 100 is the double nearest 0.57, 57 * 0.01 is not
+    const double unit = schedule.roundTo;
+    const double scale = (unit > 0.0) ? 1.0 / unit : 0.0;
+    std::size_t i = 0;
+
+#if defined(__SSE2__)
+    // Two balances per step. Tier selection is branch-free: each tier
+    // whose floor is reached overwrites rate and fixed through a mask.
+    const __m128d zero = _mm_setzero_pd();
+    const __m128d magic = _mm_set1_pd(ROUNDING_MAGIC);
+    const __m128d limit = _mm_set1_pd(ROUNDING_LIMIT);
+    const __m128d absMask = _mm_castsi128_pd(_mm_set1_epi64x(0x7fffffffffffffffLL));
+    const __m128d scaleV = _mm_set1_pd(scale);
+
+    for (; i + 2 <= count; i += 2)
+    {
+        const __m128d balance = _mm_loadu_pd(balances + i);
+        __m128d rate = zero;
+        __m128d fixed = zero;
+        for (const RateTier& tier : schedule.tiers)
+        {
+            const __m128d reached = _mm_cmpge_pd(balance, _mm_set1_pd(tier.floor));
+            rate = _mm_or_pd(_mm_and_pd(reached, _mm_set1_pd(tier.rate)), _mm_andnot_pd(reached, rate));
+            fixed = _mm_or_pd(_mm_and_pd(reached, _mm_set1_pd(tier.fixed)), _mm_andnot_pd(reached, fixed));
+        }
+
+        __m128d accrual = _mm_add_pd(_mm_mul_pd(balance, rate), fixed);
+        if (scale > 0.0)
+        {
+            const __m128d units = _mm_mul_pd(accrual, scaleV);
+            const __m128d rounded = _mm_div_pd(_mm_sub_pd(_mm_add_pd(units, magic), magic), scaleV);
+            const __m128d inRange = _mm_cmplt_pd(_mm_and_pd(units, absMask), limit);
+            accrual = _mm_or_pd(_mm_and_pd(inRange, rounded), _mm_andnot_pd(inRange, accrual));
+        }
+        _mm_storeu_pd(accruals + i, accrual);
+    }
+#endif
+
+    for (; i < count; i++)
+    {
+        accruals[i] = accrueScalar(balances[i], schedule, scale);
+    }
+}
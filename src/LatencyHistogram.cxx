@@ -0,0 +1,269 @@
+#include "LatencyHistogram.hxx"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+const int LatencyHistogram::SUB_BUCKET_BITS;
+const int LatencyHistogram::SUB_BUCKET_COUNT;
+const int LatencyHistogram::MAX_EXPONENT;
+const int LatencyHistogram::BUCKET_COUNT;
+
+LatencyHistogram::LatencyHistogram() noexcept
+{
+    reset();
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) noexcept
+{
+    for (int i = 0; i < BUCKET_COUNT; i++)
+    {
+        std::uint64_t add = other.myBuckets[i].load(std::memory_order_relaxed);
+        if (add != 0)
+        {
+            myBuckets[i].fetch_add(add, std::memory_order_relaxed);
+        }
+    }
+    std::uint64_t otherMax = other.max();
+    if (otherMax > max())
+    {
+        myMax.store(otherMax, std::memory_order_relaxed);
+    }
+}
+
+void LatencyHistogram::reset() noexcept
+{
+    for (int i = 0; i < BUCKET_COUNT; i++)
+    {
+        myBuckets[i].store(0, std::memory_order_relaxed);
+    }
+    myMax.store(0, std::memory_order_relaxed);
+}
+
+std::uint64_t LatencyHistogram::count() const noexcept
+{
+    std::uint64_t total = 0;
+    for (int i = 0; i < BUCKET_COUNT; i++)
+    {
+        total += myBuckets[i].load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+std::uint64_t LatencyHistogram::valueAtPercentile(double percentile) const noexcept
+{
+    std::uint64_t total = count();
+    if (total == 0)
+    {
+        return 0;
+    }
+
+    double clamped = std::min(100.0, std::max(0.0, percentile));
+    std::uint64_t rank = static_cast<std::uint64_t>(std::ceil(clamped / 100.0 * static_cast<double>(total)));
+    rank = std::max<std::uint64_t>(rank, 1);
+
+    std::uint64_t seen = 0;
+    for (int i = 0; i < BUCKET_COUNT; i++)
+    {
+        seen += myBuckets[i].load(std::memory_order_relaxed);
+        if (seen >= rank)
+        {
+            return std::min(bucketUpperBound(i), max());
+        }
+    }
+    return max();
+}
+
+int LatencyHistogram::bucketIndex(std::uint64_t value) noexcept
+{
+    if (value < static_cast<std::uint64_t>(SUB_BUCKET_COUNT))
+    {
+        return static_cast<int>(value);
+    }
+
+#if defined(__GNUC__)
+    int exponent = 63 - __builtin_clzll(value);
+#else
+    int exponent = 0;
+    for (std::uint64_t v = value; v > 1; v >>= 1)
+    {
+        exponent++;
+    }
+#endif
+    if (exponent > MAX_EXPONENT)
+    {
+        return BUCKET_COUNT - 1;
+    }
+
+    int row = exponent - SUB_BUCKET_BITS + 1;
+    int sub = static_cast<int>(value >> (exponent - SUB_BUCKET_BITS)) - SUB_BUCKET_COUNT;
+    return row * SUB_BUCKET_COUNT + sub;
+}
+
+std::uint64_t LatencyHistogram::bucketUpperBound(int index) noexcept
+{
+    int row = index / SUB_BUCKET_COUNT;
+    int sub = index % SUB_BUCKET_COUNT;
+    if (row == 0)
+    {
+        return static_cast<std::uint64_t>(sub);
+    }
+
+    int shift = row - 1;
+    std::uint64_t lower = static_cast<std::uint64_t>(SUB_BUCKET_COUNT + sub) << shift;
+    return lower + (std::uint64_t(1) << shift) - 1;
+}
+
+namespace
+{
+    const int KIND_COUNT = static_cast<int>(LatencyKind::KIND_COUNT);
+
+    struct ThreadHistograms
+    {
+        LatencyHistogram histograms[KIND_COUNT];
+    };
+
+    // Histograms of live threads, plus everything recorded by threads that
+    // have already exited
+    struct Registry
+    {
+        std::mutex mutex;
+        std::vector<ThreadHistograms*> live;
+        ThreadHistograms retired;
+    };
+
+    Registry& registry()
+    {
+        // Never destroyed: threads may still exit after static destruction
+        static Registry* theRegistry = new Registry;
+        return *theRegistry;
+    }
+
+    class ThreadSlot
+    {
+        public:
+
+            ThreadSlot() : myHistograms(new ThreadHistograms)
+            {
+                Registry& reg = registry();
+                std::lock_guard<std::mutex> lock(reg.mutex);
+                reg.live.push_back(myHistograms.get());
+            }
+
+            ~ThreadSlot()
+            {
+                Registry& reg = registry();
+                std::lock_guard<std::mutex> lock(reg.mutex);
+                for (int i = 0; i < KIND_COUNT; i++)
+                {
+                    reg.retired.histograms[i].merge(myHistograms->histograms[i]);
+                }
+                reg.live.erase(std::find(reg.live.begin(), reg.live.end(), myHistograms.get()));
+            }
+
+            ThreadHistograms& histograms() { return *myHistograms; }
+
+        private:
+
+            std::unique_ptr<ThreadHistograms> myHistograms;
+    };
+
+    ThreadHistograms& threadHistograms()
+    {
+        static thread_local ThreadSlot slot;
+        return slot.histograms();
+    }
+}
+
+void LatencyStats::record(LatencyKind kind, std::uint64_t nanoseconds) noexcept
+{
+    threadHistograms().histograms[static_cast<int>(kind)].record(nanoseconds);
+}
+
+void LatencyStats::merged(LatencyKind kind, LatencyHistogram& into)
+{
+    const int index = static_cast<int>(kind);
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    into.merge(reg.retired.histograms[index]);
+    for (ThreadHistograms* thread : reg.live)
+    {
+        into.merge(thread->histograms[index]);
+    }
+}
+
+LatencyStats::Summary LatencyStats::summary(LatencyKind kind)
+{
+    std::unique_ptr<LatencyHistogram> total(new LatencyHistogram);
+    merged(kind, *total);
+
+    Summary result;
+    result.count = total->count();
+    result.p50 = total->valueAtPercentile(50.0);
+    result.p99 = total->valueAtPercentile(99.0);
+    result.p999 = total->valueAtPercentile(99.9);
+    result.max = total->max();
+    return result;
+}
+
+void LatencyStats::dump(std::ostream& out)
+{
+    out << std::left << std::setw(22) << "request (ns)" << std::right
+        << std::setw(12) << "count"
+        << std::setw(12) << "p50"
+        << std::setw(12) << "p99"
+        << std::setw(12) << "p999"
+        << std::setw(12) << "max" << '\n';
+
+    for (int i = 0; i < KIND_COUNT; i++)
+    {
+        LatencyKind kind = static_cast<LatencyKind>(i);
+        Summary s = summary(kind);
+        out << std::left << std::setw(22) << kindName(kind) << std::right
+            << std::setw(12) << s.count
+            << std::setw(12) << s.p50
+            << std::setw(12) << s.p99
+            << std::setw(12) << s.p999
+            << std::setw(12) << s.max << '\n';
+    }
+}
+
+void LatencyStats::reset()
+{
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    for (int i = 0; i < KIND_COUNT; i++)
+    {
+        reg.retired.histograms[i].reset();
+        for (ThreadHistograms* thread : reg.live)
+        {
+            thread->histograms[i].reset();
+        }
+    }
+}
+
+const char* LatencyStats::kindName(LatencyKind kind)
+{
+    switch (kind)
+    {
+        case LatencyKind::VIEW_ACCOUNT:
+            return "viewAccount";
+        case LatencyKind::REQUEST_INVALID:
+            return "REQUEST_INVALID";
+        case LatencyKind::REQUEST_BALANCE:
+            return "REQUEST_BALANCE";
+        case LatencyKind::REQUEST_DEPOSIT:
+            return "REQUEST_DEPOSIT";
+        case LatencyKind::REQUEST_WITHDRAW:
+            return "REQUEST_WITHDRAW";
+        case LatencyKind::REQUEST_TRANSACTIONS:
+            return "REQUEST_TRANSACTIONS";
+        case LatencyKind::KIND_COUNT:
+            break;
+    }
+    return "";
+}
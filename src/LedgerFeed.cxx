@@ -0,0 +1,211 @@
+#include "LedgerFeed.hxx"
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+const std::size_t LedgerFeed::DEFAULT_CAPACITY;
+const std::size_t LedgerFeed::MAX_SUBSCRIBERS;
+const std::uint64_t LedgerFeed::NO_CURSOR;
+
+namespace
+{
+    std::uint64_t bitsOf(double value)
+    {
+        std::uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        return (bits);
+    }
+
+    double doubleOf(std::uint64_t bits)
+    {
+        double value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return (value);
+    }
+
+    std::size_t roundUpToPowerOfTwo(std::size_t value)
+    {
+        std::size_t result = 2;
+        while (result < value)
+        {
+            result <<= 1;
+        }
+        return (result);
+    }
+}
+
+LedgerFeed::LedgerFeed(std::size_t capacity, OverflowPolicy policy) :
+    myPolicy(policy),
+    myMask(roundUpToPowerOfTwo(capacity) - 1),
+    mySlots(new Slot[myMask + 1]),
+    myClaimed(0),
+    myGate(0)
+{
+    for (std::size_t i = 0; i <= myMask; i++)
+    {
+        mySlots[i].version.store(0, std::memory_order_relaxed);
+    }
+    for (Cursor& cursor : myCursors)
+    {
+        cursor.next.store(NO_CURSOR, std::memory_order_relaxed);
+    }
+}
+
+LedgerFeed::~LedgerFeed() noexcept
+{
+}
+
+void LedgerFeed::onPosting(const Posting& posting) noexcept
+{
+    publish(posting);
+}
+
+std::uint64_t LedgerFeed::slowestCursor() const noexcept
+{
+    std::uint64_t slowest = NO_CURSOR;
+    for (const Cursor& cursor : myCursors)
+    {
+        slowest = std::min(slowest, cursor.next.load(std::memory_order_acquire));
+    }
+    return (slowest);
+}
+
+// BLOCK: sequence s reuses the slot of s - capacity, so it may only be
+// written once every subscriber has read past that. The slowest cursor is
+// cached and only recomputed when the cached value is not far enough on.
+void LedgerFeed::waitForSubscribers(std::uint64_t sequence) noexcept
+{
+    const std::uint64_t capacity = myMask + 1;
+    if (sequence < capacity)
+    {
+        return;
+    }
+    const std::uint64_t needed = sequence - capacity + 1;
+    while (myGate.load(std::memory_order_acquire) < needed)
+    {
+        std::uint64_t slowest = slowestCursor();
+        if (slowest == NO_CURSOR)
+        {
+            slowest = sequence;
+        }
+        std::uint64_t gate = myGate.load(std::memory_order_relaxed);
+        while ((gate < slowest) && !myGate.compare_exchange_weak(gate, slowest, std::memory_order_acq_rel))
+        {
+        }
+        if (slowest < needed)
+        {
+            std::this_thread::yield();
+        }
+    }
+}
+
+std::uint64_t LedgerFeed::publish(const Posting& posting) noexcept
+{
+    const std::uint64_t sequence = myClaimed.fetch_add(1, std::memory_order_acq_rel);
+    if (myPolicy == BLOCK)
+    {
+        waitForSubscribers(sequence);
+    }
+
+    // The previous occupant of the slot must be completely written before
+    // it is reused; it almost always is already
+    Slot& slot = mySlots[sequence & myMask];
+    const std::uint64_t previous = (sequence > myMask) ? 2 * (sequence - myMask - 1) + 2 : 0;
+    while (slot.version.load(std::memory_order_acquire) < previous)
+    {
+        std::this_thread::yield();
+    }
+
+    slot.version.store(2 * sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.header.store((static_cast<std::uint64_t>(static_cast<std::uint32_t>(posting.account)) << 8)
+        | static_cast<std::uint8_t>(posting.type), std::memory_order_relaxed);
+    slot.amount.store(bitsOf(posting.amount), std::memory_order_relaxed);
+    slot.balance.store(bitsOf(posting.balance), std::memory_order_relaxed);
+    slot.version.store(2 * sequence + 2, std::memory_order_release);
+    return (sequence);
+}
+
+std::uint64_t LedgerFeed::oldestSequence() const
+{
+    const std::uint64_t claimed = myClaimed.load(std::memory_order_acquire);
+    return ((claimed > myMask + 1) ? claimed - (myMask + 1) : 0);
+}
+
+std::unique_ptr<LedgerFeed::Subscription> LedgerFeed::subscribe()
+{
+    return (subscribe(nextSequence()));
+}
+
+std::unique_ptr<LedgerFeed::Subscription> LedgerFeed::subscribe(std::uint64_t from)
+{
+    for (std::size_t slot = 0; slot < MAX_SUBSCRIBERS; slot++)
+    {
+        std::uint64_t expected = NO_CURSOR;
+        if (myCursors[slot].next.compare_exchange_strong(expected, from, std::memory_order_acq_rel))
+        {
+            return (std::unique_ptr<Subscription>(new Subscription(*this, slot, from)));
+        }
+    }
+    return (nullptr);
+}
+
+LedgerFeed::Subscription::Subscription(LedgerFeed& feed, std::size_t slot, std::uint64_t from) :
+    myFeed(feed),
+    mySlot(slot),
+    myNext(from)
+{
+    const std::uint64_t oldest = myFeed.oldestSequence();
+    if (myNext < oldest)
+    {
+        myLost = oldest - myNext;
+        myNext = oldest;
+        myFeed.myCursors[mySlot].next.store(myNext, std::memory_order_release);
+    }
+}
+
+LedgerFeed::Subscription::~Subscription()
+{
+    myFeed.myCursors[mySlot].next.store(NO_CURSOR, std::memory_order_release);
+}
+
+std::size_t LedgerFeed::Subscription::poll(LedgerEvent* events, std::size_t max)
+{
+    std::size_t count = 0;
+    while (count < max)
+    {
+        const Slot& slot = myFeed.mySlots[myNext & myFeed.myMask];
+        const std::uint64_t published = 2 * myNext + 2;
+        const std::uint64_t version = slot.version.load(std::memory_order_acquire);
+
+        if (version == published)
+        {
+            const std::uint64_t header = slot.header.load(std::memory_order_relaxed);
+            const std::uint64_t amount = slot.amount.load(std::memory_order_relaxed);
+            const std::uint64_t balance = slot.balance.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.version.load(std::memory_order_relaxed) == published)
+            {
+                events[count++] = LedgerEvent{myNext, static_cast<int>(static_cast<std::uint32_t>(header >> 8)),
+                    static_cast<UserRequest>(header & 0xff), doubleOf(amount), doubleOf(balance)};
+                myNext++;
+                continue;
+            }
+        }
+        else if (version < published)
+        {
+            break;      // not published yet
+        }
+
+        // Overwritten while we were behind: skip to the oldest event the
+        // ring still holds
+        const std::uint64_t oldest = myFeed.oldestSequence();
+        const std::uint64_t resume = std::max(oldest, myNext + 1);
+        myLost += resume - myNext;
+        myNext = resume;
+    }
+
+    myFeed.myCursors[mySlot].next.store(myNext, std::memory_order_release);
+    return (count);
+}
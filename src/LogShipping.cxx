@@ -0,0 +1,636 @@
+#include "LogShipping.hxx"
+
+#include "Account.hxx"
+#include "Bank.hxx"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <new>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "shared-memory ring needs lock-free 64-bit atomics");
+
+// Control block at the start of the shared mapping; the ring bytes follow
+// it. The producer and consumer positions count bytes ever written and
+// read, and live on separate cache lines.
+struct ShippingChannel
+{
+    std::uint64_t magic;
+    std::uint64_t capacity;
+
+    alignas(64) std::atomic<std::uint64_t> writePos;
+    std::atomic<std::uint64_t> published;       // next sequence number
+    std::atomic<std::uint64_t> publishedAt;     // timestamp of the newest record
+
+    alignas(64) std::atomic<std::uint64_t> readPos;
+    std::atomic<std::uint32_t> flushRequested;
+    std::atomic<std::uint32_t> promoted;
+
+    char* ring()
+    {
+        return (reinterpret_cast<char*>(this) + sizeof(ShippingChannel));
+    }
+};
+
+namespace
+{
+    const std::uint64_t CHANNEL_MAGIC = 0x324c4e4843415441ull;  // "ATACHNL2"
+    const char LOG_FILE_MAGIC[8] = {'A', 'T', 'M', 'W', 'A', 'L', '2', '\0'};
+
+    enum RecordKind : std::uint8_t {ACCOUNT_OPENED = 1, POSTING, PASSWORD, BALANCE_INQUIRY};
+
+    // Every record is framed as a 32-bit body length, this header, then
+    // `textLength` bytes of text (the password for PASSWORD records)
+    struct WireHeader
+    {
+        std::uint64_t sequence;
+        std::uint64_t timestamp;
+        double amount;
+        double balance;
+        std::int64_t entryTime;     // ledger time of the entry, if any
+        std::int32_t account;
+        std::uint8_t kind;
+        std::uint8_t type;
+        std::uint16_t textLength;
+    };
+
+    const std::size_t FRAME_PREFIX = sizeof(std::uint32_t);
+    const std::size_t MAX_TEXT = 0xffff;
+    const std::size_t MIN_RING_BYTES = 256;
+    const std::size_t STANDBY_BATCH = 256;
+
+    std::uint64_t steadyNanos()
+    {
+        return (static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count()));
+    }
+
+    // The log holds passwords, so it is created readable by the owner
+    // only, and an existing file is narrowed to that before it is reused
+    bool createPrivateFile(const std::string& path)
+    {
+        const int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+        if (fd < 0)
+        {
+            return (false);
+        }
+        const bool ok = (::fchmod(fd, 0600) == 0);
+        ::close(fd);
+        return (ok);
+    }
+
+    std::size_t roundUpToPowerOfTwo(std::size_t value)
+    {
+        std::size_t result = MIN_RING_BYTES;
+        while (result < value)
+        {
+            result <<= 1;
+        }
+        return (result);
+    }
+
+    // Ring copies that wrap at the end of the buffer
+    void copyIn(char* ring, std::uint64_t capacity, std::uint64_t pos, const char* from, std::size_t size)
+    {
+        const std::size_t offset = static_cast<std::size_t>(pos & (capacity - 1));
+        const std::size_t first = std::min<std::size_t>(size, capacity - offset);
+        std::memcpy(ring + offset, from, first);
+        std::memcpy(ring, from + first, size - first);
+    }
+
+    void copyOut(const char* ring, std::uint64_t capacity, std::uint64_t pos, char* to, std::size_t size)
+    {
+        const std::size_t offset = static_cast<std::size_t>(pos & (capacity - 1));
+        const std::size_t first = std::min<std::size_t>(size, capacity - offset);
+        std::memcpy(to, ring + offset, first);
+        std::memcpy(to + first, ring, size - first);
+    }
+
+    // Sequence to catch up to when only `budget` more records may be applied
+    std::uint64_t limitedTarget(std::uint64_t next, std::uint64_t target, std::size_t budget)
+    {
+        return ((target - next > budget) ? next + budget : target);
+    }
+
+    bool validBodyLength(std::uint32_t length)
+    {
+        return ((length >= sizeof(WireHeader)) && (length <= sizeof(WireHeader) + MAX_TEXT));
+    }
+
+    // `body` holds a frame without its length prefix
+    bool decodeRecord(const char* body, std::size_t length, WireHeader& header, std::string& text)
+    {
+        std::memcpy(&header, body, sizeof(WireHeader));
+        if (sizeof(WireHeader) + header.textLength != length)
+        {
+            return (false);
+        }
+        text.assign(body + sizeof(WireHeader), header.textLength);
+        return (true);
+    }
+}
+
+struct StandbyReplica::Record
+{
+    WireHeader header;
+    std::string text;
+};
+
+
+LogShipper::LogShipper(const std::string& channel, const std::string& logPath, std::size_t ringBytes) :
+    myName(channel)
+{
+    if (createPrivateFile(logPath))
+    {
+        myLog.open(logPath, std::ios::binary | std::ios::trunc);
+    }
+    myLog.write(LOG_FILE_MAGIC, sizeof(LOG_FILE_MAGIC));
+
+    const std::size_t capacity = roundUpToPowerOfTwo(ringBytes);
+    ::shm_unlink(myName.c_str());
+    int fd = ::shm_open(myName.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0)
+    {
+        return;
+    }
+    const std::size_t bytes = sizeof(ShippingChannel) + capacity;
+    void* mapping = MAP_FAILED;
+    if (::ftruncate(fd, static_cast<off_t>(bytes)) == 0)
+    {
+        mapping = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        ::shm_unlink(myName.c_str());
+        return;
+    }
+
+    myChannel = new (mapping) ShippingChannel();
+    myChannel->capacity = capacity;
+    myChannel->writePos.store(0, std::memory_order_relaxed);
+    myChannel->published.store(0, std::memory_order_relaxed);
+    myChannel->publishedAt.store(0, std::memory_order_relaxed);
+    myChannel->readPos.store(0, std::memory_order_relaxed);
+    myChannel->flushRequested.store(0, std::memory_order_relaxed);
+    myChannel->promoted.store(0, std::memory_order_relaxed);
+    // Published last: a standby that sees the magic sees a ready channel
+    std::atomic_thread_fence(std::memory_order_release);
+    myChannel->magic = CHANNEL_MAGIC;
+    myMappedBytes = bytes;
+}
+
+LogShipper::~LogShipper() noexcept
+{
+    std::lock_guard<std::mutex> lock(myMutex);
+    myLog.flush();
+    if (myChannel)
+    {
+        // A standby keeps its own mapping and can still drain the ring
+        ::munmap(myChannel, myMappedBytes);
+        ::shm_unlink(myName.c_str());
+    }
+}
+
+bool LogShipper::good() const
+{
+    std::lock_guard<std::mutex> lock(myMutex);
+    return ((myChannel != nullptr) && myLog.good());
+}
+
+void LogShipper::onPosting(const Posting& posting) noexcept
+{
+    append(POSTING, posting.account, static_cast<std::uint8_t>(posting.type),
+           posting.amount, posting.balance, posting.time, nullptr);
+}
+
+void LogShipper::onAccountOpened(int account) noexcept
+{
+    append(ACCOUNT_OPENED, account, 0, 0.0, 0.0, 0, nullptr);
+}
+
+void LogShipper::onPasswordChanged(int account, const std::string& password) noexcept
+{
+    if (password.size() > MAX_TEXT)
+    {
+        std::lock_guard<std::mutex> lock(myMutex);
+        myRejectedPasswords++;
+        return;
+    }
+    append(PASSWORD, account, 0, 0.0, 0.0, 0, &password);
+}
+
+void LogShipper::onBalanceInquiry(int account, double balance, LedgerTime time) noexcept
+{
+    append(BALANCE_INQUIRY, account, static_cast<std::uint8_t>(UserRequest::REQUEST_BALANCE),
+           0.0, balance, time, nullptr);
+}
+
+void LogShipper::flush()
+{
+    std::lock_guard<std::mutex> lock(myMutex);
+    myLog.flush();
+}
+
+std::uint64_t LogShipper::nextSequence() const
+{
+    std::lock_guard<std::mutex> lock(myMutex);
+    return (myNextSequence);
+}
+
+std::uint64_t LogShipper::ringOverflows() const
+{
+    std::lock_guard<std::mutex> lock(myMutex);
+    return (myOverflows);
+}
+
+std::uint64_t LogShipper::rejectedPasswords() const
+{
+    std::lock_guard<std::mutex> lock(myMutex);
+    return (myRejectedPasswords);
+}
+
+bool LogShipper::standbyPromoted() const
+{
+    return ((myChannel != nullptr) && (myChannel->promoted.load(std::memory_order_acquire) != 0));
+}
+
+void LogShipper::append(std::uint8_t kind, int account, std::uint8_t type,
+                        double amount, double balance, LedgerTime time,
+                        const std::string* text) noexcept
+{
+    const std::size_t textLength = text ? text->size() : 0;
+    const std::uint32_t bodyLength = static_cast<std::uint32_t>(sizeof(WireHeader) + textLength);
+    char frame[FRAME_PREFIX + sizeof(WireHeader) + 64];
+    std::vector<char> largeFrame;
+    char* out = frame;
+    if (FRAME_PREFIX + bodyLength > sizeof(frame))
+    {
+        largeFrame.resize(FRAME_PREFIX + bodyLength);
+        out = largeFrame.data();
+    }
+
+    std::lock_guard<std::mutex> lock(myMutex);
+
+    // Stamped under the lock, so timestamps follow sequence order
+    WireHeader header;
+    header.sequence = myNextSequence++;
+    header.timestamp = steadyNanos();
+    header.amount = amount;
+    header.balance = balance;
+    header.entryTime = time;
+    header.account = account;
+    header.kind = kind;
+    header.type = type;
+    header.textLength = static_cast<std::uint16_t>(textLength);
+
+    std::memcpy(out, &bodyLength, FRAME_PREFIX);
+    std::memcpy(out + FRAME_PREFIX, &header, sizeof(WireHeader));
+    if (textLength)
+    {
+        std::memcpy(out + FRAME_PREFIX + sizeof(WireHeader), text->data(), textLength);
+    }
+    const std::size_t frameSize = FRAME_PREFIX + bodyLength;
+    myLog.write(out, static_cast<std::streamsize>(frameSize));
+
+    if (!myChannel)
+    {
+        return;
+    }
+
+    const std::uint64_t capacity = myChannel->capacity;
+    const std::uint64_t write = myChannel->writePos.load(std::memory_order_relaxed);
+    const std::uint64_t read = myChannel->readPos.load(std::memory_order_acquire);
+    if ((capacity - (write - read) >= frameSize)
+        && (myChannel->promoted.load(std::memory_order_relaxed) == 0))
+    {
+        copyIn(myChannel->ring(), capacity, write, out, frameSize);
+        myChannel->writePos.store(write + frameSize, std::memory_order_release);
+    }
+    else
+    {
+        // The standby will look for this record in the log, so it must
+        // reach the file before the sequence number is published
+        myOverflows++;
+        myLog.flush();
+    }
+    if (myChannel->flushRequested.exchange(0, std::memory_order_acq_rel))
+    {
+        myLog.flush();
+    }
+    myChannel->publishedAt.store(header.timestamp, std::memory_order_relaxed);
+    myChannel->published.store(header.sequence + 1, std::memory_order_release);
+}
+
+
+StandbyReplica::StandbyReplica(Bank& bank, const std::string& channel, const std::string& logPath,
+                               std::uint64_t fromSequence) :
+    myBank(bank),
+    myLogPath(logPath),
+    myNext(fromSequence)
+{
+    int fd = ::shm_open(channel.c_str(), O_RDWR, 0);
+    if (fd < 0)
+    {
+        return;
+    }
+    struct stat info;
+    void* mapping = MAP_FAILED;
+    if ((::fstat(fd, &info) == 0) && (static_cast<std::size_t>(info.st_size) > sizeof(ShippingChannel)))
+    {
+        mapping = ::mmap(nullptr, static_cast<std::size_t>(info.st_size),
+                         PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        return;
+    }
+
+    ShippingChannel* shipping = static_cast<ShippingChannel*>(mapping);
+    const std::size_t bytes = static_cast<std::size_t>(info.st_size);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if ((shipping->magic != CHANNEL_MAGIC) || (sizeof(ShippingChannel) + shipping->capacity != bytes))
+    {
+        ::munmap(mapping, bytes);
+        return;
+    }
+    myChannel = shipping;
+    myMappedBytes = bytes;
+}
+
+StandbyReplica::~StandbyReplica() noexcept
+{
+    stop();
+    if (myChannel)
+    {
+        ::munmap(myChannel, myMappedBytes);
+    }
+}
+
+bool StandbyReplica::good() const
+{
+    return (myChannel != nullptr);
+}
+
+std::size_t StandbyReplica::poll(std::size_t max)
+{
+    if (!myChannel)
+    {
+        return (0);
+    }
+
+    const std::uint64_t capacity = myChannel->capacity;
+    const char* ring = myChannel->ring();
+    std::uint64_t read = myChannel->readPos.load(std::memory_order_relaxed);
+    std::vector<char> body;
+    Record record;
+    std::size_t applied = 0;
+
+    while (applied < max)
+    {
+        const std::uint64_t published = myChannel->published.load(std::memory_order_acquire);
+        const std::uint64_t next = myNext.load(std::memory_order_relaxed);
+        if (next >= published)
+        {
+            break;
+        }
+
+        const std::uint64_t write = myChannel->writePos.load(std::memory_order_acquire);
+        if (read == write)
+        {
+            // Everything still missing was dropped by the ring
+            const std::uint64_t before = next;
+            catchUp(limitedTarget(next, published, max - applied));
+            applied += static_cast<std::size_t>(myNext.load(std::memory_order_relaxed) - before);
+            if (myNext.load(std::memory_order_relaxed) == before)
+            {
+                break;
+            }
+            continue;
+        }
+
+        std::uint32_t length = 0;
+        char prefix[FRAME_PREFIX];
+        copyOut(ring, capacity, read, prefix, FRAME_PREFIX);
+        std::memcpy(&length, prefix, FRAME_PREFIX);
+        if (!validBodyLength(length) || (write - read < FRAME_PREFIX + length))
+        {
+            break;
+        }
+        body.resize(length);
+        copyOut(ring, capacity, read + FRAME_PREFIX, body.data(), length);
+        if (!decodeRecord(body.data(), length, record.header, record.text))
+        {
+            break;
+        }
+
+        if (record.header.sequence > next)
+        {
+            // Records between here and the ring's head went by log only
+            const std::uint64_t before = next;
+            catchUp(limitedTarget(next, record.header.sequence, max - applied));
+            applied += static_cast<std::size_t>(myNext.load(std::memory_order_relaxed) - before);
+            if (myNext.load(std::memory_order_relaxed) != record.header.sequence)
+            {
+                break;
+            }
+            if (applied == max)
+            {
+                break;
+            }
+        }
+        if (record.header.sequence == myNext.load(std::memory_order_relaxed))
+        {
+            apply(record, steadyNanos());
+            applied++;
+        }
+        read += FRAME_PREFIX + length;
+        myChannel->readPos.store(read, std::memory_order_release);
+    }
+    return (applied);
+}
+
+void StandbyReplica::catchUp(std::uint64_t until)
+{
+    if (!myLog.is_open())
+    {
+        myLog.open(myLogPath, std::ios::binary);
+        if (!myLog.is_open())
+        {
+            return;
+        }
+    }
+    myLog.clear();
+    myLog.seekg(static_cast<std::streamoff>(myLogOffset));
+
+    if (myLogOffset == 0)
+    {
+        char magic[sizeof(LOG_FILE_MAGIC)];
+        if (!myLog.read(magic, sizeof(magic)))
+        {
+            myChannel->flushRequested.store(1, std::memory_order_release);
+            return;
+        }
+        if (std::memcmp(magic, LOG_FILE_MAGIC, sizeof(magic)) != 0)
+        {
+            return;
+        }
+        myLogOffset = sizeof(LOG_FILE_MAGIC);
+    }
+
+    std::vector<char> body;
+    Record record;
+    while (myNext.load(std::memory_order_relaxed) < until)
+    {
+        std::uint32_t length = 0;
+        if (!myLog.read(reinterpret_cast<char*>(&length), FRAME_PREFIX) || !validBodyLength(length))
+        {
+            break;
+        }
+        body.resize(length);
+        if (!myLog.read(body.data(), length) || !decodeRecord(body.data(), length, record.header, record.text))
+        {
+            break;
+        }
+        myLogOffset += FRAME_PREFIX + length;
+
+        const std::uint64_t next = myNext.load(std::memory_order_relaxed);
+        if (record.header.sequence < next)
+        {
+            continue;
+        }
+        if (record.header.sequence > next)
+        {
+            return;
+        }
+        apply(record, steadyNanos());
+        myCaughtUp.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    if (myNext.load(std::memory_order_relaxed) < until)
+    {
+        // The rest is still in the primary's write buffer
+        myChannel->flushRequested.store(1, std::memory_order_release);
+    }
+}
+
+void StandbyReplica::apply(const Record& record, std::uint64_t now)
+{
+    const WireHeader& header = record.header;
+    bool matches = true;
+
+    if (header.kind == ACCOUNT_OPENED)
+    {
+        matches = (myBank.addAccount()->getAccountNumber() == header.account);
+    }
+    else
+    {
+        Account* account = myBank.accountAt(header.account);
+        if (!account)
+        {
+            matches = false;
+        }
+        else if (header.kind == POSTING)
+        {
+            const Transaction posting(static_cast<UserRequest>(header.type), header.amount);
+            matches = (account->appendPostings(&posting, &header.entryTime, 1) == header.balance);
+        }
+        else if (header.kind == PASSWORD)
+        {
+            account->setPassword(record.text.c_str());
+        }
+        else if (header.kind == BALANCE_INQUIRY)
+        {
+            // Replayed with the primary's time rather than as a new inquiry
+            const Transaction inquiry(UserRequest::REQUEST_BALANCE, header.balance);
+            matches = (account->appendPostings(&inquiry, &header.entryTime, 1) == header.balance);
+        }
+    }
+    if (!matches)
+    {
+        myDivergences.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    myApplyDelay.record((now > header.timestamp) ? now - header.timestamp : 0);
+    myLastApplied.store(header.timestamp, std::memory_order_relaxed);
+    myNext.store(header.sequence + 1, std::memory_order_release);
+}
+
+void StandbyReplica::start()
+{
+    if (myThread.joinable() || !myChannel)
+    {
+        return;
+    }
+    myStopping.store(false, std::memory_order_relaxed);
+    myThread = std::thread([this]()
+    {
+        while (!myStopping.load(std::memory_order_acquire))
+        {
+            if (poll(STANDBY_BATCH) == 0)
+            {
+                std::this_thread::sleep_for(std::chrono::microseconds(50));
+            }
+        }
+    });
+}
+
+void StandbyReplica::stop()
+{
+    myStopping.store(true, std::memory_order_release);
+    if (myThread.joinable())
+    {
+        myThread.join();
+    }
+}
+
+std::uint64_t StandbyReplica::promote()
+{
+    stop();
+    if (myChannel)
+    {
+        // Marked first, so the primary stops writing to the ring and what
+        // it publishes from here on is in the log before it is published.
+        // Draining until nothing is left then cannot miss a record
+        // published between the last poll and the mark.
+        myChannel->promoted.store(1, std::memory_order_seq_cst);
+        for (;;)
+        {
+            const std::uint64_t published = myChannel->published.load(std::memory_order_acquire);
+            if ((myNext.load(std::memory_order_relaxed) >= published) || (poll() == 0))
+            {
+                break;
+            }
+        }
+    }
+    return (myNext.load(std::memory_order_acquire));
+}
+
+StandbyReplica::Lag StandbyReplica::lag() const
+{
+    Lag result = {0, myNext.load(std::memory_order_acquire), 0, 0};
+    if (!myChannel)
+    {
+        return (result);
+    }
+    result.published = myChannel->published.load(std::memory_order_acquire);
+    if (result.published > result.applied)
+    {
+        result.records = result.published - result.applied;
+        std::uint64_t newest = myLastApplied.load(std::memory_order_relaxed);
+        if (newest == 0)
+        {
+            newest = myChannel->publishedAt.load(std::memory_order_relaxed);
+        }
+        const std::uint64_t now = steadyNanos();
+        result.nanoseconds = (now > newest) ? now - newest : 0;
+    }
+    return (result);
+}
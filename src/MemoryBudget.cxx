@@ -0,0 +1,149 @@
+#include "MemoryBudget.hxx"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#include <unistd.h>
+
+namespace
+{
+    const char SPILL_FILE_MAGIC[8] = {'A', 'T', 'M', 'S', 'P', 'I', 'L', '1'};
+
+    // One ledger entry in a spill file
+    struct SpillRecord
+    {
+        std::int64_t time;
+        double amount;
+        std::uint8_t type;
+        std::uint8_t reserved[7];
+    };
+
+    std::string spillPath(const std::string& directory, int account)
+    {
+        return (directory + "/ledger-" + std::to_string(account) + ".spill");
+    }
+}
+
+const std::size_t MemoryTracker::STRIPES;
+
+MemoryStats MemoryTracker::stats() const
+{
+    // Counters are read one at a time, so totals taken while the bank is
+    // busy may be off by the postings that landed in between
+    MemoryStats stats;
+    std::int64_t bytes[COMPONENTS];
+    for (int c = 0; c < COMPONENTS; c++)
+    {
+        bytes[c] = myBytes[c].load(std::memory_order_relaxed);
+    }
+    std::int64_t used = 0;
+    std::int64_t entries = 0;
+    for (const Stripe& stripe : myStripes)
+    {
+        used += stripe.usedBytes.load(std::memory_order_relaxed);
+        entries += stripe.entries.load(std::memory_order_relaxed);
+    }
+
+    stats.directoryBytes = static_cast<std::size_t>(bytes[DIRECTORY]);
+    stats.accountBytes = static_cast<std::size_t>(bytes[ACCOUNTS]);
+    stats.ledgerBytes = static_cast<std::size_t>(bytes[LEDGER]);
+    stats.credentialBytes = static_cast<std::size_t>(bytes[CREDENTIALS]);
+    stats.ledgerUsedBytes = static_cast<std::size_t>(used);
+    stats.ledgerEntries = static_cast<std::size_t>(entries);
+    return (stats);
+}
+
+void MemoryTracker::setHighWater(std::size_t bytes)
+{
+    myHighWater.store(static_cast<std::int64_t>(bytes), std::memory_order_relaxed);
+    if ((bytes != 0) && (totalBytes() > bytes) && !myPressure.exchange(true, std::memory_order_acq_rel))
+    {
+        myWake.notify_one();
+    }
+}
+
+bool MemoryTracker::awaitPressure()
+{
+    std::unique_lock<std::mutex> lock(myWakeMutex);
+    while (!myStopping && !myPressure.exchange(false, std::memory_order_acq_rel))
+    {
+        // addBytes() notifies without the mutex, so a wakeup can slip in
+        // between the check and the wait; the timeout bounds the delay
+        myWake.wait_for(lock, std::chrono::milliseconds(50));
+    }
+    return (!myStopping);
+}
+
+void MemoryTracker::stopWaiting()
+{
+    {
+        std::lock_guard<std::mutex> lock(myWakeMutex);
+        myStopping = true;
+    }
+    myWake.notify_all();
+}
+
+bool spillLedger(const std::string& directory, int account, const TransactionView& entries)
+{
+    const std::string path = spillPath(directory, account);
+    std::ofstream out(path, std::ios::binary | std::ios::app);
+    if (!out)
+    {
+        return (false);
+    }
+    out.seekp(0, std::ios::end);
+    const std::streamoff before = out.tellp();
+    if (before == 0)
+    {
+        out.write(SPILL_FILE_MAGIC, sizeof(SPILL_FILE_MAGIC));
+    }
+
+    for (std::size_t i = 0; i < entries.size(); i++)
+    {
+        SpillRecord record = {};
+        record.time = entries.time(i);
+        record.amount = std::get<1>(entries[i]);
+        record.type = static_cast<std::uint8_t>(std::get<0>(entries[i]));
+        out.write(reinterpret_cast<const char*>(&record), sizeof(record));
+    }
+    out.close();
+    if (!out.fail())
+    {
+        return (true);
+    }
+
+    // The ledger keeps these entries and spills them again next time, so
+    // whatever part of them reached the file is taken back out
+    if (before <= 0)
+    {
+        std::remove(path.c_str());
+    }
+    else
+    {
+        ::truncate(path.c_str(), static_cast<off_t>(before));
+    }
+    return (false);
+}
+
+bool loadSpilledLedger(const std::string& directory, int account,
+                       std::vector<Transaction>& transactions, std::vector<LedgerTime>& times)
+{
+    std::ifstream in(spillPath(directory, account), std::ios::binary);
+    char magic[sizeof(SPILL_FILE_MAGIC)];
+    if (!in.read(magic, sizeof(magic)) || (std::memcmp(magic, SPILL_FILE_MAGIC, sizeof(magic)) != 0))
+    {
+        return (false);
+    }
+
+    transactions.clear();
+    times.clear();
+    SpillRecord record;
+    while (in.read(reinterpret_cast<char*>(&record), sizeof(record)))
+    {
+        transactions.emplace_back(static_cast<UserRequest>(record.type), record.amount);
+        times.push_back(record.time);
+    }
+    // A partial record at the end means a torn write
+    return (in.gcount() == 0);
+}
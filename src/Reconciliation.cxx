@@ -0,0 +1,124 @@
+#include "Reconciliation.hxx"
+
+#include "Account.hxx"
+#include "Bank.hxx"
+#include "ExactSum.hxx"
+#include "ParallelFor.hxx"
+
+#include <cstring>
+
+namespace
+{
+    struct WorkerTotals
+    {
+        std::size_t accounts = 0;
+        std::size_t postings = 0;
+        std::size_t inquiries = 0;
+        ExactSum balances;
+        ExactSum ledger;
+        std::vector<ReconciliationMismatch> mismatches;
+    };
+
+    // Bitwise, so -0.0 vs 0.0 counts as a mismatch and NaN matches itself
+    bool sameBits(double a, double b)
+    {
+        return (std::memcmp(&a, &b, sizeof(double)) == 0);
+    }
+
+    // Only needed for the mismatch report, so computed on demand
+    double exactLedgerSum(const TransactionView& transactions)
+    {
+        ExactSum sum;
+        for (const Transaction& entry : transactions)
+        {
+            const UserRequest type = std::get<0>(entry);
+            if ((type == UserRequest::REQUEST_DEPOSIT) || (type == UserRequest::REQUEST_CARRY_FORWARD))
+            {
+                sum.add(std::get<1>(entry));
+            }
+            else if (type == UserRequest::REQUEST_WITHDRAW)
+            {
+                sum.subtract(std::get<1>(entry));
+            }
+        }
+        return (sum.value());
+    }
+}
+
+ReconciliationReport reconcileBank(const Bank& bank, unsigned threads)
+{
+    const std::size_t count = static_cast<std::size_t>(bank.accountCount());
+    if (threads == 0)
+    {
+        threads = defaultThreadCount();
+    }
+    std::vector<WorkerTotals> workers(threads);
+
+    parallelForRanges(count, threads, [&](unsigned worker, std::size_t begin, std::size_t end)
+    {
+        WorkerTotals& totals = workers[worker];
+        for (std::size_t n = begin; n < end; n++)
+        {
+            const Account* account = bank.accountAt(static_cast<int>(n));
+            if (!account)
+            {
+                continue;
+            }
+
+            account->withLedger([&](double balance, const TransactionView& transactions)
+            {
+                double expected = 0.0;
+                for (const Transaction& entry : transactions)
+                {
+                    switch (std::get<0>(entry))
+                    {
+                        case UserRequest::REQUEST_DEPOSIT:
+                            expected += std::get<1>(entry);
+                            totals.ledger.add(std::get<1>(entry));
+                            totals.postings++;
+                            break;
+                        case UserRequest::REQUEST_WITHDRAW:
+                            expected -= std::get<1>(entry);
+                            totals.ledger.subtract(std::get<1>(entry));
+                            totals.postings++;
+                            break;
+                        case UserRequest::REQUEST_CARRY_FORWARD:
+                            expected += std::get<1>(entry);
+                            totals.ledger.add(std::get<1>(entry));
+                            break;
+                        case UserRequest::REQUEST_BALANCE:
+                            totals.inquiries++;
+                            break;
+                        default:
+                            break;
+                    }
+                }
+
+                totals.accounts++;
+                totals.balances.add(balance);
+                if (!sameBits(balance, expected))
+                {
+                    totals.mismatches.push_back(ReconciliationMismatch{
+                        account->getAccountNumber(), balance, expected, exactLedgerSum(transactions)});
+                }
+            });
+        }
+    });
+
+    // Workers own contiguous account ranges, so mismatches stay in order
+    ReconciliationReport report;
+    ExactSum balances;
+    ExactSum ledger;
+    for (WorkerTotals& totals : workers)
+    {
+        report.accounts += totals.accounts;
+        report.postings += totals.postings;
+        report.inquiries += totals.inquiries;
+        balances.add(totals.balances);
+        ledger.add(totals.ledger);
+        report.mismatches.insert(report.mismatches.end(), totals.mismatches.begin(), totals.mismatches.end());
+    }
+    report.controlTotal = balances.value();
+    report.ledgerTotal = ledger.value();
+    return (report);
+}
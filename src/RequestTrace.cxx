@@ -0,0 +1,209 @@
+#include "RequestTrace.hxx"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+namespace
+{
+    const char TRACE_FILE_MAGIC[8] = {'A', 'T', 'M', 'T', 'R', 'C', '1', '\0'};
+
+    // Tag byte: high bit set for VIEW_ACCOUNT, otherwise the UserRequest
+    const std::uint8_t VIEW_ACCOUNT_TAG = 0x80;
+
+    bool hasAmount(UserRequest request)
+    {
+        return ((request == UserRequest::REQUEST_DEPOSIT) || (request == UserRequest::REQUEST_WITHDRAW));
+    }
+
+    char* putVarint(char* out, std::uint64_t value)
+    {
+        while (value >= 0x80)
+        {
+            *out++ = static_cast<char>((value & 0x7f) | 0x80);
+            value >>= 7;
+        }
+        *out++ = static_cast<char>(value);
+        return (out);
+    }
+
+    bool getVarint(const char*& in, const char* end, std::uint64_t& value)
+    {
+        value = 0;
+        for (int shift = 0; (in != end) && (shift < 64); shift += 7)
+        {
+            std::uint8_t byte = static_cast<std::uint8_t>(*in++);
+            value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80))
+            {
+                return (true);
+            }
+        }
+        return (false);
+    }
+
+    std::uint64_t zigzag(std::int64_t value)
+    {
+        return ((static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63));
+    }
+
+    std::int64_t unzigzag(std::uint64_t value)
+    {
+        return (static_cast<std::int64_t>(value >> 1) ^ -static_cast<std::int64_t>(value & 1));
+    }
+}
+
+RequestTraceWriter::RequestTraceWriter(const std::string& path) :
+    myOut(path, std::ios::binary | std::ios::trunc),
+    myStart(std::chrono::steady_clock::now()),
+    myNextSession(0)
+{
+    myOut.write(TRACE_FILE_MAGIC, sizeof(TRACE_FILE_MAGIC));
+}
+
+RequestTraceWriter::~RequestTraceWriter()
+{
+    close();
+}
+
+bool RequestTraceWriter::good() const
+{
+    std::lock_guard<std::mutex> lock(myMutex);
+    return (myOut.good());
+}
+
+bool RequestTraceWriter::close()
+{
+    std::lock_guard<std::mutex> lock(myMutex);
+    if (myOut.is_open())
+    {
+        myOut.close();
+    }
+    return (!myOut.fail());
+}
+
+std::uint64_t RequestTraceWriter::recordCount() const
+{
+    std::lock_guard<std::mutex> lock(myMutex);
+    return (myCount);
+}
+
+void RequestTraceWriter::recordViewAccount(std::uint32_t session, int account)
+{
+    RequestTraceRecord record;
+    record.session = session;
+    record.kind = RequestTraceRecord::Kind::VIEW_ACCOUNT;
+    record.account = account;
+    append(record);
+}
+
+void RequestTraceWriter::recordRequest(std::uint32_t session, UserRequest request, double amount)
+{
+    RequestTraceRecord record;
+    record.session = session;
+    record.request = request;
+    record.amount = hasAmount(request) ? amount : 0.0;
+    append(record);
+}
+
+void RequestTraceWriter::append(const RequestTraceRecord& record)
+{
+    char buffer[1 + 3 * 10 + sizeof(double)];
+    char* out = buffer;
+
+    std::lock_guard<std::mutex> lock(myMutex);
+    if (!myOut.is_open())
+    {
+        return;
+    }
+
+    // Timestamp under the lock, so offsets in the file never go backwards
+    std::uint64_t offset = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - myStart).count());
+    offset = std::max(offset, myLastOffset);
+
+    if (record.kind == RequestTraceRecord::Kind::VIEW_ACCOUNT)
+    {
+        *out++ = static_cast<char>(VIEW_ACCOUNT_TAG);
+    }
+    else
+    {
+        *out++ = static_cast<char>(static_cast<std::uint8_t>(record.request) & 0x7f);
+    }
+    out = putVarint(out, offset - myLastOffset);
+    out = putVarint(out, record.session);
+    if (record.kind == RequestTraceRecord::Kind::VIEW_ACCOUNT)
+    {
+        out = putVarint(out, zigzag(record.account));
+    }
+    else if (hasAmount(record.request))
+    {
+        std::memcpy(out, &record.amount, sizeof(double));
+        out += sizeof(double);
+    }
+
+    myOut.write(buffer, out - buffer);
+    myLastOffset = offset;
+    myCount++;
+}
+
+bool loadRequestTrace(const std::string& path, std::vector<RequestTraceRecord>& records)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+    {
+        return (false);
+    }
+    std::vector<char> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    if ((bytes.size() < sizeof(TRACE_FILE_MAGIC))
+        || (std::memcmp(bytes.data(), TRACE_FILE_MAGIC, sizeof(TRACE_FILE_MAGIC)) != 0))
+    {
+        return (false);
+    }
+
+    const char* cursor = bytes.data() + sizeof(TRACE_FILE_MAGIC);
+    const char* end = bytes.data() + bytes.size();
+    std::uint64_t offset = 0;
+    records.clear();
+
+    while (cursor != end)
+    {
+        RequestTraceRecord record;
+        std::uint8_t tag = static_cast<std::uint8_t>(*cursor++);
+        std::uint64_t delta = 0;
+        std::uint64_t session = 0;
+        if (!getVarint(cursor, end, delta) || !getVarint(cursor, end, session))
+        {
+            return (false);
+        }
+        offset += delta;
+        record.offset = offset;
+        record.session = static_cast<std::uint32_t>(session);
+
+        if (tag & VIEW_ACCOUNT_TAG)
+        {
+            std::uint64_t account = 0;
+            if (!getVarint(cursor, end, account))
+            {
+                return (false);
+            }
+            record.kind = RequestTraceRecord::Kind::VIEW_ACCOUNT;
+            record.account = static_cast<int>(unzigzag(account));
+        }
+        else
+        {
+            record.request = static_cast<UserRequest>(tag);
+            if (hasAmount(record.request))
+            {
+                if (static_cast<std::size_t>(end - cursor) < sizeof(double))
+                {
+                    return (false);
+                }
+                std::memcpy(&record.amount, cursor, sizeof(double));
+                cursor += sizeof(double);
+            }
+        }
+        records.push_back(record);
+    }
+    return (true);
+}
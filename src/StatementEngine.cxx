@@ -0,0 +1,158 @@
+#include "StatementEngine.hxx"
+
+#include "Account.hxx"
+#include "Bank.hxx"
+#include "BufferedDisplay.hxx"
+#include "Format.hxx"
+#include "ParallelFor.hxx"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace
+{
+    struct ShardResult
+    {
+        std::size_t accounts = 0;
+        std::size_t entries = 0;
+        std::size_t trimmedCursors = 0;
+        bool failed = false;
+    };
+
+    // One statement: the entries at or after ledger position `from` that
+    // fall in `period`. Returns the number of entries listed; `covered` is
+    // the ledger position just past the last entry the statement covers,
+    // `trimmed` the account's trimmedBefore() as of the statement.
+    // The entries are copied into `page` under the account lock and
+    // written out after it is released, so postings to the account do not
+    // wait on display I/O.
+    std::size_t writeStatement(Account& account, std::size_t from, const TimeRange& period,
+        unsigned requestTypes, BaseDisplay& display, std::vector<Transaction>& page, std::size_t& covered,
+        std::size_t& trimmed)
+    {
+        double opening = 0.0;
+        account.withPeriod(from, period, [&](double balance, std::size_t first, const TransactionView& entries)
+        {
+            opening = balance;
+            page.assign(entries.begin(), entries.end());
+            covered = first + entries.size();
+            trimmed = account.trimmedBefore();
+        });
+
+        char header[32] = "Account ";
+        char* end = formatAmountFixed(header + 8, header + sizeof(header) - 2,
+            account.getAccountNumber(), 0).ptr;
+        *end++ = '\n';
+        *end = '\0';
+        display.showInfoToUser(header);
+        display.showInfoToUser("Opening Balance");
+        display.showBalance(opening);
+
+        std::size_t listed = 0;
+        double balance = opening;
+        for (const Transaction& entry : page)
+        {
+            const UserRequest type = std::get<0>(entry);
+            if ((type == UserRequest::REQUEST_DEPOSIT) || (type == UserRequest::REQUEST_CARRY_FORWARD))
+            {
+                balance += std::get<1>(entry);
+            }
+            else if (type == UserRequest::REQUEST_WITHDRAW)
+            {
+                balance -= std::get<1>(entry);
+            }
+
+            if (requestTypes & requestBit(type))
+            {
+                display.showTransaction(type, std::get<1>(entry));
+                listed++;
+            }
+        }
+
+        display.showInfoToUser("Closing Balance");
+        display.showBalance(balance);
+        display.showInfoToUser("\n");
+        return (listed);
+    }
+}
+
+StatementEngine::StatementEngine(const StatementOptions& options) :
+    myOptions(options)
+{
+}
+
+std::string StatementEngine::shardPath(unsigned shard) const
+{
+    return (myOptions.directory + "/" + myOptions.prefix + "-" + std::to_string(shard) + ".txt");
+}
+
+StatementReport StatementEngine::run(Bank& bank)
+{
+    const std::size_t count = static_cast<std::size_t>(bank.accountCount());
+    const unsigned shards = (myOptions.shards != 0) ? myOptions.shards : defaultThreadCount();
+    std::vector<ShardResult> results(shards);
+    std::vector<std::size_t>* cursors = myOptions.cursors;
+    if (cursors && (cursors->size() < count))
+    {
+        cursors->resize(count, 0);
+    }
+
+    // Every shard gets a file, even an empty one, so the set is predictable
+    StatementReport report;
+    for (unsigned shard = 0; shard < shards; shard++)
+    {
+        report.files.push_back(shardPath(shard));
+    }
+
+    parallelForRanges(shards, shards, [&](unsigned, std::size_t firstShard, std::size_t lastShard)
+    {
+        for (std::size_t shard = firstShard; shard < lastShard; shard++)
+        {
+            ShardResult& result = results[shard];
+            int fd = ::open(report.files[shard].c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+            if (fd < 0)
+            {
+                result.failed = true;
+                continue;
+            }
+
+            {
+                BufferedDisplay display(fd);
+                std::vector<Transaction> page;
+                const std::size_t begin = count * shard / shards;
+                const std::size_t end = count * (shard + 1) / shards;
+                for (std::size_t n = begin; n < end; n++)
+                {
+                    Account* account = bank.accountAt(static_cast<int>(n));
+                    std::size_t from = cursors ? (*cursors)[n] : 0;
+                    std::size_t covered = 0;
+                    std::size_t trimmed = 0;
+                    result.entries += writeStatement(*account, from, myOptions.period,
+                        myOptions.requestTypes, display, page, covered, trimmed);
+                    result.accounts++;
+                    if (cursors)
+                    {
+                        (*cursors)[n] = std::max(from, covered);
+                        result.trimmedCursors += (from < trimmed) ? 1 : 0;
+                    }
+                }
+                display.commit();
+                result.failed = (display.writeErrors() != 0);
+            }
+
+            if (::close(fd) != 0)
+            {
+                result.failed = true;
+            }
+        }
+    });
+
+    for (const ShardResult& result : results)
+    {
+        report.accounts += result.accounts;
+        report.entries += result.entries;
+        report.failedShards += result.failed ? 1 : 0;
+        report.trimmedCursors += result.trimmedCursors;
+    }
+    return (report);
+}
@@ -2,9 +2,101 @@
 
 #include "Account.hxx"
 #include "Bank.hxx"
+#include "ParallelFor.hxx"
+#include "SyntheticData.hxx"
+
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <vector>
 
 TestObjectFactory* TestObjectFactory::theInstance = NULL;
 
+namespace
+{
+    // Version 2 adds entry times; version 1 files load with times of 0
+    const char BANK_FILE_MAGIC[8] = {'A', 'T', 'M', 'B', 'A', 'N', 'K', '2'};
+    const char BANK_FILE_MAGIC_V1[8] = {'A', 'T', 'M', 'B', 'A', 'N', 'K', '1'};
+
+    template <typename T>
+    void writeValue(std::ostream& out, const T& value)
+    {
+        out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    template <typename T>
+    bool readValue(std::istream& in, T& value)
+    {
+        return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(value)));
+    }
+
+    // Bytes left to read; lengths read from a file are checked against it
+    // before anything is sized from them
+    std::uint64_t remainingBytes(std::istream& in, std::uint64_t fileSize)
+    {
+        const std::streamoff position = in.tellg();
+        if ((position < 0) || (static_cast<std::uint64_t>(position) > fileSize))
+        {
+            return 0;
+        }
+        return fileSize - static_cast<std::uint64_t>(position);
+    }
+
+    std::uint64_t accountSeed(std::uint64_t seed, int accountNumber)
+    {
+        SplitMix64 mix(seed ^ (static_cast<std::uint64_t>(accountNumber) * 0xd1b54a32d192ed03ULL));
+        return mix();
+    }
+
+    // Amounts in whole cents, log-uniform between 1.00 and 5000.00
+    double syntheticAmount(SplitMix64& rng)
+    {
+        double amount = std::exp(rng.uniform() * std::log(5000.0));
+        return std::floor(amount * 100.0) / 100.0;
+    }
+
+    // Entries are spaced by exponentially distributed gaps drawn from
+    // their own generator, so the amounts do not depend on the times
+    void fillSyntheticAccount(Account& account, SplitMix64& rng, SplitMix64& clock,
+        const ZipfDistribution& ledgerLength, const SyntheticBankSpec& spec)
+    {
+        const std::uint64_t length = ledgerLength(rng);
+        std::vector<Transaction> entries;
+        std::vector<LedgerTime> times;
+        entries.reserve(length);
+        times.reserve(length);
+
+        double balance = syntheticAmount(rng) * 10.0;
+        entries.emplace_back(UserRequest::REQUEST_DEPOSIT, balance);
+        LedgerTime time = spec.firstTime;
+        times.push_back(time);
+
+        for (std::uint64_t i = 1; i < length; i++)
+        {
+            double pick = rng.uniform();
+            if (pick < 0.55)
+            {
+                double amount = syntheticAmount(rng);
+                balance += amount;
+                entries.emplace_back(UserRequest::REQUEST_DEPOSIT, amount);
+            }
+            else if (pick < 0.90)
+            {
+                double amount = syntheticAmount(rng);
+                balance -= amount;
+                entries.emplace_back(UserRequest::REQUEST_WITHDRAW, amount);
+            }
+            else
+            {
+                entries.emplace_back(UserRequest::REQUEST_BALANCE, balance);
+            }
+            time += static_cast<LedgerTime>(-std::log(1.0 - clock.uniform()) * spec.meanGap);
+            times.push_back(time);
+        }
+        account.appendPostings(entries.data(), times.data(), entries.size());
+    }
+}
+
 Bank* TestObjectFactory::bankWithTwoAccounts()
 {
     Bank* bank = new Bank;
@@ -15,6 +107,164 @@ Bank* TestObjectFactory::bankWithTwoAccounts()
     return bank;
 }
 
+std::string TestObjectFactory::passwordFor(int accountNumber)
+{
+    return "pw" + std::to_string(accountNumber);
+}
+
+Bank* TestObjectFactory::syntheticBank(const SyntheticBankSpec& spec)
+{
+    Bank* bank = new Bank;
+    bank->reserveAccounts(spec.accounts);
+
+    // Account numbers are handed out in order, so create serially ...
+    std::vector<Account*> accounts(static_cast<std::size_t>(spec.accounts));
+    for (Account*& account : accounts)
+    {
+        account = bank->addAccount();
+    }
+
+    // ... and fill ledgers in parallel, each account from its own seed
+    const ZipfDistribution ledgerLength(static_cast<std::uint64_t>(spec.maxLedgerLength), spec.ledgerSkew);
+    parallelForRanges(accounts.size(), spec.threads,
+        [&](unsigned, std::size_t begin, std::size_t end)
+        {
+            for (std::size_t i = begin; i < end; i++)
+            {
+                Account& account = *accounts[i];
+                int number = account.getAccountNumber();
+                SplitMix64 rng(accountSeed(spec.seed, number));
+                SplitMix64 clock(accountSeed(~spec.seed, number));
+                account.setPassword(passwordFor(number).c_str());
+                fillSyntheticAccount(account, rng, clock, ledgerLength, spec);
+            }
+        });
+
+    return bank;
+}
+
+bool TestObjectFactory::saveBank(Bank& bank, const std::string& path)
+{
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out)
+    {
+        return false;
+    }
+
+    const std::uint64_t count = static_cast<std::uint64_t>(bank.accountCount());
+    out.write(BANK_FILE_MAGIC, sizeof(BANK_FILE_MAGIC));
+    writeValue(out, count);
+
+    for (std::uint64_t n = 0; n < count; n++)
+    {
+        Account* account = bank.accountAt(static_cast<int>(n));
+        const char* password = account->getPassword();
+        const std::uint32_t passwordLength = static_cast<std::uint32_t>(std::strlen(password));
+        writeValue(out, passwordLength);
+        out.write(password, passwordLength);
+        writeValue(out, account->getBalance());
+
+        account->withTransactions([&out](const TransactionView& transactions)
+        {
+            writeValue(out, static_cast<std::uint64_t>(transactions.size()));
+            for (std::size_t i = 0; i < transactions.size(); i++)
+            {
+                writeValue(out, static_cast<std::uint8_t>(std::get<0>(transactions[i])));
+                writeValue(out, std::get<1>(transactions[i]));
+                writeValue(out, transactions.time(i));
+            }
+        });
+    }
+
+    return static_cast<bool>(out.flush());
+}
+
+Bank* TestObjectFactory::loadBank(const std::string& path)
+{
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    const std::streamoff size = in.tellg();
+    if (!in || (size < 0) || !in.seekg(0))
+    {
+        return nullptr;
+    }
+    const std::uint64_t fileSize = static_cast<std::uint64_t>(size);
+
+    char magic[sizeof(BANK_FILE_MAGIC)];
+    std::uint64_t count = 0;
+    if (!in.read(magic, sizeof(magic)) || !readValue(in, count))
+    {
+        return nullptr;
+    }
+    const bool withTimes = (std::memcmp(magic, BANK_FILE_MAGIC, sizeof(magic)) == 0);
+    if (!withTimes && (std::memcmp(magic, BANK_FILE_MAGIC_V1, sizeof(magic)) != 0))
+    {
+        return nullptr;
+    }
+
+    // Smallest an account or a ledger entry can take in the file
+    const std::uint64_t accountBytes = sizeof(std::uint32_t) + sizeof(double) + sizeof(std::uint64_t);
+    const std::uint64_t entryBytes = sizeof(std::uint8_t) + sizeof(double) + (withTimes ? sizeof(LedgerTime) : 0);
+    if (count > remainingBytes(in, fileSize) / accountBytes)
+    {
+        return nullptr;
+    }
+
+    Bank* bank = new Bank;
+    bank->reserveAccounts(static_cast<int>(count));
+    std::string password;
+    for (std::uint64_t n = 0; n < count; n++)
+    {
+        std::uint32_t passwordLength = 0;
+        double balance = 0.0;
+        std::uint64_t ledgerLength = 0;
+        if (!readValue(in, passwordLength) || (passwordLength > remainingBytes(in, fileSize)))
+        {
+            break;
+        }
+        password.resize(passwordLength);
+        if (!in.read(&password[0], passwordLength) || !readValue(in, balance) || !readValue(in, ledgerLength)
+            || (ledgerLength > remainingBytes(in, fileSize) / entryBytes))
+        {
+            break;
+        }
+
+        std::vector<Transaction> transactions;
+        std::vector<LedgerTime> times;
+        transactions.reserve(ledgerLength);
+        times.reserve(withTimes ? ledgerLength : 0);
+        for (std::uint64_t i = 0; i < ledgerLength; i++)
+        {
+            std::uint8_t type = 0;
+            double amount = 0.0;
+            LedgerTime time = 0;
+            if (!readValue(in, type) || !readValue(in, amount) || (withTimes && !readValue(in, time)))
+            {
+                break;
+            }
+            transactions.emplace_back(static_cast<UserRequest>(type), amount);
+            if (withTimes)
+            {
+                times.push_back(time);
+            }
+        }
+        if (transactions.size() != ledgerLength)
+        {
+            break;
+        }
+
+        Account* account = bank->addAccount();
+        account->setPassword(password.c_str());
+        account->restore(balance, std::move(transactions), std::move(times));
+    }
+
+    if (bank->accountCount() != static_cast<int>(count))
+    {
+        delete bank;
+        return nullptr;
+    }
+    return bank;
+}
+
 TestObjectFactory* TestObjectFactory::getInstance()
 {
     if (NULL == theInstance)
@@ -0,0 +1,178 @@
+#include "Trace.hxx"
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+#include <unistd.h>
+
+std::atomic<bool> Trace::theEnabled(false);
+const std::size_t Trace::EVENTS_PER_THREAD;
+
+namespace
+{
+    struct TraceEvent
+    {
+        const char* name;
+        std::uint64_t start;
+        std::uint64_t duration;
+    };
+
+    // One ring per thread. The mutex is only contended while exporting.
+    struct TraceBuffer
+    {
+        explicit TraceBuffer(int id) : tid(id), events(Trace::EVENTS_PER_THREAD) {}
+
+        std::mutex mutex;
+        int tid;
+        std::size_t written = 0;
+        std::vector<TraceEvent> events;
+    };
+
+    // Buffers are owned by the registry and recycled when their thread
+    // exits, so memory stays bounded however many threads come and go
+    struct Registry
+    {
+        std::mutex mutex;
+        std::vector<std::unique_ptr<TraceBuffer>> buffers;
+        std::vector<TraceBuffer*> free;
+    };
+
+    Registry& registry()
+    {
+        static Registry* theRegistry = new Registry;
+        return *theRegistry;
+    }
+
+    class ThreadSlot
+    {
+        public:
+
+            ThreadSlot()
+            {
+                Registry& reg = registry();
+                std::lock_guard<std::mutex> lock(reg.mutex);
+                if (!reg.free.empty())
+                {
+                    myBuffer = reg.free.back();
+                    reg.free.pop_back();
+                }
+                else
+                {
+                    reg.buffers.emplace_back(new TraceBuffer(static_cast<int>(reg.buffers.size()) + 1));
+                    myBuffer = reg.buffers.back().get();
+                }
+            }
+
+            ~ThreadSlot()
+            {
+                Registry& reg = registry();
+                std::lock_guard<std::mutex> lock(reg.mutex);
+                reg.free.push_back(myBuffer);
+            }
+
+            TraceBuffer& buffer() { return *myBuffer; }
+
+        private:
+
+            TraceBuffer* myBuffer;
+    };
+
+    TraceBuffer& threadBuffer()
+    {
+        static thread_local ThreadSlot slot;
+        return slot.buffer();
+    }
+
+    void writeJsonString(std::ostream& out, const char* text)
+    {
+        out << '"';
+        for (const char* p = text; *p; p++)
+        {
+            if ((*p == '"') || (*p == '\\'))
+            {
+                out << '\\';
+            }
+            out << *p;
+        }
+        out << '"';
+    }
+
+    // Chrome trace timestamps are microseconds
+    void writeMicroseconds(std::ostream& out, std::uint64_t nanoseconds)
+    {
+        char text[32];
+        std::snprintf(text, sizeof(text), "%llu.%03u",
+                      static_cast<unsigned long long>(nanoseconds / 1000),
+                      static_cast<unsigned>(nanoseconds % 1000));
+        out << text;
+    }
+}
+
+void Trace::setEnabled(bool enabled) noexcept
+{
+    theEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+std::uint64_t Trace::now() noexcept
+{
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void Trace::record(const char* name, std::uint64_t startNs, std::uint64_t durationNs) noexcept
+{
+    TraceBuffer& buffer = threadBuffer();
+    std::lock_guard<std::mutex> lock(buffer.mutex);
+    TraceEvent& event = buffer.events[buffer.written % EVENTS_PER_THREAD];
+    event.name = name;
+    event.start = startNs;
+    event.duration = durationNs;
+    buffer.written++;
+}
+
+void Trace::writeChromeJson(std::ostream& out)
+{
+    const long pid = static_cast<long>(::getpid());
+    bool first = true;
+
+    out << "{\"traceEvents\":[";
+
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> registryLock(reg.mutex);
+    for (const std::unique_ptr<TraceBuffer>& buffer : reg.buffers)
+    {
+        std::lock_guard<std::mutex> lock(buffer->mutex);
+        std::size_t count = buffer->written < EVENTS_PER_THREAD ? buffer->written : EVENTS_PER_THREAD;
+        std::size_t oldest = buffer->written - count;
+
+        for (std::size_t i = oldest; i < buffer->written; i++)
+        {
+            const TraceEvent& event = buffer->events[i % EVENTS_PER_THREAD];
+            out << (first ? "\n" : ",\n") << "{\"name\":";
+            writeJsonString(out, event.name);
+            out << ",\"cat\":\"atm\",\"ph\":\"X\",\"ts\":";
+            writeMicroseconds(out, event.start);
+            out << ",\"dur\":";
+            writeMicroseconds(out, event.duration);
+            out << ",\"pid\":" << pid << ",\"tid\":" << buffer->tid << '}';
+            first = false;
+        }
+    }
+
+    out << "\n],\"displayTimeUnit\":\"ns\"}\n";
+}
+
+void Trace::clear()
+{
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> registryLock(reg.mutex);
+    for (const std::unique_ptr<TraceBuffer>& buffer : reg.buffers)
+    {
+        std::lock_guard<std::mutex> lock(buffer->mutex);
+        buffer->written = 0;
+    }
+}
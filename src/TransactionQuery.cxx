@@ -0,0 +1,154 @@
+#include "TransactionQuery.hxx"
+
+#include "Account.hxx"
+#include "Bank.hxx"
+#include "ExactSum.hxx"
+#include "ParallelFor.hxx"
+
+#include <algorithm>
+#include <cstdint>
+
+namespace
+{
+    // Entries are filtered a batch at a time into a selection vector of
+    // matching positions; the filter has no data-dependent branches
+    const std::size_t BATCH_SIZE = 1024;
+
+    std::size_t selectMatches(const Transaction* entries, std::size_t count,
+        const TransactionQuery& query, std::uint32_t* selection)
+    {
+        std::size_t selected = 0;
+        for (std::size_t i = 0; i < count; i++)
+        {
+            const unsigned type = static_cast<unsigned>(std::get<0>(entries[i]));
+            const double amount = std::get<1>(entries[i]);
+            const unsigned match = ((query.requestTypes >> type) & 1u)
+                & static_cast<unsigned>(amount >= query.minAmount)
+                & static_cast<unsigned>(amount <= query.maxAmount);
+            selection[selected] = static_cast<std::uint32_t>(i);
+            selected += match;
+        }
+        return (selected);
+    }
+
+    // Largest amount first; ties broken by position so results are stable
+    bool ranksBefore(const QueryMatch& a, const QueryMatch& b)
+    {
+        if (a.amount != b.amount)
+        {
+            return (a.amount > b.amount);
+        }
+        if (a.account != b.account)
+        {
+            return (a.account < b.account);
+        }
+        return (a.entry < b.entry);
+    }
+
+    struct WorkerState
+    {
+        std::size_t accounts = 0;
+        std::size_t entries = 0;
+        std::size_t count = 0;
+        ExactSum sum;
+        std::vector<AccountAggregate> groups;
+        std::vector<QueryMatch> top;    // heap, worst match at the front
+    };
+
+    void offerTop(WorkerState& state, std::size_t k, const QueryMatch& match)
+    {
+        if (state.top.size() < k)
+        {
+            state.top.push_back(match);
+            std::push_heap(state.top.begin(), state.top.end(), ranksBefore);
+        }
+        else if (ranksBefore(match, state.top.front()))
+        {
+            std::pop_heap(state.top.begin(), state.top.end(), ranksBefore);
+            state.top.back() = match;
+            std::push_heap(state.top.begin(), state.top.end(), ranksBefore);
+        }
+    }
+}
+
+QueryResult runQuery(const Bank& bank, const TransactionQuery& query)
+{
+    const std::size_t count = static_cast<std::size_t>(bank.accountCount());
+    const unsigned threads = (query.threads != 0) ? query.threads : defaultThreadCount();
+    std::vector<WorkerState> workers(threads);
+
+    parallelForRanges(count, threads, [&](unsigned worker, std::size_t begin, std::size_t end)
+    {
+        WorkerState& state = workers[worker];
+        std::vector<std::uint32_t> selection(BATCH_SIZE);
+        ExactSum accountSum;
+
+        for (std::size_t n = begin; n < end; n++)
+        {
+            const Account* account = bank.accountAt(static_cast<int>(n));
+            const int number = account->getAccountNumber();
+            account->withTransactions(query.period, [&](std::size_t offset, const TransactionView& ledger)
+            {
+                const std::size_t first = ((query.lastEntries != 0) && (ledger.size() > query.lastEntries))
+                    ? ledger.size() - query.lastEntries : 0;
+                std::size_t matched = 0;
+                if (query.groupByAccount)
+                {
+                    accountSum = ExactSum();
+                }
+
+                for (std::size_t batch = first; batch < ledger.size(); batch += BATCH_SIZE)
+                {
+                    const std::size_t length = std::min(BATCH_SIZE, ledger.size() - batch);
+                    const Transaction* entries = ledger.begin() + batch;
+                    const std::size_t selected = selectMatches(entries, length, query, selection.data());
+
+                    for (std::size_t s = 0; s < selected; s++)
+                    {
+                        const Transaction& entry = entries[selection[s]];
+                        state.sum.add(std::get<1>(entry));
+                        if (query.groupByAccount)
+                        {
+                            accountSum.add(std::get<1>(entry));
+                        }
+                        if (query.topK != 0)
+                        {
+                            offerTop(state, query.topK, QueryMatch{number, offset + batch + selection[s],
+                                std::get<0>(entry), std::get<1>(entry)});
+                        }
+                    }
+                    matched += selected;
+                }
+
+                state.entries += ledger.size() - first;
+                state.count += matched;
+                if (query.groupByAccount && (matched != 0))
+                {
+                    state.groups.push_back(AccountAggregate{number, matched, accountSum.value()});
+                }
+            });
+            state.accounts++;
+        }
+    });
+
+    // Workers own contiguous account ranges, so groups stay in account order
+    QueryResult result;
+    ExactSum sum;
+    for (WorkerState& state : workers)
+    {
+        result.accounts += state.accounts;
+        result.entries += state.entries;
+        result.count += state.count;
+        sum.add(state.sum);
+        result.groups.insert(result.groups.end(), state.groups.begin(), state.groups.end());
+        result.top.insert(result.top.end(), state.top.begin(), state.top.end());
+    }
+    result.sum = sum.value();
+
+    std::sort(result.top.begin(), result.top.end(), ranksBefore);
+    if (result.top.size() > query.topK)
+    {
+        result.top.resize(query.topK);
+    }
+    return (result);
+}
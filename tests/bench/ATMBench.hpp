@@ -0,0 +1,63 @@
+#include "benchmark/benchmark.h"
+#include "ATM.hxx"
+#include "Account.hxx"
+#include "Bank.hxx"
+#include "Format.hxx"
+#include "NullDisplay.hxx"
+
+#include "BenchFixtures.hpp"
+
+// range(0): UserRequest, range(1): ledger length
+static void ATM_fillUserRequest(benchmark::State& state) {
+  const UserRequest request = static_cast<UserRequest>(state.range(0));
+  Bank bank;
+  Account* acct = bank.addAccount();
+  acct->setPassword("pw");
+  fillLedger(*acct, state.range(1));
+
+  NullDisplay display;
+  ATM atm(&bank, &display);
+  atm.viewAccount(0, "pw");
+  LedgerLengthKeeper ledger(*acct, state.range(1));
+  AllocationScope allocations;
+  for (auto _ : state) {
+    atm.fillUserRequest(request, 1.0);
+    ledger.afterIteration(state);
+  }
+  reportAllocations(state, allocations, ledger.excluded());
+  state.SetItemsProcessed(state.iterations());
+  state.SetLabel(requestName(request).text);
+}
+BENCHMARK(ATM_fillUserRequest)
+    ->ArgsProduct({{static_cast<int64_t>(UserRequest::REQUEST_BALANCE),
+                    static_cast<int64_t>(UserRequest::REQUEST_DEPOSIT),
+                    static_cast<int64_t>(UserRequest::REQUEST_WITHDRAW)},
+                   {0, 1 << 10, 1 << 16}})
+    ->Args({static_cast<int64_t>(UserRequest::REQUEST_TRANSACTIONS), 1 << 10})
+    ->Args({static_cast<int64_t>(UserRequest::REQUEST_TRANSACTIONS), 1 << 16});
+
+// Same request mix with the display bound at compile time
+static void ATM_fillUserRequestStatic(benchmark::State& state) {
+  const UserRequest request = static_cast<UserRequest>(state.range(0));
+  Bank bank;
+  Account* acct = bank.addAccount();
+  acct->setPassword("pw");
+  fillLedger(*acct, state.range(1));
+
+  NullDisplay display;
+  BasicATM<StaticDisplayPolicy<NullDisplay>> atm(&bank, &display);
+  atm.viewAccount(0, "pw");
+  LedgerLengthKeeper ledger(*acct, state.range(1));
+  AllocationScope allocations;
+  for (auto _ : state) {
+    atm.fillUserRequest(request, 1.0);
+    ledger.afterIteration(state);
+  }
+  reportAllocations(state, allocations, ledger.excluded());
+  state.SetItemsProcessed(state.iterations());
+  state.SetLabel(requestName(request).text);
+}
+BENCHMARK(ATM_fillUserRequestStatic)
+    ->ArgsProduct({{static_cast<int64_t>(UserRequest::REQUEST_BALANCE),
+                    static_cast<int64_t>(UserRequest::REQUEST_DEPOSIT)},
+                   {0}});
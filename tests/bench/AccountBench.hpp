@@ -0,0 +1,114 @@
+#include "benchmark/benchmark.h"
+#include "Account.hxx"
+#include "AnomalyDetector.hxx"
+#include "NullDisplay.hxx"
+
+#include <vector>
+
+#include "BenchFixtures.hpp"
+#include "PerfCounters.hpp"
+
+static void Account_deposit(benchmark::State& state) {
+  Account acct(100.0);
+  fillLedger(acct, state.range(0));
+  AllocationScope allocations;
+  PerfCounterScope perf;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(acct.deposit(1.0));
+  }
+  perf.report(state);
+  reportAllocations(state, allocations);
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(Account_deposit) ATM_BENCH_LEDGER_ARGS;
+
+static void Account_debit(benchmark::State& state) {
+  Account acct(100.0);
+  fillLedger(acct, state.range(0));
+  AllocationScope allocations;
+  PerfCounterScope perf;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(acct.debit(1.0));
+  }
+  perf.report(state);
+  reportAllocations(state, allocations);
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(Account_debit) ATM_BENCH_LEDGER_ARGS;
+
+// Same as Account_debit with the anomaly detector on the posting path
+static void Account_debitWithDetector(benchmark::State& state) {
+  AnomalyDetector detector(AnomalyDetector::Config(), nullptr);
+  Account acct(100.0);
+  acct.setPostingSink(&detector);
+  fillLedger(acct, state.range(0));
+  AllocationScope allocations;
+  PerfCounterScope perf;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(acct.debit(1.0));
+  }
+  perf.report(state);
+  reportAllocations(state, allocations);
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(Account_debitWithDetector) ATM_BENCH_LEDGER_ARGS;
+
+static void Account_getBalance(benchmark::State& state) {
+  Account acct(100.0);
+  fillLedger(acct, state.range(0));
+  AllocationScope allocations;
+  PerfCounterScope perf;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(acct.getBalance());
+  }
+  perf.report(state);
+  reportAllocations(state, allocations);
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(Account_getBalance) ATM_BENCH_LEDGER_ARGS;
+
+static void Account_listTransactions(benchmark::State& state) {
+  Account acct(100.0);
+  fillLedger(acct, state.range(0));
+  NullDisplay display;
+  const std::size_t entries = acct.transactions().size();
+  AllocationScope allocations;
+  PerfCounterScope perf;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(acct.listTransactions(display, UserRequest::REQUEST_DEPOSIT));
+  }
+  perf.report(state);
+  reportAllocations(state, allocations);
+  state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(entries));
+}
+BENCHMARK(Account_listTransactions)->Arg(1)->Arg(1 << 10)->Arg(1 << 16)->Arg(1 << 20);
+
+// One hour of a ledger with an entry a second: opening balance plus the
+// period's entries, found through the time index
+static void Account_periodStatement(benchmark::State& state) {
+  const std::size_t count = static_cast<std::size_t>(state.range(0));
+  std::vector<Transaction> entries(count, Transaction(UserRequest::REQUEST_DEPOSIT, 1.0));
+  std::vector<LedgerTime> times(count);
+  for (std::size_t i = 0; i < count; i++) {
+    times[i] = static_cast<LedgerTime>(i) * 1000000;
+  }
+  Account acct;
+  acct.appendPostings(entries.data(), times.data(), count);
+  TimeRange hour;
+  std::size_t next = 0;
+  AllocationScope allocations;
+  PerfCounterScope perf;
+  for (auto _ : state) {
+    next = (next + 7919) % count;
+    hour.from = times[next];
+    hour.to = hour.from + 3600 * 1000000LL;
+    acct.withPeriod(hour, [](double opening, std::size_t, const TransactionView& period) {
+      benchmark::DoNotOptimize(opening);
+      benchmark::DoNotOptimize(period.size());
+    });
+  }
+  perf.report(state);
+  reportAllocations(state, allocations);
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(Account_periodStatement)->Arg(1 << 12)->Arg(1 << 16)->Arg(1 << 20);
@@ -0,0 +1,282 @@
+#include "benchmark/benchmark.h"
+#include "Account.hxx"
+#include "Bank.hxx"
+
+#include "BenchFixtures.hpp"
+#include "BulkImport.hxx"
+#include "ColumnarExport.hxx"
+#include "InterestAccrual.hxx"
+#include "PerfCounters.hpp"
+#include "Reconciliation.hxx"
+#include "SyntheticData.hxx"
+#include "TestObjectFactory.hxx"
+#include "TransactionQuery.hxx"
+
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+static void Bank_addAccount(benchmark::State& state) {
+  Bank bank;
+  fillBank(bank, state.range(0));
+  AllocationScope allocations;
+  PerfCounterScope perf;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(bank.addAccount());
+  }
+  perf.report(state);
+  reportAllocations(state, allocations);
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(Bank_addAccount) ATM_BENCH_ACCOUNT_ARGS;
+
+static void Bank_getAccount(benchmark::State& state) {
+  const int accounts = static_cast<int>(state.range(0));
+  Bank bank;
+  fillBank(bank, accounts);
+
+  // Pre-generated lookups so the loop measures only getAccount
+  std::mt19937 gen(1234);
+  std::uniform_int_distribution<int> pick(0, accounts - 1);
+  std::vector<int> numbers(4096);
+  std::vector<std::string> passwords(numbers.size());
+  for (std::size_t i = 0; i < numbers.size(); i++) {
+    numbers[i] = pick(gen);
+    passwords[i] = benchPassword(numbers[i]);
+  }
+
+  std::size_t i = 0;
+  AllocationScope allocations;
+  PerfCounterScope perf;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(bank.getAccount(numbers[i], passwords[i]));
+    i = (i + 1) % numbers.size();
+  }
+  perf.report(state);
+  reportAllocations(state, allocations);
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(Bank_getAccount) ATM_BENCH_ACCOUNT_ARGS;
+
+// Lookups skewed towards a few hot accounts, on a bank at production shape
+static void Bank_getAccountZipf(benchmark::State& state) {
+  SyntheticBankSpec spec;
+  spec.accounts = static_cast<int>(state.range(0));
+  spec.maxLedgerLength = 16;
+  std::unique_ptr<Bank> bank(TestObjectFactory::getInstance()->syntheticBank(spec));
+
+  SplitMix64 rng(1234);
+  ZipfDistribution pick(static_cast<std::uint64_t>(spec.accounts), 1.1);
+  std::vector<int> numbers(4096);
+  std::vector<std::string> passwords(numbers.size());
+  for (std::size_t i = 0; i < numbers.size(); i++) {
+    numbers[i] = static_cast<int>(pick(rng) - 1);
+    passwords[i] = TestObjectFactory::passwordFor(numbers[i]);
+  }
+
+  std::size_t i = 0;
+  AllocationScope allocations;
+  PerfCounterScope perf;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(bank->getAccount(numbers[i], passwords[i]));
+    i = (i + 1) % numbers.size();
+  }
+  perf.report(state);
+  reportAllocations(state, allocations);
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(Bank_getAccountZipf) ATM_BENCH_ACCOUNT_ARGS;
+
+// End-of-day reconciliation over every account, all hardware threads
+static void Bank_reconcile(benchmark::State& state) {
+  SyntheticBankSpec spec;
+  spec.accounts = static_cast<int>(state.range(0));
+  spec.maxLedgerLength = 256;
+  std::unique_ptr<Bank> bank(TestObjectFactory::getInstance()->syntheticBank(spec));
+  std::size_t postings = 0;
+
+  for (auto _ : state) {
+    ReconciliationReport report = reconcileBank(*bank);
+    postings = report.postings;
+    benchmark::DoNotOptimize(report.controlTotal);
+  }
+  state.counters["postings"] = static_cast<double>(postings);
+  state.SetItemsProcessed(state.iterations() * spec.accounts);
+}
+BENCHMARK(Bank_reconcile)->Arg(1 << 10)->Arg(1 << 16)->Arg(1 << 20)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// Nightly interest batch vs. one Account::deposit per account
+static AccrualSchedule benchSchedule() {
+  AccrualSchedule schedule;
+  schedule.tiers = {{0.0, 0.0001, 0.0}, {1000.0, 0.0002, 0.0}, {10000.0, 0.0003, 0.0}};
+  return schedule;
+}
+
+static void Bank_accrueInterest(benchmark::State& state) {
+  SyntheticBankSpec spec;
+  spec.accounts = static_cast<int>(state.range(0));
+  spec.maxLedgerLength = 4;
+  std::unique_ptr<Bank> bank(TestObjectFactory::getInstance()->syntheticBank(spec));
+  AccrualSchedule schedule = benchSchedule();
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(bank->accrueInterest(schedule).totalCredited);
+  }
+  state.SetItemsProcessed(state.iterations() * spec.accounts);
+}
+BENCHMARK(Bank_accrueInterest)->Arg(1 << 16)->Arg(1 << 20)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+static void Bank_accrueInterestPerDeposit(benchmark::State& state) {
+  SyntheticBankSpec spec;
+  spec.accounts = static_cast<int>(state.range(0));
+  spec.maxLedgerLength = 4;
+  std::unique_ptr<Bank> bank(TestObjectFactory::getInstance()->syntheticBank(spec));
+  AccrualSchedule schedule = benchSchedule();
+
+  for (auto _ : state) {
+    for (int n = 0; n < spec.accounts; n++) {
+      Account* account = bank->accountAt(n);
+      double balance = account->getBalance();
+      double accrual = 0.0;
+      computeAccruals(&balance, &accrual, 1, schedule);
+      if (accrual != 0.0) {
+        account->deposit(accrual);
+      }
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * spec.accounts);
+}
+BENCHMARK(Bank_accrueInterestPerDeposit)->Arg(1 << 16)->Arg(1 << 20)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// "Withdrawals over 1000 in the last 100 entries", grouped, top 100
+static void Bank_query(benchmark::State& state) {
+  SyntheticBankSpec spec;
+  spec.accounts = static_cast<int>(state.range(0));
+  spec.maxLedgerLength = 256;
+  std::unique_ptr<Bank> bank(TestObjectFactory::getInstance()->syntheticBank(spec));
+  TransactionQuery query;
+  query.requestTypes = requestBit(UserRequest::REQUEST_WITHDRAW);
+  query.minAmount = 1000.0;
+  query.lastEntries = 100;
+  query.groupByAccount = true;
+  query.topK = 100;
+  std::size_t entries = 0;
+
+  for (auto _ : state) {
+    QueryResult result = runQuery(*bank, query);
+    entries = result.entries;
+    benchmark::DoNotOptimize(result.sum);
+  }
+  state.SetItemsProcessed(state.iterations() * entries);
+}
+BENCHMARK(Bank_query)->Arg(1 << 16)->Arg(1 << 20)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+static void Bank_exportColumnar(benchmark::State& state) {
+  SyntheticBankSpec spec;
+  spec.accounts = static_cast<int>(state.range(0));
+  spec.maxLedgerLength = 256;
+  std::unique_ptr<Bank> bank(TestObjectFactory::getInstance()->syntheticBank(spec));
+  std::string path = "bench_bank.col";
+  std::size_t entries = 0;
+
+  for (auto _ : state) {
+    ColumnarExportReport report = exportColumnar(*bank, path);
+    entries = report.entries;
+    benchmark::DoNotOptimize(report.bytes);
+  }
+  state.SetItemsProcessed(state.iterations() * entries);
+  std::remove(path.c_str());
+}
+BENCHMARK(Bank_exportColumnar)->Arg(1 << 16)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// Same predicate as Bank_query's amount filter, over the exported file
+static void Bank_scanColumnar(benchmark::State& state) {
+  SyntheticBankSpec spec;
+  spec.accounts = static_cast<int>(state.range(0));
+  spec.maxLedgerLength = 256;
+  std::unique_ptr<Bank> bank(TestObjectFactory::getInstance()->syntheticBank(spec));
+  std::string path = "bench_scan.col";
+  exportColumnar(*bank, path);
+  ColumnarReader reader(path);
+  const std::uint8_t withdraw = static_cast<std::uint8_t>(UserRequest::REQUEST_WITHDRAW);
+
+  for (auto _ : state) {
+    double sum = 0.0;
+    for (std::size_t group = 0; group < reader.rowGroups(ColumnarTable::ENTRIES); group++) {
+      ColumnChunk amounts = reader.chunk(group, ColumnarColumn::ENTRY_AMOUNT);
+      ColumnChunk types = reader.chunk(group, ColumnarColumn::ENTRY_TYPE);
+      if (!amounts.mayContain(1000.0, 1e300) || !types.mayContain(withdraw, withdraw)) {
+        continue;
+      }
+      const double* amount = amounts.values<double>();
+      if (amount == nullptr) {
+        state.SkipWithError("amount column is not PLAIN");
+        break;
+      }
+      types.forEachRun<std::uint8_t>([&](std::uint8_t type, std::uint32_t first, std::uint32_t count) {
+        if (type == withdraw) {
+          for (std::uint32_t row = first; row < first + count; row++) {
+            sum += (amount[row] >= 1000.0) ? amount[row] : 0.0;
+          }
+        }
+      });
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * reader.rows(ColumnarTable::ENTRIES));
+  std::remove(path.c_str());
+}
+BENCHMARK(Bank_scanColumnar)->Arg(1 << 16)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// Ledger CSV of state.range(0) rows over 65536 accounts
+static void Bank_importLedgerCsv(benchmark::State& state) {
+  const int accounts = 1 << 16;
+  const std::string accountsPath = "bench_import_accounts.csv";
+  const std::string ledgerPath = "bench_import_ledger.csv";
+  {
+    std::ofstream out(accountsPath, std::ios::binary | std::ios::trunc);
+    for (int n = 0; n < accounts; n++) {
+      out << n << ",pw" << n << "\n";
+    }
+    SplitMix64 random(7);
+    std::ofstream ledger(ledgerPath, std::ios::binary | std::ios::trunc);
+    for (int64_t i = 0; i < state.range(0); i++) {
+      ledger << (random() % accounts) << ((i % 4) ? ",D," : ",W,")
+             << (random() % 100000) << "." << (random() % 100) << "\n";
+    }
+  }
+  std::size_t bytes = 0;
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    std::unique_ptr<Bank> bank(new Bank());
+    importAccountsCsv(*bank, accountsPath);
+    state.ResumeTiming();
+    BulkImportReport report = importLedgerCsv(*bank, ledgerPath);
+    bytes = report.bytes;
+    benchmark::DoNotOptimize(report.imported);
+  }
+  state.SetBytesProcessed(state.iterations() * bytes);
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  std::remove(accountsPath.c_str());
+  std::remove(ledgerPath.c_str());
+}
+BENCHMARK(Bank_importLedgerCsv)->Arg(1 << 20)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// Reading the totals costs the same however big the bank is
+static void Bank_memoryStats(benchmark::State& state) {
+  Bank bank;
+  fillBank(bank, state.range(0));
+  AllocationScope allocations;
+  PerfCounterScope perf;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(bank.memoryStats().total());
+  }
+  perf.report(state);
+  reportAllocations(state, allocations);
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(Bank_memoryStats) ATM_BENCH_ACCOUNT_ARGS;
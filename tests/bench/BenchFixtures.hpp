@@ -0,0 +1,100 @@
+#ifndef BENCH_FIXTURES_HPP
+#define BENCH_FIXTURES_HPP
+
+#include "benchmark/benchmark.h"
+#include "Account.hxx"
+#include "Bank.hxx"
+
+#include "AllocationCounter.hpp"
+
+#include <cstddef>
+#include <string>
+
+// Ledger lengths and account counts shared by the benchmark families
+#define ATM_BENCH_LEDGER_ARGS ->Arg(0)->Arg(1 << 10)->Arg(1 << 16)->Arg(1 << 20)
+#define ATM_BENCH_ACCOUNT_ARGS ->Arg(1 << 4)->Arg(1 << 10)->Arg(1 << 16)->Arg(1 << 20)
+
+inline void fillLedger(Account& account, long entries)
+{
+    for (long i = 0; i < entries; i++)
+    {
+        account.deposit((i & 1) ? 1.0 : -1.0);
+    }
+}
+
+inline std::string benchPassword(int accountNumber)
+{
+    return ("pw" + std::to_string(accountNumber));
+}
+
+inline void fillBank(Bank& bank, long accounts)
+{
+    for (long i = 0; i < accounts; i++)
+    {
+        Account* account = bank.addAccount();
+        account->setPassword(benchPassword(account->getAccountNumber()).c_str());
+    }
+}
+
+// Posting benchmarks append a ledger entry per iteration. Trimming the
+// ledger back to its starting length every TRIM_INTERVAL iterations, with
+// the timer paused, keeps it the length the benchmark is named for; what a
+// trim allocates is kept out of the per-iteration counts. Pausing per
+// iteration would cost more than the call being measured.
+class LedgerLengthKeeper
+{
+    public:
+
+        static const std::size_t TRIM_INTERVAL = 1024;
+
+        LedgerLengthKeeper(Account& account, long entries) :
+            myAccount(account),
+            myEntries(static_cast<std::size_t>(entries))
+        {
+        }
+
+        void afterIteration(benchmark::State& state)
+        {
+            if (++myPosted < TRIM_INTERVAL)
+            {
+                return;
+            }
+            state.PauseTiming();
+            AllocationScope trim;
+            myAccount.trimLedger(myEntries);
+            const AllocationCounts delta = trim.delta();
+            myExcluded.allocations += delta.allocations;
+            myExcluded.deallocations += delta.deallocations;
+            myExcluded.bytes += delta.bytes;
+            myPosted = 0;
+            state.ResumeTiming();
+        }
+
+        const AllocationCounts& excluded() const
+        {
+            return (myExcluded);
+        }
+
+    private:
+
+        Account& myAccount;
+        const std::size_t myEntries;
+        std::size_t myPosted = 0;
+        AllocationCounts myExcluded = {0, 0, 0};
+};
+
+// Reports heap allocations and bytes per iteration of the benchmark loop,
+// less `excluded` (setup done inside the loop)
+inline void reportAllocations(benchmark::State& state, const AllocationScope& scope,
+                              const AllocationCounts& excluded = AllocationCounts{0, 0, 0})
+{
+    AllocationCounts delta = scope.delta();
+    delta.allocations -= excluded.allocations;
+    delta.bytes -= excluded.bytes;
+    state.counters["allocs/op"] = benchmark::Counter(
+        static_cast<double>(delta.allocations), benchmark::Counter::kAvgIterations);
+    state.counters["bytes/op"] = benchmark::Counter(
+        static_cast<double>(delta.bytes), benchmark::Counter::kAvgIterations);
+}
+
+#endif // BENCH_FIXTURES_HPP
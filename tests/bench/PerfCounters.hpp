@@ -0,0 +1,211 @@
+#ifndef PERF_COUNTERS_HPP
+#define PERF_COUNTERS_HPP
+
+#include "benchmark/benchmark.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Hardware performance counters for the benchmark harness, read through
+// Linux perf_event_open. Enabled by setting ATM_BENCH_PERF_COUNTERS=1.
+//
+// Every event is opened on its own, so a host that exposes only some of
+// them (common in containers and VMs) still reports those. When none can
+// be opened the benchmarks run unchanged and a note is printed once.
+class PerfCounters
+{
+    public:
+
+        enum Event {CYCLES, INSTRUCTIONS, L1D_MISSES, LLC_MISSES, BRANCH_MISSES, EVENT_COUNT};
+
+        // Shared by all benchmarks; opened on first use
+        static PerfCounters& instance()
+        {
+            static PerfCounters theInstance;
+            return theInstance;
+        }
+
+        bool available() const { return (myOpenCount > 0); }
+        bool available(Event event) const { return (myFds[event] >= 0); }
+
+        void start()
+        {
+#ifdef __linux__
+            for (int i = 0; i < EVENT_COUNT; i++)
+            {
+                if (myFds[i] >= 0)
+                {
+                    ioctl(myFds[i], PERF_EVENT_IOC_RESET, 0);
+                    ioctl(myFds[i], PERF_EVENT_IOC_ENABLE, 0);
+                }
+            }
+#endif
+        }
+
+        void stop()
+        {
+#ifdef __linux__
+            for (int i = 0; i < EVENT_COUNT; i++)
+            {
+                if (myFds[i] >= 0)
+                {
+                    ioctl(myFds[i], PERF_EVENT_IOC_DISABLE, 0);
+                }
+            }
+#endif
+        }
+
+        // Count since start(), scaled up if the kernel multiplexed the event
+        double value(Event event) const
+        {
+#ifdef __linux__
+            std::uint64_t data[3] = {0, 0, 0};
+            if ((myFds[event] < 0) || (read(myFds[event], data, sizeof(data)) != sizeof(data)))
+            {
+                return (0.0);
+            }
+            if ((data[2] == 0) || (data[1] == data[2]))
+            {
+                return (static_cast<double>(data[0]));
+            }
+            return (static_cast<double>(data[0]) * static_cast<double>(data[1]) / static_cast<double>(data[2]));
+#else
+            (void)event;
+            return (0.0);
+#endif
+        }
+
+        static const char* name(Event event)
+        {
+            static const char* const NAMES[EVENT_COUNT] = {
+                "cycles/op", "instructions/op", "L1d-misses/op", "LLC-misses/op", "branch-misses/op",
+            };
+            return (NAMES[event]);
+        }
+
+    private:
+
+        PerfCounters()
+        {
+            for (int i = 0; i < EVENT_COUNT; i++)
+            {
+                myFds[i] = -1;
+            }
+
+            const char* enabled = std::getenv("ATM_BENCH_PERF_COUNTERS");
+            if (!enabled || (std::strcmp(enabled, "0") == 0))
+            {
+                return;
+            }
+
+#ifdef __linux__
+            const std::uint64_t l1dMiss = PERF_COUNT_HW_CACHE_L1D
+                | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+            open(CYCLES, PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+            open(INSTRUCTIONS, PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+            open(L1D_MISSES, PERF_TYPE_HW_CACHE, l1dMiss);
+            open(LLC_MISSES, PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+            open(BRANCH_MISSES, PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+#endif
+            if (myOpenCount == 0)
+            {
+                std::fprintf(stderr, "atm_bench: hardware counters unavailable, reporting time only\n");
+            }
+        }
+
+        ~PerfCounters()
+        {
+#ifdef __linux__
+            for (int i = 0; i < EVENT_COUNT; i++)
+            {
+                if (myFds[i] >= 0)
+                {
+                    close(myFds[i]);
+                }
+            }
+#endif
+        }
+
+        PerfCounters(const PerfCounters&) = delete;
+        PerfCounters& operator=(const PerfCounters&) = delete;
+
+#ifdef __linux__
+        void open(Event event, std::uint32_t type, std::uint64_t config)
+        {
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = type;
+            attr.config = config;
+            attr.disabled = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+            int fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+            if (fd >= 0)
+            {
+                myFds[event] = fd;
+                myOpenCount++;
+            }
+        }
+#endif
+
+        int myFds[EVENT_COUNT];
+        int myOpenCount = 0;
+};
+
+// Counts hardware events between construction and report()
+class PerfCounterScope
+{
+    public:
+
+        PerfCounterScope() : myCounters(PerfCounters::instance())
+        {
+            myCounters.start();
+        }
+
+        void report(benchmark::State& state)
+        {
+            myCounters.stop();
+            if (!myCounters.available())
+            {
+                return;
+            }
+
+            for (int i = 0; i < PerfCounters::EVENT_COUNT; i++)
+            {
+                PerfCounters::Event event = static_cast<PerfCounters::Event>(i);
+                if (myCounters.available(event))
+                {
+                    state.counters[PerfCounters::name(event)] = benchmark::Counter(
+                        myCounters.value(event), benchmark::Counter::kAvgIterations);
+                }
+            }
+
+            if (myCounters.available(PerfCounters::CYCLES) && myCounters.available(PerfCounters::INSTRUCTIONS))
+            {
+                double cycles = myCounters.value(PerfCounters::CYCLES);
+                if (cycles > 0.0)
+                {
+                    state.counters["IPC"] = myCounters.value(PerfCounters::INSTRUCTIONS) / cycles;
+                }
+            }
+        }
+
+    private:
+
+        PerfCounters& myCounters;
+};
+
+#endif // PERF_COUNTERS_HPP
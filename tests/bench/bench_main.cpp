@@ -0,0 +1,11 @@
+#include "benchmark/benchmark.h"
+
+#define ATM_DEFINE_ALLOCATION_HOOKS
+#include "AllocationCounter.hpp"
+
+#include "ATMBench.hpp"
+#include "AccountBench.hpp"
+#include "BankBench.hpp"
+
+
+BENCHMARK_MAIN();
@@ -0,0 +1,83 @@
+#!/usr/bin/env python3
+"""Compare two Google Benchmark JSON reports and flag regressions.
+
+Usage:
+    atm_bench --benchmark_out=current.json --benchmark_out_format=json
+    compare_bench.py baseline.json current.json [--threshold 0.10] [--metric cpu_time]
+
+A benchmark regresses when its median time across repetitions grows by
+more than the threshold relative to the baseline. The exit status is 1 if any benchmark regressed,
+so the script can gate CI. To store a new baseline, keep the JSON report of
+a trusted run (e.g. copy current.json to tests/bench/baseline.json).
+"""
+
+import argparse
+import json
+import statistics
+import sys
+
+UNIT_TO_NS = {"ns": 1.0, "us": 1e3, "ms": 1e6, "s": 1e9}
+
+
+def load(path, metric):
+    """Median time of each benchmark across its repetitions, in ns.
+
+    The median is taken over the per-run rows, so a report with
+    --benchmark_repetitions compares the same way with or without its
+    aggregate rows. Only a report that holds aggregates alone
+    (--benchmark_report_aggregates_only) falls back to its median rows.
+    """
+    with open(path) as f:
+        report = json.load(f)
+    runs = {}
+    medians = {}
+    for bench in report.get("benchmarks", []):
+        name = bench.get("run_name", bench["name"])
+        time = bench[metric] * UNIT_TO_NS.get(bench.get("time_unit", "ns"), 1.0)
+        if bench.get("run_type") != "aggregate":
+            runs.setdefault(name, []).append(time)
+        elif bench.get("aggregate_name") == "median":
+            medians[name] = time
+    results = dict(medians)
+    for name, times in runs.items():
+        results[name] = statistics.median(times)
+    return results
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("baseline")
+    parser.add_argument("current")
+    parser.add_argument("--threshold", type=float, default=0.10,
+                        help="allowed relative slowdown (default 0.10 = 10%%)")
+    parser.add_argument("--metric", default="cpu_time", choices=["cpu_time", "real_time"])
+    args = parser.parse_args()
+
+    baseline = load(args.baseline, args.metric)
+    current = load(args.current, args.metric)
+
+    regressions = 0
+    print("%-60s %12s %12s %8s" % ("benchmark", "baseline ns", "current ns", "change"))
+    for name in sorted(current):
+        if name not in baseline:
+            print("%-60s %12s %12.1f %8s" % (name, "-", current[name], "new"))
+            continue
+        old, new = baseline[name], current[name]
+        change = (new - old) / old if old else 0.0
+        flag = ""
+        if change > args.threshold:
+            flag = "  REGRESSION"
+            regressions += 1
+        print("%-60s %12.1f %12.1f %+7.1f%%%s" % (name, old, new, change * 100.0, flag))
+
+    for name in sorted(set(baseline) - set(current)):
+        print("%-60s %12.1f %12s %8s" % (name, baseline[name], "-", "missing"))
+
+    if regressions:
+        print("\n%d benchmark(s) regressed by more than %.0f%%" % (regressions, args.threshold * 100.0))
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
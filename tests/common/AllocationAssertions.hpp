@@ -0,0 +1,21 @@
+#ifndef ALLOCATION_ASSERTIONS_HPP
+#define ALLOCATION_ASSERTIONS_HPP
+
+#include "gtest/gtest.h"
+#include "AllocationCounter.hpp"
+
+// Fails the test if `statement` performs any heap allocation on this thread
+#define ATM_ALLOCATION_CHECK_(statement, fail)                                  \
+  do {                                                                          \
+    AllocationScope atmAllocationScope_;                                        \
+    statement;                                                                  \
+    AllocationCounts atmAllocationDelta_ = atmAllocationScope_.delta();         \
+    fail(atmAllocationDelta_.allocations, 0u)                                   \
+        << #statement << " allocated " << atmAllocationDelta_.bytes             \
+        << " bytes in " << atmAllocationDelta_.allocations << " allocation(s)"; \
+  } while (0)
+
+#define EXPECT_NO_ALLOCATIONS(statement) ATM_ALLOCATION_CHECK_(statement, EXPECT_EQ)
+#define ASSERT_NO_ALLOCATIONS(statement) ATM_ALLOCATION_CHECK_(statement, ASSERT_EQ)
+
+#endif // ALLOCATION_ASSERTIONS_HPP
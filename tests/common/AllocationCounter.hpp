@@ -0,0 +1,104 @@
+#ifndef ALLOCATION_COUNTER_HPP
+#define ALLOCATION_COUNTER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+// Per-thread heap allocation accounting for test and benchmark builds.
+//
+// The counters are fed by replacement global operator new/delete, which
+// exactly one translation unit of the executable emits by defining
+// ATM_DEFINE_ALLOCATION_HOOKS before including this header.
+
+struct AllocationCounts
+{
+    std::uint64_t allocations;
+    std::uint64_t deallocations;
+    std::uint64_t bytes;
+};
+
+inline AllocationCounts& threadAllocationCounts() noexcept
+{
+    static thread_local AllocationCounts counts = {0, 0, 0};
+    return counts;
+}
+
+// Counts what the current thread allocates between construction and delta()
+class AllocationScope
+{
+    public:
+
+        AllocationScope() noexcept : myStart(threadAllocationCounts()) {}
+
+        AllocationCounts delta() const noexcept
+        {
+            const AllocationCounts& now = threadAllocationCounts();
+            AllocationCounts result = {
+                now.allocations - myStart.allocations,
+                now.deallocations - myStart.deallocations,
+                now.bytes - myStart.bytes,
+            };
+            return result;
+        }
+
+    private:
+
+        AllocationCounts myStart;
+};
+
+#ifdef ATM_DEFINE_ALLOCATION_HOOKS
+
+static void* atmCountedAllocate(std::size_t size)
+{
+    AllocationCounts& counts = threadAllocationCounts();
+    counts.allocations++;
+    counts.bytes += size;
+    return std::malloc(size == 0 ? 1 : size);
+}
+
+static void atmCountedFree(void* pointer) noexcept
+{
+    if (pointer)
+    {
+        threadAllocationCounts().deallocations++;
+        std::free(pointer);
+    }
+}
+
+void* operator new(std::size_t size)
+{
+    void* pointer = atmCountedAllocate(size);
+    if (!pointer)
+    {
+        throw std::bad_alloc();
+    }
+    return pointer;
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    return atmCountedAllocate(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+    return atmCountedAllocate(size);
+}
+
+void operator delete(void* pointer) noexcept { atmCountedFree(pointer); }
+void operator delete[](void* pointer) noexcept { atmCountedFree(pointer); }
+void operator delete(void* pointer, std::size_t) noexcept { atmCountedFree(pointer); }
+void operator delete[](void* pointer, std::size_t) noexcept { atmCountedFree(pointer); }
+void operator delete(void* pointer, const std::nothrow_t&) noexcept { atmCountedFree(pointer); }
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept { atmCountedFree(pointer); }
+
+#endif // ATM_DEFINE_ALLOCATION_HOOKS
+
+#endif // ALLOCATION_COUNTER_HPP
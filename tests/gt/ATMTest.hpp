@@ -0,0 +1,57 @@
+#include "gtest/gtest.h"
+#include "ATM.hxx"
+#include "Account.hxx"
+#include "Bank.hxx"
+#include "BaseDisplay.hxx"
+
+#include <string>
+
+class RecordingDisplay : public BaseDisplay
+{
+    public:
+        void showInfoToUser(const char* message) override { lastInfo = message; }
+        void showBalance(double balance) override { lastBalance = balance; balanceCount++; }
+        void showTransaction(UserRequest, double) override { transactionCount++; }
+
+        std::string lastInfo;
+        double lastBalance = 0.0;
+        int balanceCount = 0;
+        int transactionCount = 0;
+};
+
+TEST(ATM, depositPolymorphic) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  Bank theBank;
+  theBank.addAccount()->setPassword("pwd");
+  RecordingDisplay display;
+  ATM atm(&theBank, &display);
+  atm.viewAccount(0, "pwd");
+  atm.fillUserRequest(UserRequest::REQUEST_DEPOSIT, 25.0);
+  ASSERT_EQ(display.lastInfo, "Updated Balance");
+  ASSERT_EQ(display.lastBalance, 25.0);
+}
+
+TEST(ATM, invalidAccountStatic) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  Bank theBank;
+  RecordingDisplay display;
+  BasicATM<StaticDisplayPolicy<RecordingDisplay>> atm(&theBank, &display);
+  atm.viewAccount(3, "pwd");
+  atm.fillUserRequest(UserRequest::REQUEST_BALANCE, 0.0);
+  ASSERT_EQ(display.lastInfo, "Invalid account");
+  ASSERT_EQ(display.balanceCount, 0);
+}
+
+TEST(ATM, transactionsStatic) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  Bank theBank;
+  theBank.addAccount()->setPassword("pwd");
+  RecordingDisplay display;
+  BasicATM<StaticDisplayPolicy<RecordingDisplay>> atm(&theBank, &display);
+  atm.viewAccount(0, "pwd");
+  atm.fillUserRequest(UserRequest::REQUEST_DEPOSIT, 10.0);
+  atm.fillUserRequest(UserRequest::REQUEST_WITHDRAW, 4.0);
+  atm.fillUserRequest(UserRequest::REQUEST_TRANSACTIONS, 0.0);
+  ASSERT_EQ(display.lastBalance, 6.0);
+  ASSERT_GT(display.transactionCount, 0);
+}
@@ -1,7 +1,11 @@
 #include "gtest/gtest.h"
 #include "Account.hxx"
+#include "BaseDisplay.hxx"
 
+#include <algorithm>
+#include <cstdint>
 #include <string>
+#include <vector>
 
 TEST(Account, getBalanceDefault) {
   ::testing::Test::RecordProperty("req", "AGT-6");
@@ -76,3 +80,162 @@ TEST(Account, debitSimple) {
   ASSERT_EQ(acct.getBalance(), initial - 1.0);
  }
 */
+
+class BatchDisplay : public BaseDisplay
+{
+    public:
+        void showBalance(double) override {}
+        void showTransactions(const TransactionView& transactions) override {
+          batches++;
+          entries += transactions.size();
+        }
+
+        int batches = 0;
+        std::size_t entries = 0;
+};
+
+TEST(Account, listTransactionsBatch) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  Account acct(10.0);
+  acct.deposit(5.0);
+  acct.debit(3.0);
+  acct.deposit(1.0);
+  BatchDisplay display;
+  int deposits = acct.listTransactions(display, UserRequest::REQUEST_DEPOSIT);
+  ASSERT_EQ(display.batches, 1);
+  ASSERT_EQ(display.entries, acct.transactions().size());
+  ASSERT_EQ(deposits, 3);
+}
+
+TEST(Account, transactionViewPages) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  Account acct(1.0);
+  for (int i = 0; i < 9; i++) {
+    acct.debit(1.0);
+  }
+  TransactionView view = acct.transactions();
+  std::size_t total = 0;
+  for (std::size_t i = 0; i < view.pageCount(4); i++) {
+    total += view.page(i, 4).size();
+  }
+  ASSERT_EQ(total, view.size());
+  ASSERT_TRUE(view.page(view.pageCount(4), 4).empty());
+}
+
+TEST(Account, transactionViewPagesOfNothing) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  Account acct(1.0);
+  acct.debit(1.0);
+  TransactionView view = acct.transactions();
+  ASSERT_EQ(0u, view.pageCount(0));
+  ASSERT_TRUE(view.page(0, 0).empty());
+  ASSERT_EQ(1u, view.pageCount(SIZE_MAX));
+  ASSERT_EQ(view.size(), view.page(0, SIZE_MAX).size());
+  ASSERT_TRUE(view.page(SIZE_MAX / 2 + 1, 2).empty());
+}
+
+static LedgerTime theTestTime = 0;
+
+static LedgerTime testClock()
+{
+  return theTestTime;
+}
+
+TEST(Account, ledgerTimesFromClock) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  Account::setClock(&testClock);
+  theTestTime = 1000;
+  Account acct(5.0);
+  theTestTime = 2000;
+  acct.deposit(1.0);
+  theTestTime = 1500;   // clock stepped back: the entry keeps ledger order
+  acct.debit(2.0);
+  theTestTime = 3000;
+  acct.recordBalanceInquiry();
+  Account::setClock(nullptr);
+
+  TransactionView view = acct.transactions();
+  ASSERT_TRUE(view.hasTimes());
+  ASSERT_EQ(1000, view.time(0));
+  ASSERT_EQ(2000, view.time(1));
+  ASSERT_EQ(2000, view.time(2));
+  ASSERT_EQ(3000, view.time(3));
+  ASSERT_GT(Account::now(), 1000000000000000);
+
+  // Restored entries without times are at time 0
+  acct.restore(4.0, {Transaction(UserRequest::REQUEST_DEPOSIT, 4.0)});
+  ASSERT_EQ(0, acct.transactions().time(0));
+}
+
+TEST(Account, timeRangeLookups) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  // Several index blocks, with runs of equal times across block boundaries
+  const std::size_t count = 5 * Account::TIME_BLOCK + 7;
+  std::vector<Transaction> entries;
+  std::vector<LedgerTime> times;
+  for (std::size_t i = 0; i < count; i++) {
+    entries.emplace_back((i % 3 == 0) ? UserRequest::REQUEST_WITHDRAW : UserRequest::REQUEST_DEPOSIT,
+                         static_cast<double>(i % 17));
+    times.push_back(static_cast<LedgerTime>(i / 4) * 10);
+  }
+  Account acct;
+  acct.appendPostings(entries.data(), times.data(), count);
+
+  for (LedgerTime from : {-5, 0, 1, 10, 635, 640, 1300, 5000}) {
+    for (LedgerTime to : {0, 11, 640, 650, 5000}) {
+      const std::size_t first = std::lower_bound(times.begin(), times.end(), from) - times.begin();
+      const std::size_t last = std::max(first,
+          static_cast<std::size_t>(std::lower_bound(times.begin(), times.end(), to) - times.begin()));
+      double opening = 0.0;
+      for (std::size_t i = 0; i < first; i++) {
+        opening += (std::get<0>(entries[i]) == UserRequest::REQUEST_DEPOSIT) ? std::get<1>(entries[i])
+                                                                            : -std::get<1>(entries[i]);
+      }
+
+      TimeRange period;
+      period.from = from;
+      period.to = to;
+      acct.withPeriod(period, [&](double balance, std::size_t at, const TransactionView& slice) {
+        ASSERT_EQ(first, at) << from << ".." << to;
+        ASSERT_EQ(last - first, slice.size()) << from << ".." << to;
+        ASSERT_EQ(opening, balance) << from << ".." << to;
+        for (std::size_t i = 0; i < slice.size(); i++) {
+          ASSERT_TRUE(period.contains(slice.time(i)));
+        }
+      });
+
+      std::size_t visited = 0;
+      acct.forEachTransaction(period, [&visited](const Transaction&) { visited++; });
+      ASSERT_EQ(last - first, visited);
+    }
+  }
+
+  // Entries before a ledger position are left out
+  acct.withPeriod(count - 3, TimeRange(), [&](double, std::size_t at, const TransactionView& slice) {
+    ASSERT_EQ(count - 3, at);
+    ASSERT_EQ(3u, slice.size());
+  });
+
+  BatchDisplay display;
+  TimeRange firstDay;
+  firstDay.to = 20;
+  int deposits = acct.listTransactions(display, UserRequest::REQUEST_DEPOSIT, firstDay);
+  ASSERT_EQ(8u, display.entries);
+  ASSERT_EQ(5, deposits);
+}
+
+TEST(Account, postAdjustmentReadsTheBalanceItPostsAgainst) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  Account acct;
+  acct.deposit(100.0);
+  ASSERT_EQ(-25.0, acct.postAdjustment(7, [](double balance) { return -balance / 4; }));
+  ASSERT_EQ(75.0, acct.getBalance());
+  ASSERT_EQ(2.5, acct.postAdjustment(8, [](double balance) { return balance / 30; }));
+  ASSERT_EQ(0.0, acct.postAdjustment(9, [](double) { return 0.0; }));
+
+  TransactionView ledger = acct.transactions();
+  ASSERT_EQ(3u, ledger.size());
+  ASSERT_EQ(Transaction(UserRequest::REQUEST_WITHDRAW, 25.0), ledger[1]);
+  ASSERT_EQ(Transaction(UserRequest::REQUEST_DEPOSIT, 2.5), ledger[2]);
+  ASSERT_EQ(77.5, acct.getBalance());
+}
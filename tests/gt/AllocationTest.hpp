@@ -0,0 +1,50 @@
+#include "gtest/gtest.h"
+#include "ATM.hxx"
+#include "Account.hxx"
+#include "Bank.hxx"
+#include "NullDisplay.hxx"
+
+#include "AllocationAssertions.hpp"
+
+#include <memory>
+#include <string>
+
+TEST(Allocation, counterSeesAllocations) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  AllocationScope scope;
+  std::unique_ptr<int> value(new int(7));
+  ASSERT_EQ(scope.delta().allocations, 1u);
+  ASSERT_GE(scope.delta().bytes, sizeof(int));
+}
+
+TEST(Allocation, accountSteadyState) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  Account acct(100.0);
+  acct.reserveTransactions(2);
+  EXPECT_NO_ALLOCATIONS(acct.getBalance());
+  EXPECT_NO_ALLOCATIONS(acct.deposit(5.0));
+  EXPECT_NO_ALLOCATIONS(acct.debit(5.0));
+}
+
+TEST(Allocation, bankGetAccount) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  Bank theBank;
+  theBank.addAccount()->setPassword("a rather long password beyond SSO");
+  const std::string password("a rather long password beyond SSO");
+  EXPECT_NO_ALLOCATIONS(theBank.getAccount(0, password));
+}
+
+TEST(Allocation, atmSteadyState) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  Bank theBank;
+  Account* acct = theBank.addAccount();
+  acct->setPassword("a rather long password beyond SSO");
+  acct->reserveTransactions(4);
+  const std::string password("a rather long password beyond SSO");
+  NullDisplay display;
+  ATM atm(&theBank, &display);
+  EXPECT_NO_ALLOCATIONS(atm.viewAccount(0, password));
+  EXPECT_NO_ALLOCATIONS(atm.fillUserRequest(UserRequest::REQUEST_DEPOSIT, 10.0));
+  EXPECT_NO_ALLOCATIONS(atm.fillUserRequest(UserRequest::REQUEST_BALANCE, 0.0));
+  EXPECT_NO_ALLOCATIONS(atm.fillUserRequest(UserRequest::REQUEST_TRANSACTIONS, 0.0));
+}
@@ -0,0 +1,117 @@
+#include "gtest/gtest.h"
+#include "Account.hxx"
+#include "AnomalyDetector.hxx"
+#include "Bank.hxx"
+
+#include <vector>
+
+
+static std::uint64_t theFakeDetectorTime = 0;
+
+static LedgerTime fakeDetectorLedgerClock() {
+  return static_cast<LedgerTime>(theFakeDetectorTime / 1000);
+}
+
+static std::uint64_t frozenDetectorClock() {
+  return 0;
+}
+
+// Postings are timed by the ledger, and activity() by the ledger's clock
+// unless the config injects one
+struct FakeDetectorTime {
+  FakeDetectorTime() {
+    theFakeDetectorTime = 1000000000ULL;
+    Account::setClock(&fakeDetectorLedgerClock);
+  }
+  ~FakeDetectorTime() {
+    Account::setClock(nullptr);
+  }
+};
+
+static const std::uint64_t SECOND_NS = 1000000000ULL;
+
+TEST(AnomalyDetector, rapidWithdrawals) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  FakeDetectorTime time;
+  std::vector<Anomaly> seen;
+  // Only ledger times count: a clock that never moves does not matter
+  AnomalyDetector::Config config;
+  config.clock = frozenDetectorClock;
+  AnomalyDetector detector(config, [&seen](const Anomaly& a) { seen.push_back(a); });
+  Bank bank;
+  bank.setPostingSink(&detector);
+  Account* account = bank.addAccount();
+  account->deposit(1000.0);
+
+  account->debit(20.0);
+  theFakeDetectorTime += 70 * SECOND_NS;
+  account->debit(20.0);
+  theFakeDetectorTime += 10 * SECOND_NS;
+  account->deposit(-20.0);    // ATM withdrawal
+  ASSERT_TRUE(seen.empty());
+
+  theFakeDetectorTime += 10 * SECOND_NS;
+  account->debit(20.0);
+  ASSERT_EQ(1u, seen.size());
+  ASSERT_EQ(AnomalyKind::RAPID_WITHDRAWALS, seen[0].kind);
+  ASSERT_EQ(0, seen[0].posting.account);
+  ASSERT_EQ(UserRequest::REQUEST_WITHDRAW, seen[0].posting.type);
+  ASSERT_EQ(920.0, seen[0].posting.balance);
+  ASSERT_EQ(1u, detector.anomalies());
+}
+
+TEST(AnomalyDetector, unusualAmountAndVelocity) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  FakeDetectorTime time;
+  std::vector<Anomaly> seen;
+  AnomalyDetector::Config config;
+  config.maxPostingsPerWindow = 8.0;
+  AnomalyDetector detector(config, [&seen](const Anomaly& a) { seen.push_back(a); });
+  Account account;
+  account.setPostingSink(&detector);
+
+  for (int i = 0; i < 6; i++) {
+    account.deposit(10.0);
+    theFakeDetectorTime += 5 * SECOND_NS;
+  }
+  ASSERT_TRUE(seen.empty());
+  account.deposit(500.0);
+  ASSERT_EQ(1u, seen.size());
+  ASSERT_EQ(AnomalyKind::UNUSUAL_AMOUNT, seen[0].kind);
+  ASSERT_DOUBLE_EQ(50.0, seen[0].observed);
+
+  account.deposit(1.0);
+  account.deposit(1.0);
+  ASSERT_EQ(2u, seen.size());
+  ASSERT_EQ(AnomalyKind::HIGH_VELOCITY, seen[1].kind);
+
+  AccountActivity activity = detector.activity(0);
+  ASSERT_EQ(9u, activity.postings);
+  ASSERT_DOUBLE_EQ(9.0, activity.windowPostings);
+  ASSERT_EQ(0.0, activity.windowOutflow);
+
+  // Two quiet windows later the sliding estimate has drained
+  theFakeDetectorTime += 150 * SECOND_NS;
+  activity = detector.activity(0);
+  ASSERT_EQ(0.0, activity.windowPostings);
+  ASSERT_EQ(9u, activity.postings);
+}
+
+TEST(AnomalyDetector, detachAndUnknownAccounts) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  FakeDetectorTime time;
+  AnomalyDetector detector(AnomalyDetector::Config(), nullptr);
+  Bank bank;
+  bank.addAccount();
+  bank.setPostingSink(&detector);
+  Account* late = bank.addAccount();
+  late->transferTo(*bank.accountAt(0), 5.0);
+  ASSERT_EQ(1u, detector.activity(0).postings);
+  ASSERT_EQ(1u, detector.activity(1).postings);
+
+  bank.setPostingSink(nullptr);
+  late->deposit(1.0);
+  ASSERT_EQ(1u, detector.activity(1).postings);
+  ASSERT_EQ(0u, detector.activity(5000).postings);
+  ASSERT_EQ(0u, detector.activity(-1).postings);
+}
@@ -0,0 +1,161 @@
+#include "gtest/gtest.h"
+#include "AsyncDisplay.hxx"
+#include "BufferedDisplay.hxx"
+#include "UserRequest.hxx"
+
+#include <atomic>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+class CountingDisplay : public BaseDisplay
+{
+    public:
+        void showInfoToUser(const char* message) override { text += message; }
+        void showBalance(double) override { balances++; }
+        void showTransaction(UserRequest, double) override { transactions++; }
+        void logError(std::string msg) override { errors += msg; }
+        void commit() override { commits++; }
+
+        std::string text;
+        std::string errors;
+        int balances = 0;
+        int transactions = 0;
+        int commits = 0;
+};
+
+TEST(AsyncDisplay, drainsOnShutdown) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  std::ostringstream out;
+  BufferedDisplay backend(out);
+  {
+    AsyncDisplay disp(backend, 8);
+    disp.showInfoToUser("Current Balance");
+    disp.showBalance(10.0);
+    for (int i = 0; i < 100; i++) {
+      disp.showTransaction(UserRequest::REQUEST_DEPOSIT, 1.0);
+    }
+    ASSERT_EQ(disp.dropped(), 0u);
+  }
+  std::string result = out.str();
+  ASSERT_EQ(result.find("Current Balance : 10\n"), 0u);
+  ASSERT_EQ(result.size(), std::string("Current Balance : 10\n").size() + 100 * std::string("REQUEST_DEPOSIT : 1\n").size());
+}
+
+TEST(AsyncDisplay, forwardsTextAndErrors) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  CountingDisplay backend;
+  std::string longMessage(150, 'x');
+  {
+    AsyncDisplay disp(backend);
+    disp.showInfoToUser(longMessage.c_str());
+    disp.logError("Unknown display");
+    disp.commit();
+    disp.shutdown();
+    disp.showBalance(1.0);
+    ASSERT_EQ(disp.dropped(), 1u);
+  }
+  ASSERT_EQ(backend.text, longMessage);
+  ASSERT_EQ(backend.errors, "Unknown display");
+  ASSERT_EQ(backend.balances, 0);
+  ASSERT_GE(backend.commits, 2);
+}
+
+class MessageListDisplay : public BaseDisplay
+{
+    public:
+        void showInfoToUser(const char* message) override { messages.push_back(message); }
+        void showBalance(double) override {}
+        void showTransaction(UserRequest, double) override {}
+        void logError(std::string) override {}
+        void commit() override {}
+
+        std::vector<std::string> messages;
+};
+
+TEST(AsyncDisplay, longMessagesArriveWhole) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  MessageListDisplay backend;
+  const int producers = 4;
+  const int perProducer = 2000;
+  {
+    AsyncDisplay disp(backend, 16);
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; p++) {
+      threads.emplace_back([&disp, p] {
+        std::string message(100 + p, static_cast<char>('a' + p));
+        for (int i = 0; i < perProducer; i++) {
+          disp.showInfoToUser(message.c_str());
+        }
+      });
+    }
+    for (std::thread& thread : threads) {
+      thread.join();
+    }
+  }
+  ASSERT_EQ(static_cast<std::size_t>(producers * perProducer), backend.messages.size());
+  for (const std::string& message : backend.messages) {
+    ASSERT_GE(message.size(), 100u);
+    int p = message[0] - 'a';
+    ASSERT_EQ(std::string(100 + p, message[0]), message);
+  }
+
+  // Cut at what the ring holds
+  MessageListDisplay small;
+  {
+    AsyncDisplay disp(small, 2);
+    disp.showInfoToUser(std::string(200, 'z').c_str());
+  }
+  ASSERT_EQ(1u, small.messages.size());
+  ASSERT_EQ(2 * AsyncDisplay::TEXT_CAPACITY, small.messages[0].size());
+}
+
+TEST(AsyncDisplay, dropNewestBoundsMemory) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  CountingDisplay backend;
+  const int count = 100000;
+  std::size_t dropped = 0;
+  {
+    AsyncDisplay disp(backend, 16, AsyncDisplay::DROP_NEWEST);
+    for (int i = 0; i < count; i++) {
+      disp.showTransaction(UserRequest::REQUEST_WITHDRAW, 1.0);
+    }
+    disp.shutdown();
+    dropped = disp.dropped();
+  }
+  ASSERT_EQ(backend.transactions + static_cast<int>(dropped), count);
+}
+
+TEST(AsyncDisplay, closeWhileProducing) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  for (int round = 0; round < 20; round++) {
+    CountingDisplay backend;
+    const int producers = 4;
+    const int perProducer = 5000;
+    std::size_t dropped = 0;
+    {
+      AsyncDisplay disp(backend, 64);
+      std::atomic<int> started{0};
+      std::vector<std::thread> threads;
+      for (int p = 0; p < producers; p++) {
+        threads.emplace_back([&] {
+          started++;
+          for (int i = 0; i < perProducer; i++) {
+            disp.showTransaction(UserRequest::REQUEST_DEPOSIT, 1.0);
+          }
+        });
+      }
+      while (started.load() < producers) {
+        std::this_thread::yield();
+      }
+      disp.shutdown();
+      for (std::thread& thread : threads) {
+        thread.join();
+      }
+      dropped = disp.dropped();
+    }
+    // Every call was either written out or counted as dropped
+    ASSERT_EQ(producers * perProducer, backend.transactions + static_cast<int>(dropped));
+  }
+}
@@ -0,0 +1,58 @@
+#include "gtest/gtest.h"
+#include "BufferedDisplay.hxx"
+#include "UserRequest.hxx"
+
+#include <sstream>
+#include <string>
+
+#include <unistd.h>
+
+TEST(BufferedDisplay, holdsOutputUntilCommit) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  std::ostringstream out;
+  BufferedDisplay disp(out);
+  disp.showInfoToUser("Current Balance");
+  disp.showBalance(12.5);
+  ASSERT_TRUE(out.str().empty());
+  disp.commit();
+  ASSERT_EQ(out.str(), "Current Balance : 12.5\n");
+  ASSERT_EQ(disp.pending(), 0u);
+}
+
+TEST(BufferedDisplay, flushesAtThreshold) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  std::ostringstream out;
+  BufferedDisplay disp(out, 64);
+  for (int i = 0; i < 10; i++) {
+    disp.showTransaction(UserRequest::REQUEST_DEPOSIT, 1.0);
+  }
+  ASSERT_FALSE(out.str().empty());
+  ASSERT_LT(disp.pending(), 64u);
+}
+
+TEST(BufferedDisplay, writesToDescriptorAcrossBlocks) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  int fds[2];
+  ASSERT_EQ(pipe(fds), 0);
+  const int count = 1000;
+  std::string expected;
+  {
+    BufferedDisplay disp(fds[1]);
+    for (int i = 0; i < count; i++) {
+      disp.showTransaction(UserRequest::REQUEST_WITHDRAW, 2.0);
+      expected += "REQUEST_WITHDRAW : 2\n";
+    }
+    ASSERT_GT(expected.size(), BufferedDisplay::BLOCK_SIZE);
+    disp.commit();
+    ASSERT_EQ(disp.writeErrors(), 0u);
+  }
+  close(fds[1]);
+  std::string actual;
+  char chunk[4096];
+  ssize_t n;
+  while ((n = read(fds[0], chunk, sizeof(chunk))) > 0) {
+    actual.append(chunk, static_cast<std::size_t>(n));
+  }
+  close(fds[0]);
+  ASSERT_EQ(actual, expected);
+}
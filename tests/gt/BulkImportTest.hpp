@@ -0,0 +1,145 @@
+#include "gtest/gtest.h"
+#include "Account.hxx"
+#include "Bank.hxx"
+#include "BulkImport.hxx"
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+static std::string writeImportFile(const char* name, const std::string& text) {
+  std::string path = ::testing::TempDir() + name;
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  out << text;
+  return path;
+}
+
+static BulkImportOptions importOptions(unsigned threads) {
+  BulkImportOptions options;
+  options.threads = threads;
+  return options;
+}
+
+TEST(BulkImport, accountsAndLedger) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  Bank bank;
+  std::string accounts = writeImportFile("atm_import_accounts.csv",
+      "number,password\n0,alpha\r\n1,beta\n\n3,delta");
+  BulkImportOptions options = importOptions(1);
+  options.header = true;
+  BulkImportReport report = importAccountsCsv(bank, accounts, options);
+  ASSERT_TRUE(report.ok());
+  ASSERT_EQ(3u, report.rows);
+  ASSERT_EQ(3u, report.imported);
+  ASSERT_EQ(1u, report.unlistedAccounts);
+  ASSERT_EQ(4, bank.accountCount());
+  ASSERT_NE(nullptr, bank.getAccount(0, "alpha"));
+  ASSERT_NE(nullptr, bank.getAccount(3, "delta"));
+  ASSERT_EQ(nullptr, bank.getAccount(2, "gamma"));
+
+  std::string ledger = writeImportFile("atm_import_ledger.csv",
+      "0,D,100\n1,D,2.5\n0,W,30.25\n0,B,69.75\n3,D,1e3,1704067200000000\n1,W,0.5\n");
+  report = importLedgerCsv(bank, ledger, importOptions(1));
+  ASSERT_TRUE(report.ok());
+  ASSERT_EQ(6u, report.imported);
+  ASSERT_EQ(69.75, bank.accountAt(0)->getBalance());
+  ASSERT_EQ(2.0, bank.accountAt(1)->getBalance());
+  ASSERT_EQ(1000.0, bank.accountAt(3)->getBalance());
+  TransactionView entries = bank.accountAt(0)->transactions();
+  ASSERT_EQ(3u, entries.size());
+  ASSERT_EQ(Transaction(UserRequest::REQUEST_WITHDRAW, 30.25), entries[1]);
+  ASSERT_EQ(Transaction(UserRequest::REQUEST_BALANCE, 69.75), entries[2]);
+  ASSERT_GT(entries.time(0), 0);
+  ASSERT_EQ(entries.time(0), entries.time(2));
+  ASSERT_EQ(1704067200000000, bank.accountAt(3)->transactions().time(0));
+}
+
+TEST(BulkImport, rowErrorsDoNotStopTheLoad) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  Bank bank;
+  std::string accounts = writeImportFile("atm_import_bad_accounts.csv",
+      "0,a\n0,again\nx,b\n1,\"quoted\"\n1,b,extra\n1,b\n");
+  BulkImportReport report = importAccountsCsv(bank, accounts, importOptions(1));
+  ASSERT_FALSE(report.ok());
+  ASSERT_EQ(6u, report.rows);
+  ASSERT_EQ(2u, report.imported);
+  ASSERT_EQ(4u, report.rejected);
+  ASSERT_EQ(4u, report.errors.size());
+  ASSERT_EQ(2u, report.errors[0].line);
+  ASSERT_STREQ("duplicate account", report.errors[0].reason);
+  ASSERT_EQ(3u, report.errors[1].line);
+  ASSERT_EQ(4u, report.errors[2].line);
+  ASSERT_EQ(5u, report.errors[3].line);
+
+  // Importing again: every number is taken now
+  report = importAccountsCsv(bank, accounts, importOptions(1));
+  ASSERT_EQ(0u, report.imported);
+  ASSERT_STREQ("account already exists", report.errors[0].reason);
+
+  // Numbers far past the bank are rejected rather than opening every account up to them
+  std::string sparse = writeImportFile("atm_import_sparse_accounts.csv",
+      "2147483647,x\n900000000,y\n2,c\n");
+  report = importAccountsCsv(bank, sparse, importOptions(1));
+  ASSERT_EQ(1u, report.imported);
+  ASSERT_EQ(2u, report.rejected);
+  ASSERT_STREQ("account number too far ahead", report.errors[0].reason);
+  ASSERT_STREQ("account number too far ahead", report.errors[1].reason);
+  ASSERT_EQ(3, bank.accountCount());
+
+  std::string ledger = writeImportFile("atm_import_bad_ledger.csv",
+      "0,D,10\n7,D,1\n0,X,1\n0,W,-5\n0,W,abc\n0,D\n0,D,1,12x\n1,W,4\n");
+  BulkImportOptions options = importOptions(1);
+  options.maxErrors = 2;
+  report = importLedgerCsv(bank, ledger, options);
+  ASSERT_EQ(2u, report.imported);
+  ASSERT_EQ(6u, report.rejected);
+  ASSERT_EQ(2u, report.errors.size());
+  ASSERT_STREQ("unknown account", report.errors[0].reason);
+  ASSERT_STREQ("unknown entry type", report.errors[1].reason);
+  ASSERT_EQ(10.0, bank.accountAt(0)->getBalance());
+  ASSERT_EQ(-4.0, bank.accountAt(1)->getBalance());
+
+  ASSERT_TRUE(importLedgerCsv(bank, ::testing::TempDir() + "atm_import_missing.csv").failed);
+}
+
+TEST(BulkImport, parallelMatchesSerial) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  std::string accountsText;
+  std::string ledgerText;
+  for (int n = 0; n < 200; n++) {
+    accountsText += std::to_string(n) + ",pw" + std::to_string(n) + "\n";
+  }
+  for (int i = 0; i < 5000; i++) {
+    int account = (i * 37) % 200;
+    ledgerText += std::to_string(account) + ((i % 3) ? ",D," : ",W,") +
+        std::to_string(i % 1000) + "." + std::to_string(i % 100) + "\n";
+    if (i % 997 == 0) {
+      ledgerText += "bad row\n";
+    }
+  }
+  std::string accounts = writeImportFile("atm_import_par_accounts.csv", accountsText);
+  std::string ledger = writeImportFile("atm_import_par_ledger.csv", ledgerText);
+
+  Bank serial;
+  importAccountsCsv(serial, accounts, importOptions(1));
+  BulkImportReport serialReport = importLedgerCsv(serial, ledger, importOptions(1));
+  ASSERT_EQ(5000u, serialReport.imported);
+  ASSERT_EQ(6u, serialReport.rejected);
+
+  for (unsigned threads : {2u, 7u, 64u}) {
+    Bank parallel;
+    importAccountsCsv(parallel, accounts, importOptions(threads));
+    BulkImportReport report = importLedgerCsv(parallel, ledger, importOptions(threads));
+    ASSERT_EQ(serialReport.rows, report.rows);
+    ASSERT_EQ(serialReport.imported, report.imported);
+    ASSERT_EQ(serialReport.errors.size(), report.errors.size());
+    for (std::size_t e = 0; e < report.errors.size(); e++) {
+      ASSERT_EQ(serialReport.errors[e].line, report.errors[e].line);
+    }
+    for (int n = 0; n < 200; n++) {
+      ASSERT_EQ(serial.accountAt(n)->getBalance(), parallel.accountAt(n)->getBalance());
+      ASSERT_EQ(serial.accountAt(n)->transactions().size(), parallel.accountAt(n)->transactions().size());
+      ASSERT_TRUE(parallel.accountAt(n)->checkPassword("pw" + std::to_string(n)));
+    }
+  }
+}
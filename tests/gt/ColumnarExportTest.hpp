@@ -0,0 +1,205 @@
+#include "gtest/gtest.h"
+#include "Account.hxx"
+#include "Bank.hxx"
+#include "ColumnarExport.hxx"
+#include "TestObjectFactory.hxx"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Every entry of a columnar file, row by row, for comparing against a bank
+struct ColumnarRows
+{
+  std::vector<int> accounts;
+  std::vector<double> balances;
+  std::vector<std::uint32_t> lengths;
+  std::vector<int> entryAccounts;
+  std::vector<UserRequest> entryTypes;
+  std::vector<double> entryAmounts;
+  std::vector<LedgerTime> entryTimes;
+};
+
+template <typename T, typename Out>
+static void appendColumn(const ColumnarReader& reader, ColumnarColumn column, std::vector<Out>& out)
+{
+  ColumnarTable table = ColumnarReader::tableOf(column);
+  for (std::size_t group = 0; group < reader.rowGroups(table); group++) {
+    ASSERT_EQ(out.size(), reader.firstRow(table, group));
+    reader.chunk(group, column).forEachRun<T>([&](T value, std::uint32_t, std::uint32_t count) {
+      out.insert(out.end(), count, static_cast<Out>(value));
+    });
+  }
+}
+
+static ColumnarRows readColumnarRows(const ColumnarReader& reader)
+{
+  ColumnarRows rows;
+  appendColumn<std::int32_t>(reader, ColumnarColumn::ACCOUNT_NUMBER, rows.accounts);
+  appendColumn<double>(reader, ColumnarColumn::ACCOUNT_BALANCE, rows.balances);
+  appendColumn<std::uint32_t>(reader, ColumnarColumn::ACCOUNT_ENTRIES, rows.lengths);
+  appendColumn<std::int32_t>(reader, ColumnarColumn::ENTRY_ACCOUNT, rows.entryAccounts);
+  appendColumn<std::uint8_t>(reader, ColumnarColumn::ENTRY_TYPE, rows.entryTypes);
+  appendColumn<double>(reader, ColumnarColumn::ENTRY_AMOUNT, rows.entryAmounts);
+  appendColumn<std::int64_t>(reader, ColumnarColumn::ENTRY_TIME, rows.entryTimes);
+  return (rows);
+}
+
+static void expectColumnarMatchesBank(Bank& bank, const ColumnarExportOptions& options, const char* file)
+{
+  std::string path = ::testing::TempDir() + file;
+  ColumnarExportReport report = exportColumnar(bank, path, options);
+  ASSERT_TRUE(report.ok());
+  ColumnarReader reader(path);
+  ASSERT_TRUE(reader.good());
+  ASSERT_EQ(static_cast<std::size_t>(bank.accountCount()), reader.rows(ColumnarTable::ACCOUNTS));
+  ASSERT_EQ(report.entries, reader.rows(ColumnarTable::ENTRIES));
+
+  ColumnarRows rows = readColumnarRows(reader);
+  ASSERT_EQ(report.accounts, rows.accounts.size());
+  ASSERT_EQ(report.entries, rows.entryAmounts.size());
+  std::size_t entry = 0;
+  for (int n = 0; n < bank.accountCount(); n++) {
+    Account* account = bank.accountAt(n);
+    ASSERT_EQ(n, rows.accounts[n]);
+    ASSERT_EQ(account->getBalance(), rows.balances[n]);
+    TransactionView ledger = account->transactions();
+    ASSERT_EQ(ledger.size(), rows.lengths[n]);
+    for (std::size_t i = 0; i < ledger.size(); i++) {
+      ASSERT_EQ(n, rows.entryAccounts[entry]);
+      ASSERT_EQ(std::get<0>(ledger[i]), rows.entryTypes[entry]);
+      ASSERT_EQ(std::get<1>(ledger[i]), rows.entryAmounts[entry]);
+      ASSERT_EQ(ledger.time(i), rows.entryTimes[entry]);
+      entry++;
+    }
+  }
+}
+
+TEST(ColumnarExport, roundTrip) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  SyntheticBankSpec spec;
+  spec.accounts = 300;
+  spec.maxLedgerLength = 50;
+  std::unique_ptr<Bank> bank(TestObjectFactory::getInstance()->syntheticBank(spec));
+  bank->accountAt(7)->recordBalanceInquiry();
+
+  ColumnarExportOptions options;
+  options.rowsPerGroup = 97;
+  expectColumnarMatchesBank(*bank, options, "atm_columnar_rle.col");
+  options.compress = false;
+  expectColumnarMatchesBank(*bank, options, "atm_columnar_plain.col");
+
+  Bank empty;
+  expectColumnarMatchesBank(empty, ColumnarExportOptions(), "atm_columnar_empty.col");
+}
+
+TEST(ColumnarExport, encodingsAndStats) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  Bank bank;
+  for (int n = 0; n < 4; n++) {
+    Account* account = bank.addAccount();
+    for (int i = 0; i < 25; i++) {
+      account->deposit(100.0 * n + i);
+    }
+  }
+  std::string path = ::testing::TempDir() + "atm_columnar_stats.col";
+  ColumnarExportOptions options;
+  options.rowsPerGroup = 50;
+  ColumnarExportReport report = exportColumnar(bank, path, options);
+  ASSERT_EQ(4u, report.accounts);
+  ASSERT_EQ(100u, report.entries);
+  ASSERT_EQ(3u, report.rowGroups);
+
+  ColumnarReader reader(path);
+  ASSERT_EQ(2u, reader.rowGroups(ColumnarTable::ENTRIES));
+  ColumnChunk accounts = reader.chunk(1, ColumnarColumn::ENTRY_ACCOUNT);
+  ASSERT_EQ(ColumnChunk::RLE, accounts.encoding);
+  ASSERT_EQ(2u, accounts.runs);
+  ASSERT_EQ(nullptr, accounts.values<std::int32_t>());
+  ASSERT_EQ(2.0, accounts.min);
+  ASSERT_EQ(3.0, accounts.max);
+
+  ColumnChunk amounts = reader.chunk(1, ColumnarColumn::ENTRY_AMOUNT);
+  ASSERT_EQ(ColumnChunk::PLAIN, amounts.encoding);
+  ASSERT_EQ(50u, amounts.rows);
+  ASSERT_EQ(200.0, amounts.min);
+  ASSERT_EQ(324.0, amounts.max);
+  ASSERT_EQ(200.0, amounts.values<double>()[0]);
+  ASSERT_FALSE(reader.chunk(0, ColumnarColumn::ENTRY_AMOUNT).mayContain(250.0, 1e9));
+  ASSERT_TRUE(amounts.mayContain(250.0, 1e9));
+
+  // Deposits only: the type column is a single run
+  ASSERT_EQ(1u, reader.chunk(0, ColumnarColumn::ENTRY_TYPE).runs);
+  ASSERT_EQ(0u, reader.chunk(2, ColumnarColumn::ENTRY_AMOUNT).rows);
+}
+
+TEST(ColumnarExport, rejectsDamagedFiles) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  std::unique_ptr<Bank> bank(TestObjectFactory::getInstance()->bankWithTwoAccounts());
+  std::string path = ::testing::TempDir() + "atm_columnar_damaged.col";
+  ASSERT_TRUE(exportColumnar(*bank, path).ok());
+
+  std::ifstream in(path, std::ios::binary);
+  std::string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  in.close();
+  {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(bytes.data(), bytes.size() - 3);
+  }
+  ASSERT_FALSE(ColumnarReader(path).good());
+  ASSERT_EQ(0u, ColumnarReader(path).rows(ColumnarTable::ENTRIES));
+
+  // A chunk offset pointing past the data
+  std::string corrupt = bytes;
+  std::uint64_t footerOffset = 0;
+  std::memcpy(&footerOffset, corrupt.data() + corrupt.size() - 16, sizeof(footerOffset));
+  std::uint64_t badOffset = corrupt.size();
+  std::memcpy(&corrupt[footerOffset + 40], &badOffset, sizeof(badOffset));
+  {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(corrupt.data(), corrupt.size());
+  }
+  ASSERT_FALSE(ColumnarReader(path).good());
+  ASSERT_FALSE(ColumnarReader(::testing::TempDir() + "atm_columnar_missing.col").good());
+}
+
+TEST(ColumnarExport, rejectsRunsThatMissTheRowCount) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  Bank bank;
+  Account* account = bank.addAccount();
+  for (int i = 0; i < 20; i++) {
+    account->deposit(1.0 + i);
+  }
+  std::string path = ::testing::TempDir() + "atm_columnar_runs.col";
+  ASSERT_TRUE(exportColumnar(bank, path).ok());
+  ASSERT_EQ(ColumnChunk::RLE, ColumnarReader(path).chunk(0, ColumnarColumn::ENTRY_ACCOUNT).encoding);
+
+  std::ifstream in(path, std::ios::binary);
+  std::string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  in.close();
+
+  // The entry account chunk follows the 3 account chunks in the index
+  // (40-byte footer, 48-byte records); its single run length sits after
+  // the run value, padded to 8 bytes
+  std::uint64_t footerOffset = 0;
+  std::memcpy(&footerOffset, bytes.data() + bytes.size() - 16, sizeof(footerOffset));
+  std::uint64_t chunkOffset = 0;
+  std::memcpy(&chunkOffset, bytes.data() + footerOffset + 40 + 3 * 48, sizeof(chunkOffset));
+  std::uint32_t length = 0;
+  std::memcpy(&length, bytes.data() + chunkOffset + 8, sizeof(length));
+  ASSERT_EQ(20u, length);
+
+  for (std::uint32_t bad : {21u, 19u, 0u}) {
+    std::string corrupt = bytes;
+    std::memcpy(&corrupt[chunkOffset + 8], &bad, sizeof(bad));
+    {
+      std::ofstream out(path, std::ios::binary | std::ios::trunc);
+      out.write(corrupt.data(), corrupt.size());
+    }
+    ASSERT_FALSE(ColumnarReader(path).good());
+  }
+  std::remove(path.c_str());
+}
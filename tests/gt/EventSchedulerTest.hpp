@@ -0,0 +1,54 @@
+#include "gtest/gtest.h"
+#include "EventScheduler.hxx"
+
+#include <vector>
+
+
+TEST(EventScheduler, timeOrder) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  EventScheduler<int> scheduler;
+  scheduler.schedule(30, 3);
+  scheduler.schedule(10, 1);
+  scheduler.schedule(20, 2);
+
+  std::vector<int> order;
+  int event = 0;
+  while (scheduler.next(event)) {
+    order.push_back(event);
+    if (event == 1) {
+      ASSERT_EQ(10u, scheduler.now());
+      scheduler.scheduleAfter(15, 4);
+    }
+  }
+  ASSERT_EQ((std::vector<int>{1, 2, 4, 3}), order);
+  ASSERT_EQ(30u, scheduler.now());
+  ASSERT_TRUE(scheduler.empty());
+}
+
+TEST(EventScheduler, tiesKeepScheduleOrder) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  EventScheduler<int> scheduler;
+  for (int i = 0; i < 100; i++) {
+    scheduler.schedule(5, i);
+  }
+  int event = 0;
+  for (int i = 0; i < 100; i++) {
+    ASSERT_TRUE(scheduler.next(event));
+    ASSERT_EQ(i, event);
+  }
+  ASSERT_FALSE(scheduler.next(event));
+}
+
+TEST(EventScheduler, pastEventsRunNow) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  EventScheduler<int> scheduler;
+  scheduler.schedule(100, 1);
+  int event = 0;
+  ASSERT_TRUE(scheduler.next(event));
+  scheduler.schedule(50, 2);
+  scheduler.schedule(100, 3);
+  ASSERT_EQ(2u, scheduler.pending());
+  ASSERT_TRUE(scheduler.next(event));
+  ASSERT_EQ(2, event);
+  ASSERT_EQ(100u, scheduler.now());
+}
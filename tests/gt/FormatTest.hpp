@@ -0,0 +1,83 @@
+#include "gtest/gtest.h"
+#include "Format.hxx"
+
+#include <clocale>
+#include <cstdlib>
+#include <random>
+#include <string>
+
+static std::string amountText(double value) {
+  char text[AMOUNT_BUFFER_SIZE];
+  ToCharsResult result = formatAmount(text, text + sizeof(text), value);
+  return std::string(text, result.ptr);
+}
+
+static std::string fixedText(double value, int decimals) {
+  char text[AMOUNT_BUFFER_SIZE];
+  ToCharsResult result = formatAmountFixed(text, text + sizeof(text), value, decimals);
+  return std::string(text, result.ptr);
+}
+
+TEST(Format, amountShortest) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  ASSERT_EQ(amountText(0.0), "0");
+  ASSERT_EQ(amountText(123.0), "123");
+  ASSERT_EQ(amountText(-45.5), "-45.5");
+  ASSERT_EQ(amountText(0.1), "0.1");
+  ASSERT_EQ(amountText(0.07), "0.07");
+  ASSERT_EQ(amountText(0.1 + 0.2), "0.30000000000000004");
+  ASSERT_EQ(amountText(1234567.89), "1234567.89");
+}
+
+TEST(Format, amountRoundTrips) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  std::mt19937_64 gen(42);
+  std::uniform_real_distribution<double> dist(-1e12, 1e12);
+  for (int i = 0; i < 10000; i++) {
+    double value = dist(gen);
+    ASSERT_EQ(std::strtod(amountText(value).c_str(), nullptr), value);
+  }
+  ASSERT_EQ(std::strtod(amountText(1e300).c_str(), nullptr), 1e300);
+  ASSERT_EQ(std::strtod(amountText(-2.5e-20).c_str(), nullptr), -2.5e-20);
+}
+
+TEST(Format, amountFixed) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  ASSERT_EQ(fixedText(12.5, 2), "12.50");
+  ASSERT_EQ(fixedText(-0.001, 2), "0.00");
+  ASSERT_EQ(fixedText(7.0, 0), "7");
+  ASSERT_EQ(fixedText(-3.14159, 3), "-3.142");
+}
+
+TEST(Format, slowPathsIgnoreLocale) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  // Uses a locale with a decimal comma where one is installed
+  const char* const commaLocales[] = {"de_DE.UTF-8", "de_DE.utf8", "fr_FR.UTF-8", "fr_FR.utf8"};
+  for (const char* name : commaLocales) {
+    if (std::setlocale(LC_NUMERIC, name)) {
+      break;
+    }
+  }
+  const std::string general = amountText(-2.5e-20);
+  const std::string huge = amountText(1e300);
+  const std::string fixed = fixedText(1e20, 2);
+  std::setlocale(LC_NUMERIC, "C");
+  ASSERT_EQ(general, "-2.5e-20");
+  ASSERT_EQ(huge, "1e+300");
+  ASSERT_EQ(fixed, "100000000000000000000.00");
+}
+
+TEST(Format, bufferTooSmall) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  char text[3];
+  ToCharsResult result = formatAmount(text, text + sizeof(text), 12345.0);
+  ASSERT_TRUE(result.ec == std::errc::value_too_large);
+  ASSERT_EQ(result.ptr, text + sizeof(text));
+}
+
+TEST(Format, requestNames) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  RequestName name = requestName(UserRequest::REQUEST_WITHDRAW);
+  ASSERT_EQ(std::string(name.text, name.length), "REQUEST_WITHDRAW");
+  ASSERT_EQ(requestName(static_cast<UserRequest>(42)).length, 0u);
+}
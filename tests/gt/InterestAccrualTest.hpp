@@ -0,0 +1,111 @@
+#include "gtest/gtest.h"
+#include "Account.hxx"
+#include "Bank.hxx"
+#include "InterestAccrual.hxx"
+#include "Reconciliation.hxx"
+#include "TestObjectFactory.hxx"
+
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+
+static AccrualSchedule tieredSchedule() {
+  AccrualSchedule schedule;
+  schedule.tiers = {
+    {-1e300, 0.0, -5.0},     // overdrawn: flat fee
+    {0.0, 0.0, 0.0},
+    {1000.0, 0.001, 0.0},
+    {10000.0, 0.002, 0.0},
+  };
+  return schedule;
+}
+
+TEST(InterestAccrual, tiersAndRounding) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  AccrualSchedule schedule = tieredSchedule();
+  std::vector<double> balances = {-20.0, 0.0, 999.99, 1000.0, 1234.56, 10000.0, 25000.0};
+  std::vector<double> accruals(balances.size());
+  computeAccruals(balances.data(), accruals.data(), balances.size(), schedule);
+
+  ASSERT_EQ(-5.0, accruals[0]);
+  ASSERT_EQ(0.0, accruals[1]);
+  ASSERT_EQ(0.0, accruals[2]);
+  ASSERT_EQ(1.0, accruals[3]);
+  ASSERT_EQ(1.23, accruals[4]);
+  ASSERT_EQ(20.0, accruals[5]);
+  ASSERT_EQ(50.0, accruals[6]);
+
+  // Rounded amounts are the doubles nearest the cents, on both paths
+  AccrualSchedule flat;
+  flat.tiers = {{0.0, 0.0, 0.5699999}};
+  const double pair[] = {1.0, 2.0};
+  double rounded[2] = {0.0, 0.0};
+  computeAccruals(pair, rounded, 2, flat);
+  ASSERT_EQ(0.57, rounded[0]);
+  ASSERT_EQ(0.57, rounded[1]);
+  computeAccruals(pair, rounded, 1, flat);
+  ASSERT_EQ(0.57, rounded[0]);
+}
+
+TEST(InterestAccrual, vectorMatchesScalar) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  AccrualSchedule schedule = tieredSchedule();
+  std::vector<double> balances;
+  for (int i = 0; i < 1001; i++) {
+    balances.push_back((i - 100) * 37.3331);
+  }
+  balances.push_back(NAN);
+  std::vector<double> column(balances.size());
+  computeAccruals(balances.data(), column.data(), balances.size(), schedule);
+
+  // One at a time takes the scalar path
+  for (std::size_t i = 0; i < balances.size(); i++) {
+    double single = 0.0;
+    computeAccruals(&balances[i], &single, 1, schedule);
+    ASSERT_EQ(0, std::memcmp(&single, &column[i], sizeof(double))) << "balance " << balances[i];
+  }
+}
+
+TEST(InterestAccrual, bankBatchPostsEntries) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  Bank bank;
+  bank.addAccount()->deposit(5000.0);
+  bank.addAccount()->debit(30.0);
+  bank.addAccount()->deposit(500.0);
+
+  AccrualReport report = bank.accrueInterest(tieredSchedule(), 2);
+
+  ASSERT_EQ(3u, report.accounts);
+  ASSERT_EQ(1u, report.credits);
+  ASSERT_EQ(1u, report.debits);
+  ASSERT_EQ(5.0, report.totalCredited);
+  ASSERT_EQ(5.0, report.totalDebited);
+  ASSERT_EQ(5005.0, bank.accountAt(0)->getBalance());
+  ASSERT_EQ(-35.0, bank.accountAt(1)->getBalance());
+  ASSERT_EQ(500.0, bank.accountAt(2)->getBalance());
+  ASSERT_EQ(2u, bank.accountAt(0)->transactions().size());
+  ASSERT_EQ(1u, bank.accountAt(2)->transactions().size());
+  ASSERT_TRUE(reconcileBank(bank).balanced());
+}
+
+TEST(InterestAccrual, independentOfThreads) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  SyntheticBankSpec spec;
+  spec.accounts = 9000;
+  spec.maxLedgerLength = 20;
+  std::unique_ptr<Bank> serial(TestObjectFactory::getInstance()->syntheticBank(spec));
+  std::unique_ptr<Bank> parallel(TestObjectFactory::getInstance()->syntheticBank(spec));
+
+  AccrualReport a = serial->accrueInterest(tieredSchedule(), 1);
+  AccrualReport b = parallel->accrueInterest(tieredSchedule(), 3);
+
+  ASSERT_EQ(a.credits, b.credits);
+  ASSERT_EQ(a.debits, b.debits);
+  ASSERT_EQ(a.totalCredited, b.totalCredited);
+  ASSERT_EQ(a.totalDebited, b.totalDebited);
+  ASSERT_GT(a.credits, 0u);
+  ASSERT_EQ(reconcileBank(*serial).controlTotal, reconcileBank(*parallel).controlTotal);
+  ASSERT_TRUE(reconcileBank(*parallel).balanced());
+}
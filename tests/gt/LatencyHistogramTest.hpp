@@ -0,0 +1,45 @@
+#include "gtest/gtest.h"
+#include "LatencyHistogram.hxx"
+
+#include <memory>
+#include <sstream>
+#include <string>
+
+TEST(LatencyHistogram, bucketsBoundRelativeError) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  for (std::uint64_t value = 1; value < (std::uint64_t(1) << 36); value = value * 3 + 1) {
+    int index = LatencyHistogram::bucketIndex(value);
+    std::uint64_t upper = LatencyHistogram::bucketUpperBound(index);
+    ASSERT_GE(upper, value);
+    ASSERT_LE(static_cast<double>(upper - value), 0.032 * static_cast<double>(value) + 1.0);
+  }
+}
+
+TEST(LatencyHistogram, percentiles) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  std::unique_ptr<LatencyHistogram> hist(new LatencyHistogram);
+  for (std::uint64_t i = 1; i <= 1000; i++) {
+    hist->record(i * 1000);
+  }
+  ASSERT_EQ(hist->count(), 1000u);
+  ASSERT_EQ(hist->max(), 1000000u);
+  ASSERT_NEAR(static_cast<double>(hist->valueAtPercentile(50.0)), 500000.0, 500000.0 * 0.035);
+  ASSERT_NEAR(static_cast<double>(hist->valueAtPercentile(99.0)), 990000.0, 990000.0 * 0.035);
+  ASSERT_EQ(hist->valueAtPercentile(100.0), 1000000u);
+}
+
+TEST(LatencyHistogram, statsMergeAndDump) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  LatencyStats::reset();
+  LatencyStats::record(LatencyKind::REQUEST_DEPOSIT, 100);
+  LatencyStats::record(LatencyKind::REQUEST_DEPOSIT, 300);
+  LatencyStats::Summary s = LatencyStats::summary(LatencyKind::REQUEST_DEPOSIT);
+  ASSERT_EQ(s.count, 2u);
+  ASSERT_EQ(s.max, 300u);
+  ASSERT_EQ(LatencyStats::summary(LatencyKind::VIEW_ACCOUNT).count, 0u);
+  ASSERT_EQ(latencyKindFor(UserRequest::REQUEST_WITHDRAW), LatencyKind::REQUEST_WITHDRAW);
+
+  std::ostringstream out;
+  LatencyStats::dump(out);
+  ASSERT_NE(out.str().find("REQUEST_DEPOSIT"), std::string::npos);
+}
@@ -0,0 +1,153 @@
+#include "gtest/gtest.h"
+#include "Account.hxx"
+#include "AnomalyDetector.hxx"
+#include "Bank.hxx"
+#include "LedgerFeed.hxx"
+#include "PostingSink.hxx"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+
+TEST(LedgerFeed, sequencedEventsForEachSubscriber) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  LedgerFeed feed(16);
+  Bank bank;
+  bank.setPostingSink(&feed);
+  Account* account = bank.addAccount();
+  std::unique_ptr<LedgerFeed::Subscription> fast = feed.subscribe();
+  account->deposit(10.0);
+  std::unique_ptr<LedgerFeed::Subscription> late = feed.subscribe();
+  account->debit(4.0);
+
+  LedgerEvent events[8];
+  ASSERT_EQ(2u, fast->poll(events, 8));
+  ASSERT_EQ(0u, events[0].sequence);
+  ASSERT_EQ(UserRequest::REQUEST_DEPOSIT, events[0].type);
+  ASSERT_EQ(10.0, events[0].amount);
+  ASSERT_EQ(1u, events[1].sequence);
+  ASSERT_EQ(UserRequest::REQUEST_WITHDRAW, events[1].type);
+  ASSERT_EQ(6.0, events[1].balance);
+  ASSERT_EQ(0, events[1].account);
+  ASSERT_EQ(0u, fast->poll(events, 8));
+
+  ASSERT_EQ(1u, late->poll(events, 8));
+  ASSERT_EQ(1u, events[0].sequence);
+  ASSERT_EQ(2u, feed.nextSequence());
+}
+
+TEST(LedgerFeed, runsAlongsideOtherSinks) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  LedgerFeed feed(16);
+  std::vector<Anomaly> seen;
+  AnomalyDetector detector(AnomalyDetector::Config(), [&seen](const Anomaly& a) { seen.push_back(a); });
+  PostingFanout fanout;
+  fanout.add(&feed);
+  fanout.add(&detector);
+  Bank bank;
+  bank.setPostingSink(&fanout);
+  Account* account = bank.addAccount();
+  std::unique_ptr<LedgerFeed::Subscription> subscription = feed.subscribe();
+
+  account->deposit(100.0);
+  for (int i = 0; i < 3; i++) {
+    account->debit(10.0);
+  }
+
+  LedgerEvent events[8];
+  ASSERT_EQ(4u, subscription->poll(events, 8));
+  ASSERT_EQ(70.0, events[3].balance);
+  ASSERT_EQ(1u, seen.size());
+  ASSERT_EQ(AnomalyKind::RAPID_WITHDRAWALS, seen[0].kind);
+  ASSERT_EQ(70.0, seen[0].posting.balance);
+  ASSERT_EQ(4u, detector.activity(0).postings);
+}
+
+TEST(LedgerFeed, resumeFromSequence) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  LedgerFeed feed(8, LedgerFeed::DROP_LAGGING);
+  Account account;
+  account.setPostingSink(&feed);
+  for (int i = 0; i < 5; i++) {
+    account.deposit(i);
+  }
+
+  LedgerEvent events[16];
+  std::unique_ptr<LedgerFeed::Subscription> resumed = feed.subscribe(3);
+  ASSERT_EQ(2u, resumed->poll(events, 16));
+  ASSERT_EQ(3u, events[0].sequence);
+  ASSERT_EQ(3.0, events[0].amount);
+  ASSERT_EQ(0u, resumed->lost());
+
+  for (int i = 5; i < 20; i++) {
+    account.deposit(i);
+  }
+  // Sequences below 12 are gone from an 8-slot ring
+  std::unique_ptr<LedgerFeed::Subscription> stale = feed.subscribe(2);
+  ASSERT_EQ(10u, stale->lost());
+  ASSERT_EQ(8u, stale->poll(events, 16));
+  ASSERT_EQ(12u, events[0].sequence);
+}
+
+TEST(LedgerFeed, lagDropSkipsAhead) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  LedgerFeed feed(4, LedgerFeed::DROP_LAGGING);
+  Account account;
+  account.setPostingSink(&feed);
+  std::unique_ptr<LedgerFeed::Subscription> slow = feed.subscribe();
+  for (int i = 0; i < 10; i++) {
+    account.deposit(1.0);
+  }
+
+  LedgerEvent events[16];
+  ASSERT_EQ(4u, slow->poll(events, 16));
+  ASSERT_EQ(6u, slow->lost());
+  ASSERT_EQ(6u, events[0].sequence);
+  ASSERT_EQ(10u, slow->position());
+}
+
+TEST(LedgerFeed, blockWaitsForSlowestSubscriber) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  LedgerFeed feed(4, LedgerFeed::BLOCK);
+  Account account;
+  account.setPostingSink(&feed);
+  std::unique_ptr<LedgerFeed::Subscription> reader = feed.subscribe();
+
+  std::atomic<int> posted(0);
+  std::thread producer([&]() {
+    for (int i = 0; i < 100; i++) {
+      account.deposit(i);
+      posted++;
+    }
+  });
+
+  std::vector<LedgerEvent> seen;
+  LedgerEvent events[3];
+  while (seen.size() < 100) {
+    std::size_t n = reader->poll(events, 3);
+    seen.insert(seen.end(), events, events + n);
+    ASSERT_LE(posted.load(), static_cast<int>(seen.size()) + 4);
+    std::this_thread::yield();
+  }
+  producer.join();
+
+  ASSERT_EQ(0u, reader->lost());
+  for (std::size_t i = 0; i < seen.size(); i++) {
+    ASSERT_EQ(i, seen[i].sequence);
+    ASSERT_EQ(static_cast<double>(i), seen[i].amount);
+  }
+}
+
+TEST(LedgerFeed, subscriberLimit) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  LedgerFeed feed(8);
+  std::vector<std::unique_ptr<LedgerFeed::Subscription> > subscriptions;
+  for (std::size_t i = 0; i < LedgerFeed::MAX_SUBSCRIBERS; i++) {
+    subscriptions.push_back(feed.subscribe());
+    ASSERT_NE(nullptr, subscriptions.back());
+  }
+  ASSERT_EQ(nullptr, feed.subscribe());
+  subscriptions.pop_back();
+  ASSERT_NE(nullptr, feed.subscribe());
+}
@@ -0,0 +1,187 @@
+#include "gtest/gtest.h"
+#include "Account.hxx"
+#include "Bank.hxx"
+#include "LogShipping.hxx"
+#include "TestObjectFactory.hxx"
+
+#include <fstream>
+#include <memory>
+#include <string>
+
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+static std::string shippingChannel(const char* name)
+{
+  return ("/atm-" + std::string(name) + "-" + std::to_string(::getpid()));
+}
+
+// `sameTimes` is false when the primary is a rerun of the workload rather
+// than the bank that shipped it
+static void expectReplicated(const Bank& primary, const Bank& standby, bool sameTimes = true)
+{
+  ASSERT_EQ(primary.accountCount(), standby.accountCount());
+  for (int i = 0; i < primary.accountCount(); i++) {
+    Account* expected = primary.accountAt(i);
+    Account* actual = standby.accountAt(i);
+    ASSERT_EQ(expected->getBalance(), actual->getBalance());
+    ASSERT_TRUE(actual->checkPassword(expected->getPassword()));
+    TransactionView want = expected->transactions();
+    TransactionView got = actual->transactions();
+    ASSERT_EQ(want.size(), got.size());
+    for (std::size_t e = 0; e < want.size(); e++) {
+      ASSERT_EQ(want[e], got[e]);
+      if (sameTimes) {
+        ASSERT_EQ(want.time(e), got.time(e));
+      }
+    }
+  }
+}
+
+static void runShippedWorkload(Bank& bank, int accounts, int rounds)
+{
+  for (int i = 0; i < accounts; i++) {
+    bank.addAccount()->setPassword(TestObjectFactory::passwordFor(i).c_str());
+  }
+  for (int r = 0; r < rounds; r++) {
+    int n = r % accounts;
+    bank.accountAt(n)->deposit(10.0 + r);
+    bank.transfer(n, (n + 1) % accounts, 0.25 * r);
+    if (r % 7 == 0) {
+      bank.accountAt(n)->debit(3.5);
+      bank.accountAt(n)->recordBalanceInquiry();
+    }
+  }
+}
+
+TEST(LogShipping, standbyMirrorsPrimary) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  std::string channel = shippingChannel("mirror");
+  std::string log = ::testing::TempDir() + "atm_ship_mirror.wal";
+  LogShipper shipper(channel, log);
+  ASSERT_TRUE(shipper.good());
+  Bank primary;
+  primary.setPostingSink(&shipper);
+
+  Bank standby;
+  StandbyReplica replica(standby, channel, log);
+  ASSERT_TRUE(replica.good());
+
+  runShippedWorkload(primary, 5, 100);
+  ASSERT_EQ(shipper.nextSequence(), replica.poll());
+  expectReplicated(primary, standby);
+  ASSERT_EQ(0u, replica.divergences());
+  ASSERT_EQ(0u, replica.caughtUp());
+  ASSERT_EQ(0u, replica.lag().records);
+  ASSERT_EQ(shipper.nextSequence(), replica.applyDelay().count());
+
+  primary.accountAt(2)->setPassword("changed");
+  ASSERT_EQ(1u, replica.lag().records);
+  ASSERT_EQ(1u, replica.poll());
+  ASSERT_TRUE(standby.accountAt(2)->checkPassword("changed"));
+}
+
+TEST(LogShipping, logIsPrivateAndLongPasswordsAreRejected) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  std::string channel = shippingChannel("private");
+  std::string log = ::testing::TempDir() + "atm_ship_private.wal";
+  { std::ofstream stale(log); }
+  ::chmod(log.c_str(), 0644);
+  LogShipper shipper(channel, log);
+  ASSERT_TRUE(shipper.good());
+  struct stat info;
+  ASSERT_EQ(0, ::stat(log.c_str(), &info));
+  ASSERT_EQ(0600u, info.st_mode & 0777u);
+
+  Bank primary;
+  primary.setPostingSink(&shipper);
+  Bank standby;
+  StandbyReplica replica(standby, channel, log);
+  primary.addAccount()->setPassword("short");
+  std::string tooLong(0x10000, 'x');
+  primary.accountAt(0)->setPassword(tooLong.c_str());
+  ASSERT_EQ(1u, shipper.rejectedPasswords());
+  ASSERT_EQ(2u, shipper.nextSequence());
+  ASSERT_EQ(2u, replica.poll());
+  ASSERT_TRUE(standby.accountAt(0)->checkPassword("short"));
+}
+
+TEST(LogShipping, catchUpFromLogWhenRingOverflows) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  std::string channel = shippingChannel("overflow");
+  std::string log = ::testing::TempDir() + "atm_ship_overflow.wal";
+  LogShipper shipper(channel, log, 256);
+  Bank primary;
+  primary.setPostingSink(&shipper);
+  Bank standby;
+  StandbyReplica replica(standby, channel, log);
+
+  runShippedWorkload(primary, 3, 200);
+  ASSERT_GT(shipper.ringOverflows(), 0u);
+
+  // A small batch first: the standby must stop mid-way and resume
+  ASSERT_EQ(10u, replica.poll(10));
+  replica.poll();
+  ASSERT_EQ(0u, replica.lag().records);
+  ASSERT_GT(replica.caughtUp(), 0u);
+  ASSERT_EQ(0u, replica.divergences());
+  expectReplicated(primary, standby);
+}
+
+TEST(LogShipping, standbyStartsFromSnapshot) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  std::string channel = shippingChannel("snapshot");
+  std::string log = ::testing::TempDir() + "atm_ship_snapshot.wal";
+  std::string snapshot = ::testing::TempDir() + "atm_ship_snapshot.bin";
+  LogShipper shipper(channel, log);
+  Bank primary;
+  primary.setPostingSink(&shipper);
+  runShippedWorkload(primary, 4, 50);
+
+  ASSERT_TRUE(TestObjectFactory::getInstance()->saveBank(primary, snapshot));
+  std::uint64_t snapshotSequence = shipper.nextSequence();
+  runShippedWorkload(primary, 2, 30);
+
+  std::unique_ptr<Bank> standby(TestObjectFactory::getInstance()->loadBank(snapshot));
+  ASSERT_NE(nullptr, standby);
+  StandbyReplica replica(*standby, channel, log, snapshotSequence);
+  ASSERT_EQ(shipper.nextSequence() - snapshotSequence, replica.poll());
+  ASSERT_EQ(0u, replica.divergences());
+  expectReplicated(primary, *standby);
+}
+
+TEST(LogShipping, promoteAfterPrimaryProcessExits) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  std::string channel = shippingChannel("failover");
+  std::string log = ::testing::TempDir() + "atm_ship_failover.wal";
+  std::unique_ptr<LogShipper> shipper(new LogShipper(channel, log, 4096));
+  Bank standby;
+  StandbyReplica replica(standby, channel, log);
+  ASSERT_TRUE(replica.good());
+  replica.start();
+
+  pid_t child = ::fork();
+  ASSERT_GE(child, 0);
+  if (child == 0) {
+    Bank primary;
+    primary.setPostingSink(shipper.get());
+    runShippedWorkload(primary, 6, 500);
+    shipper.reset();
+    ::_exit(0);
+  }
+  int status = 0;
+  ASSERT_EQ(child, ::waitpid(child, &status, 0));
+  ASSERT_TRUE(WIFEXITED(status));
+
+  std::uint64_t next = replica.promote();
+  ASSERT_EQ(0u, replica.lag().records);
+  ASSERT_EQ(0u, replica.divergences());
+  ASSERT_TRUE(shipper->standbyPromoted());
+
+  // The same workload run here reproduces the primary's bank
+  Bank expected;
+  runShippedWorkload(expected, 6, 500);
+  expectReplicated(expected, standby, false);
+  ASSERT_GT(next, 500u);
+}
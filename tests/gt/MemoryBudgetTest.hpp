@@ -0,0 +1,245 @@
+#include "gtest/gtest.h"
+#include "Account.hxx"
+#include "Bank.hxx"
+#include "MemoryBudget.hxx"
+#include "Reconciliation.hxx"
+#include "TestObjectFactory.hxx"
+#include "TransactionQuery.hxx"
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+static std::string spillFile(const std::string& directory, int account)
+{
+  return directory + "/ledger-" + std::to_string(account) + ".spill";
+}
+
+TEST(MemoryBudget, statsFollowTheBank) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  Bank bank;
+  MemoryStats empty = bank.memoryStats();
+  ASSERT_EQ(0u, empty.accounts);
+  ASSERT_EQ(0u, empty.total());
+
+  for (int i = 0; i < 10; i++) {
+    Account* account = bank.addAccount();
+    account->setPassword((i < 5) ? "short" : "a password too long to fit inside the string");
+    for (int d = 0; d < 20 * i; d++) {
+      account->deposit(1.0);
+    }
+  }
+  bank.transfer(9, 0, 5.0);
+
+  MemoryStats stats = bank.memoryStats();
+  ASSERT_EQ(10u, stats.accounts);
+  ASSERT_EQ(10 * sizeof(Account), stats.accountBytes);
+  ASSERT_GE(stats.directoryBytes, 10 * sizeof(Account*));
+  ASSERT_EQ(900u + 2u, stats.ledgerEntries);
+  ASSERT_GE(stats.ledgerUsedBytes, stats.ledgerEntries * (sizeof(Transaction) + sizeof(LedgerTime)));
+  ASSERT_GT(stats.ledgerBytes, stats.ledgerUsedBytes);
+  ASSERT_GT(stats.credentialBytes, 5 * 40u);
+  ASSERT_LT(stats.credentialBytes, 5 * 100u);
+
+  // Compacted ledgers hold exactly their entries
+  for (int i = 0; i < bank.accountCount(); i++) {
+    bank.accountAt(i)->compactLedger();
+  }
+  stats = bank.memoryStats();
+  ASSERT_EQ(stats.ledgerUsedBytes, stats.ledgerBytes);
+
+  bank.accountAt(0)->setPassword(std::string(100, 'x').c_str());
+  ASSERT_EQ(stats.credentialBytes + 101, bank.memoryStats().credentialBytes);
+}
+
+TEST(MemoryBudget, trimmingKeepsBalancesAndSpills) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  SyntheticBankSpec spec;
+  spec.accounts = 300;
+  spec.maxLedgerLength = 4000;
+  std::unique_ptr<Bank> bank(TestObjectFactory::getInstance()->syntheticBank(spec));
+  std::unique_ptr<Bank> original(TestObjectFactory::getInstance()->syntheticBank(spec));
+  const std::string directory = ::testing::TempDir();
+  for (int n = 0; n < spec.accounts; n++) {
+    std::remove(spillFile(directory, n).c_str());
+  }
+
+  MemoryBudget budget;
+  budget.limitBytes = bank->memoryStats().total() / 2;
+  budget.keepEntries = 100;
+  budget.spillDirectory = directory;
+  bank->setMemoryBudget(budget);
+  MemoryBudgetReport report = bank->enforceMemoryBudget();
+
+  ASSERT_TRUE(report.withinBudget);
+  ASSERT_LE(report.bytesAfter, static_cast<std::size_t>(budget.limitBytes * budget.lowWater));
+  ASSERT_EQ(bank->memoryStats().total(), report.bytesAfter);
+  ASSERT_GT(report.trimmedAccounts, 0u);
+  ASSERT_EQ(report.trimmedEntries, report.spilledEntries);
+  ASSERT_EQ(0u, report.spillFailures);
+  ASSERT_TRUE(reconcileBank(*bank, 1).balanced());
+
+  std::size_t trimmed = 0;
+  for (int n = 0; n < spec.accounts; n++) {
+    Account* account = bank->accountAt(n);
+    Account* full = original->accountAt(n);
+    ASSERT_EQ(full->getBalance(), account->getBalance());
+    TransactionView want = full->transactions();
+    TransactionView kept = account->transactions();
+    if (kept.size() == want.size()) {
+      continue;
+    }
+    trimmed++;
+    ASSERT_EQ(budget.keepEntries + 1, kept.size());
+
+    // Spilled entries, then the kept ones, make up the original ledger
+    std::vector<Transaction> spilled;
+    std::vector<LedgerTime> times;
+    ASSERT_TRUE(loadSpilledLedger(directory, n, spilled, times));
+    ASSERT_EQ(want.size() - budget.keepEntries, spilled.size());
+    for (std::size_t i = 0; i < want.size(); i++) {
+      const bool inSpill = (i < spilled.size());
+      const std::size_t k = i - spilled.size() + 1;
+      ASSERT_EQ(want[i], inSpill ? spilled[i] : kept[k]);
+      ASSERT_EQ(want.time(i), inSpill ? times[i] : kept.time(k));
+    }
+    ASSERT_EQ(want.time(spilled.size() - 1), kept.time(0));
+
+    // The time index still finds the same period and opening balance
+    TimeRange recent;
+    recent.from = want.time(want.size() - budget.keepEntries / 2);
+    double wantOpening = 0.0;
+    double gotOpening = 1.0;
+    std::size_t wantSize = 0;
+    std::size_t gotSize = 1;
+    full->withPeriod(recent, [&](double opening, std::size_t, const TransactionView& entries) {
+      wantOpening = opening;
+      wantSize = entries.size();
+    });
+    account->withPeriod(recent, [&](double opening, std::size_t, const TransactionView& entries) {
+      gotOpening = opening;
+      gotSize = entries.size();
+    });
+    ASSERT_EQ(wantOpening, gotOpening);
+    ASSERT_EQ(wantSize, gotSize);
+    std::remove(spillFile(directory, n).c_str());
+  }
+  ASSERT_EQ(report.trimmedAccounts, trimmed);
+}
+
+TEST(MemoryBudget, trimmingTwiceSpillsEachEntryOnce) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  Bank bank;
+  Account* account = bank.addAccount();
+  const std::string directory = ::testing::TempDir();
+  std::remove(spillFile(directory, 0).c_str());
+  std::size_t spilledEntries = 0;
+  auto spill = [&](const TransactionView& entries) {
+    spilledEntries += entries.size();
+    return spillLedger(directory, 0, entries);
+  };
+
+  std::vector<Transaction> history;
+  for (int round = 0; round < 2; round++) {
+    for (int i = 0; i < 300; i++) {
+      if (i % 3 == 2) {
+        account->debit(2.5);
+        history.emplace_back(UserRequest::REQUEST_WITHDRAW, 2.5);
+      } else {
+        account->deposit(1.25 + i);
+        history.emplace_back(UserRequest::REQUEST_DEPOSIT, 1.25 + i);
+      }
+    }
+    const std::size_t before = account->transactions().size();
+    const std::size_t trimmed = account->trimLedger(100, spill);
+    ASSERT_EQ(before - 100 - round, trimmed);
+    ASSERT_EQ(UserRequest::REQUEST_CARRY_FORWARD, std::get<0>(account->transactions()[0]));
+  }
+  ASSERT_EQ(history.size() - 100, spilledEntries);
+
+  // The spill file, then the live ledger past its carry-forward, is the
+  // whole history with nothing counted twice
+  std::vector<Transaction> spilled;
+  std::vector<LedgerTime> times;
+  ASSERT_TRUE(loadSpilledLedger(directory, 0, spilled, times));
+  TransactionView live = account->transactions();
+  ASSERT_EQ(101u, live.size());
+  ASSERT_EQ(history.size(), spilled.size() + live.size() - 1);
+  double balance = 0.0;
+  for (std::size_t i = 0; i < history.size(); i++) {
+    const Transaction& entry = (i < spilled.size()) ? spilled[i] : live[i - spilled.size() + 1];
+    ASSERT_EQ(history[i], entry);
+    balance += (std::get<0>(entry) == UserRequest::REQUEST_DEPOSIT) ? std::get<1>(entry) : -std::get<1>(entry);
+  }
+  ASSERT_DOUBLE_EQ(account->getBalance(), balance);
+  ASSERT_TRUE(reconcileBank(bank, 1).balanced());
+
+  // Queries and listings leave the carry-forward out
+  TransactionQuery query;
+  query.threads = 1;
+  ASSERT_EQ(100u, runQuery(bank, query).count);
+  std::remove(spillFile(directory, 0).c_str());
+}
+
+TEST(MemoryBudget, spillRunsWithoutTheAccountLock) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  Account account;
+  for (int i = 0; i < 200; i++) {
+    account.deposit(1.0);
+  }
+
+  // The account takes postings, but no second trim, while it spills
+  std::size_t spilled = 0;
+  const std::size_t trimmed = account.trimLedger(50, [&](const TransactionView& entries) {
+    spilled = entries.size();
+    account.deposit(0.5);
+    EXPECT_EQ(0u, account.trimLedger(10));
+    return true;
+  });
+  ASSERT_EQ(150u, trimmed);
+  ASSERT_EQ(150u, spilled);
+  ASSERT_EQ(200.5, account.getBalance());
+  ASSERT_EQ(52u, account.transactions().size());
+
+  // A failed spill leaves the ledger as it was
+  ASSERT_EQ(0u, account.trimLedger(10, [](const TransactionView&) { return false; }));
+  ASSERT_EQ(52u, account.transactions().size());
+}
+
+TEST(MemoryBudget, enforcedInTheBackground) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  Bank bank;
+  for (int i = 0; i < 4; i++) {
+    bank.addAccount();
+  }
+  MemoryBudget budget;
+  budget.limitBytes = 64 * 1024;
+  budget.keepEntries = 16;
+  bank.setMemoryBudget(budget);
+
+  // Well past the limit in total, spread over the accounts
+  for (int r = 0; r < 20000; r++) {
+    bank.accountAt(r % 4)->deposit(0.5);
+  }
+  std::size_t total = bank.memoryStats().total();
+  for (int wait = 0; (wait < 200) && (total > budget.limitBytes); wait++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    total = bank.memoryStats().total();
+  }
+  ASSERT_LE(total, budget.limitBytes);
+  ASSERT_EQ(2500.0, bank.accountAt(0)->getBalance());
+  ASSERT_LT(bank.memoryStats().ledgerEntries, 20000u);
+  ASSERT_TRUE(reconcileBank(bank, 1).balanced());
+
+  // Lifting the budget stops trimming
+  budget.limitBytes = 0;
+  bank.setMemoryBudget(budget);
+  std::size_t entries = bank.memoryStats().ledgerEntries;
+  for (int r = 0; r < 20000; r++) {
+    bank.accountAt(r % 4)->deposit(0.5);
+  }
+  ASSERT_EQ(entries + 20000, bank.memoryStats().ledgerEntries);
+}
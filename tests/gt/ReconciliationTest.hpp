@@ -0,0 +1,115 @@
+#include "gtest/gtest.h"
+#include "Account.hxx"
+#include "Bank.hxx"
+#include "ExactSum.hxx"
+#include "Reconciliation.hxx"
+#include "TestObjectFactory.hxx"
+
+#include <cmath>
+#include <memory>
+#include <vector>
+
+
+TEST(ExactSum, cancellation) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  ExactSum sum;
+  sum.add(1e100);
+  sum.add(1.0);
+  sum.add(-1e100);
+  ASSERT_EQ(1.0, sum.value());
+
+  ExactSum tiny;
+  tiny.add(5e-324);
+  tiny.add(1e300);
+  tiny.subtract(1e300);
+  ASSERT_EQ(5e-324, tiny.value());
+}
+
+TEST(ExactSum, orderIndependentAndCorrectlyRounded) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  std::vector<double> values;
+  for (int i = 0; i < 1000; i++) {
+    values.push_back(0.1);
+    values.push_back(-0.3 * i);
+    values.push_back(1e-3 * i);
+  }
+  ExactSum forward;
+  ExactSum backward;
+  for (std::size_t i = 0; i < values.size(); i++) {
+    forward.add(values[i]);
+    backward.add(values[values.size() - 1 - i]);
+  }
+  ASSERT_EQ(forward.value(), backward.value());
+
+  // 0.1 is slightly above 1/10, ten of them sum to just above 1
+  ExactSum tenths;
+  for (int i = 0; i < 10; i++) {
+    tenths.add(0.1);
+  }
+  ASSERT_EQ(1.0, tenths.value());
+  ASSERT_FALSE(tenths.isZero());
+  tenths.add(-1.0);
+  ASSERT_EQ(std::ldexp(1.0, -54), tenths.value());
+}
+
+TEST(ExactSum, mergeAndNonFinite) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  ExactSum a;
+  ExactSum b;
+  a.add(2.5);
+  b.add(-7.25);
+  a.add(b);
+  ASSERT_EQ(-4.75, a.value());
+  a.add(4.75);
+  ASSERT_TRUE(a.isZero());
+  a.add(INFINITY);
+  ASSERT_TRUE(std::isnan(a.value()));
+}
+
+TEST(Reconciliation, balancedBank) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  SyntheticBankSpec spec;
+  spec.accounts = 400;
+  spec.maxLedgerLength = 100;
+  std::unique_ptr<Bank> bank(TestObjectFactory::getInstance()->syntheticBank(spec));
+  bank->getAccount(3, TestObjectFactory::passwordFor(3))->recordBalanceInquiry();
+
+  ReconciliationReport serial = reconcileBank(*bank, 1);
+  ReconciliationReport parallel = reconcileBank(*bank, 4);
+
+  ASSERT_TRUE(serial.balanced());
+  ASSERT_TRUE(parallel.balanced());
+  ASSERT_EQ(400u, serial.accounts);
+  ASSERT_GE(serial.inquiries, 1u);
+  ASSERT_EQ(serial.postings, parallel.postings);
+  ASSERT_EQ(serial.controlTotal, parallel.controlTotal);
+  ASSERT_EQ(serial.ledgerTotal, parallel.ledgerTotal);
+  ASSERT_NEAR(serial.ledgerTotal, serial.controlTotal, 1e-6);
+}
+
+TEST(Reconciliation, reportsMismatches) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  Bank bank;
+  for (int i = 0; i < 10; i++) {
+    Account* account = bank.addAccount();
+    account->deposit(100.0);
+    account->debit(0.1);
+  }
+  bank.accountAt(7)->restore(99.91, {Transaction(UserRequest::REQUEST_DEPOSIT, 100.0),
+                                     Transaction(UserRequest::REQUEST_WITHDRAW, 0.1)});
+  bank.accountAt(2)->restore(50.0, {Transaction(UserRequest::REQUEST_DEPOSIT, 50.0),
+                                    Transaction(UserRequest::REQUEST_BALANCE, 50.0),
+                                    Transaction(UserRequest::REQUEST_WITHDRAW, 1.0)});
+
+  ReconciliationReport report = reconcileBank(bank, 3);
+
+  ASSERT_FALSE(report.balanced());
+  ASSERT_EQ(2u, report.mismatches.size());
+  ASSERT_EQ(2, report.mismatches[0].account);
+  ASSERT_EQ(49.0, report.mismatches[0].expected);
+  ASSERT_EQ(7, report.mismatches[1].account);
+  ASSERT_EQ(99.91, report.mismatches[1].balance);
+  ASSERT_EQ(100.0 - 0.1, report.mismatches[1].expected);
+  ASSERT_EQ(1u, report.inquiries);
+  ASSERT_EQ(20u, report.postings);
+}
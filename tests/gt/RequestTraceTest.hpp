@@ -0,0 +1,97 @@
+#include "gtest/gtest.h"
+#include "ATM.hxx"
+#include "Bank.hxx"
+#include "NullDisplay.hxx"
+#include "RequestTrace.hxx"
+
+#include <cstdio>
+#include <fstream>
+#include <vector>
+
+
+TEST(RequestTrace, roundTrip) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  std::string path = ::testing::TempDir() + "atm_trace_roundtrip.bin";
+  {
+    RequestTraceWriter writer(path);
+    ASSERT_TRUE(writer.good());
+    std::uint32_t first = writer.openSession();
+    std::uint32_t second = writer.openSession();
+    writer.recordViewAccount(first, 123456);
+    writer.recordRequest(first, UserRequest::REQUEST_DEPOSIT, 12.5);
+    writer.recordRequest(second, UserRequest::REQUEST_BALANCE, 99.0);
+    writer.recordRequest(second, UserRequest::REQUEST_WITHDRAW, -0.25);
+    ASSERT_EQ(4u, writer.recordCount());
+    ASSERT_TRUE(writer.close());
+  }
+
+  std::vector<RequestTraceRecord> records;
+  ASSERT_TRUE(loadRequestTrace(path, records));
+  std::remove(path.c_str());
+  ASSERT_EQ(4u, records.size());
+
+  ASSERT_EQ(RequestTraceRecord::Kind::VIEW_ACCOUNT, records[0].kind);
+  ASSERT_EQ(123456, records[0].account);
+  ASSERT_EQ(0u, records[0].session);
+  ASSERT_EQ(UserRequest::REQUEST_DEPOSIT, records[1].request);
+  ASSERT_EQ(12.5, records[1].amount);
+  ASSERT_EQ(1u, records[2].session);
+  ASSERT_EQ(UserRequest::REQUEST_BALANCE, records[2].request);
+  ASSERT_EQ(0.0, records[2].amount);
+  ASSERT_EQ(-0.25, records[3].amount);
+  for (std::size_t i = 1; i < records.size(); i++) {
+    ASSERT_LE(records[i - 1].offset, records[i].offset);
+  }
+}
+
+TEST(RequestTrace, atmRecordsSessions) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  std::string path = ::testing::TempDir() + "atm_trace_sessions.bin";
+  Bank bank;
+  bank.addAccount()->setPassword("pw");
+  NullDisplay display;
+  {
+    RequestTraceWriter writer(path);
+    ATM first(&bank, &display);
+    ATM second(&bank, &display);
+    first.setRecorder(&writer);
+    second.setRecorder(&writer);
+    first.viewAccount(0, "pw");
+    second.viewAccount(0, "pw");
+    first.fillUserRequest(UserRequest::REQUEST_WITHDRAW, 5.0);
+    second.setRecorder(nullptr);
+    second.fillUserRequest(UserRequest::REQUEST_BALANCE, 0.0);
+  }
+
+  std::vector<RequestTraceRecord> records;
+  ASSERT_TRUE(loadRequestTrace(path, records));
+  std::remove(path.c_str());
+  ASSERT_EQ(3u, records.size());
+  ASSERT_NE(records[0].session, records[1].session);
+  ASSERT_EQ(records[0].session, records[2].session);
+  ASSERT_EQ(UserRequest::REQUEST_WITHDRAW, records[2].request);
+  ASSERT_EQ(5.0, records[2].amount);
+}
+
+TEST(RequestTrace, rejectsTruncatedTrace) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  std::string path = ::testing::TempDir() + "atm_trace_truncated.bin";
+  {
+    RequestTraceWriter writer(path);
+    writer.recordRequest(writer.openSession(), UserRequest::REQUEST_DEPOSIT, 1.0);
+  }
+  std::vector<char> bytes;
+  {
+    std::ifstream in(path, std::ios::binary);
+    bytes.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+  }
+  {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(bytes.data(), bytes.size() - 3);
+  }
+
+  std::vector<RequestTraceRecord> records;
+  ASSERT_FALSE(loadRequestTrace(path, records));
+  std::remove(path.c_str());
+  ASSERT_FALSE(loadRequestTrace(path, records));
+}
@@ -0,0 +1,193 @@
+#include "gtest/gtest.h"
+#include "Account.hxx"
+#include "Bank.hxx"
+#include "StatementEngine.hxx"
+#include "TestObjectFactory.hxx"
+
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+
+static std::string readStatementFile(const std::string& path) {
+  std::ifstream in(path);
+  std::stringstream text;
+  text << in.rdbuf();
+  return text.str();
+}
+
+static StatementOptions statementOptions(const char* prefix, unsigned shards) {
+  StatementOptions options;
+  options.directory = ::testing::TempDir();
+  options.prefix = prefix;
+  options.shards = shards;
+  return options;
+}
+
+TEST(StatementEngine, rendersStatements) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  Bank bank;
+  Account* first = bank.addAccount();
+  first->deposit(100.0);
+  first->recordBalanceInquiry();
+  first->debit(25.5);
+  bank.addAccount();
+
+  StatementReport report = StatementEngine(statementOptions("stmt_render", 1)).run(bank);
+
+  ASSERT_TRUE(report.ok());
+  ASSERT_EQ(2u, report.accounts);
+  ASSERT_EQ(2u, report.entries);
+  ASSERT_EQ(1u, report.files.size());
+  ASSERT_EQ("Account 0\n"
+            "Opening Balance : 0\n"
+            "REQUEST_DEPOSIT : 100\n"
+            "REQUEST_WITHDRAW : 25.5\n"
+            "Closing Balance : 74.5\n"
+            "\n"
+            "Account 1\n"
+            "Opening Balance : 0\n"
+            "Closing Balance : 0\n"
+            "\n", readStatementFile(report.files[0]));
+  std::remove(report.files[0].c_str());
+}
+
+TEST(StatementEngine, cursorsContinueNextPeriod) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  Bank bank;
+  Account* account = bank.addAccount();
+  account->deposit(10.0);
+  std::vector<std::size_t> cursors;
+  StatementOptions options = statementOptions("stmt_cursor", 1);
+  options.cursors = &cursors;
+
+  StatementEngine(options).run(bank);
+  ASSERT_EQ(1u, cursors.size());
+  ASSERT_EQ(1u, cursors[0]);
+
+  account->debit(4.0);
+  StatementReport report = StatementEngine(options).run(bank);
+  ASSERT_EQ(1u, report.entries);
+  ASSERT_EQ("Account 0\n"
+            "Opening Balance : 10\n"
+            "REQUEST_WITHDRAW : 4\n"
+            "Closing Balance : 6\n"
+            "\n", readStatementFile(report.files[0]));
+  ASSERT_EQ(2u, cursors[0]);
+  std::remove(report.files[0].c_str());
+}
+
+TEST(StatementEngine, cursorsSurviveTrimming) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  Bank bank;
+  Account* account = bank.addAccount();
+  for (int i = 0; i < 10; i++) {
+    account->deposit(1.0);
+  }
+  std::vector<std::size_t> cursors;
+  StatementOptions options = statementOptions("stmt_trim", 1);
+  options.cursors = &cursors;
+  StatementEngine(options).run(bank);
+  ASSERT_EQ(10u, cursors[0]);
+
+  // Trimmed after the statement: the next one lists just the new entry
+  account->debit(3.0);
+  ASSERT_EQ(8u, account->trimLedger(3));
+  ASSERT_EQ(8u, account->trimmedBefore());
+  StatementReport report = StatementEngine(options).run(bank);
+  ASSERT_EQ(1u, report.entries);
+  ASSERT_EQ(0u, report.trimmedCursors);
+  ASSERT_EQ("Account 0\n"
+            "Opening Balance : 10\n"
+            "REQUEST_WITHDRAW : 3\n"
+            "Closing Balance : 7\n"
+            "\n", readStatementFile(report.files[0]));
+  ASSERT_EQ(11u, cursors[0]);
+
+  // Trimmed past the cursor before a statement: counted, and the
+  // statement starts at the oldest entry still held
+  for (int i = 0; i < 5; i++) {
+    account->deposit(2.0);
+  }
+  ASSERT_EQ(6u, account->trimLedger(2));
+  ASSERT_EQ(14u, account->trimmedBefore());
+  report = StatementEngine(options).run(bank);
+  ASSERT_EQ(2u, report.entries);
+  ASSERT_EQ(1u, report.trimmedCursors);
+  ASSERT_EQ("Account 0\n"
+            "Opening Balance : 13\n"
+            "REQUEST_DEPOSIT : 2\n"
+            "REQUEST_DEPOSIT : 2\n"
+            "Closing Balance : 17\n"
+            "\n", readStatementFile(report.files[0]));
+  ASSERT_EQ(16u, cursors[0]);
+  std::remove(report.files[0].c_str());
+}
+
+TEST(StatementEngine, periodStatement) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  Bank bank;
+  Account* account = bank.addAccount();
+  const Transaction entries[] = {Transaction(UserRequest::REQUEST_DEPOSIT, 50.0),
+                                 Transaction(UserRequest::REQUEST_WITHDRAW, 5.0),
+                                 Transaction(UserRequest::REQUEST_DEPOSIT, 7.0),
+                                 Transaction(UserRequest::REQUEST_WITHDRAW, 1.0)};
+  const LedgerTime times[] = {100, 200, 300, 400};
+  account->appendPostings(entries, times, 4);
+  std::vector<std::size_t> cursors;
+  StatementOptions options = statementOptions("stmt_period", 1);
+  options.period.from = 200;
+  options.period.to = 400;
+  options.cursors = &cursors;
+
+  StatementReport report = StatementEngine(options).run(bank);
+  ASSERT_EQ(2u, report.entries);
+  ASSERT_EQ("Account 0\n"
+            "Opening Balance : 50\n"
+            "REQUEST_WITHDRAW : 5\n"
+            "REQUEST_DEPOSIT : 7\n"
+            "Closing Balance : 52\n"
+            "\n", readStatementFile(report.files[0]));
+  // The entry after the period is left for the next statement
+  ASSERT_EQ(3u, cursors[0]);
+  std::remove(report.files[0].c_str());
+}
+
+TEST(StatementEngine, shardsCoverEveryAccount) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  SyntheticBankSpec spec;
+  spec.accounts = 1000;
+  spec.maxLedgerLength = 50;
+  std::unique_ptr<Bank> bank(TestObjectFactory::getInstance()->syntheticBank(spec));
+
+  StatementReport report = StatementEngine(statementOptions("stmt_shards", 3)).run(*bank);
+
+  ASSERT_TRUE(report.ok());
+  ASSERT_EQ(1000u, report.accounts);
+  ASSERT_EQ(3u, report.files.size());
+  std::size_t statements = 0;
+  for (const std::string& file : report.files) {
+    std::string text = readStatementFile(file);
+    for (std::size_t at = text.find("Closing Balance"); at != std::string::npos;
+         at = text.find("Closing Balance", at + 1)) {
+      statements++;
+    }
+    std::remove(file.c_str());
+  }
+  ASSERT_EQ(1000u, statements);
+}
+
+TEST(StatementEngine, reportsUnwritableDirectory) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  Bank bank;
+  bank.addAccount();
+  StatementOptions options = statementOptions("stmt_fail", 2);
+  options.directory = "/nonexistent-statement-dir";
+
+  StatementReport report = StatementEngine(options).run(bank);
+  ASSERT_FALSE(report.ok());
+  ASSERT_EQ(2u, report.failedShards);
+}
@@ -0,0 +1,135 @@
+#include "gtest/gtest.h"
+#include "Account.hxx"
+#include "Bank.hxx"
+#include "TestObjectFactory.hxx"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <vector>
+
+
+static std::vector<Transaction> ledgerOf(Account& account)
+{
+  std::vector<Transaction> ledger;
+  account.withTransactions([&ledger](const TransactionView& view) {
+    ledger.assign(view.begin(), view.end());
+  });
+  return ledger;
+}
+
+static void expectSameBank(Bank& expected, Bank& actual)
+{
+  ASSERT_EQ(expected.accountCount(), actual.accountCount());
+  for (int n = 0; n < expected.accountCount(); n++) {
+    Account* a = expected.accountAt(n);
+    Account* b = actual.accountAt(n);
+    ASSERT_STREQ(a->getPassword(), b->getPassword());
+    ASSERT_EQ(a->getBalance(), b->getBalance());
+    ASSERT_TRUE(ledgerOf(*a) == ledgerOf(*b)) << "account " << n;
+    TransactionView timesA = a->transactions();
+    TransactionView timesB = b->transactions();
+    ASSERT_TRUE(std::equal(timesA.times(), timesA.times() + timesA.size(), timesB.times()))
+        << "account " << n;
+  }
+}
+
+TEST(TestObjectFactory, syntheticBankShape) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  SyntheticBankSpec spec;
+  spec.accounts = 500;
+  spec.maxLedgerLength = 200;
+  std::unique_ptr<Bank> bank(TestObjectFactory::getInstance()->syntheticBank(spec));
+
+  ASSERT_EQ(spec.accounts, bank->accountCount());
+  std::size_t longest = 0;
+  int singleEntry = 0;
+  for (int n = 0; n < spec.accounts; n++) {
+    std::size_t length = ledgerOf(*bank->accountAt(n)).size();
+    ASSERT_GE(length, 1u);
+    ASSERT_LE(length, static_cast<std::size_t>(spec.maxLedgerLength));
+    longest = std::max(longest, length);
+    singleEntry += (length == 1) ? 1 : 0;
+  }
+  // Skewed: plenty of one-entry ledgers and at least one busy account
+  EXPECT_GT(singleEntry, spec.accounts / 4);
+  EXPECT_GT(longest, 20u);
+
+  Account* acct = bank->getAccount(7, TestObjectFactory::passwordFor(7));
+  ASSERT_TRUE(nullptr != acct);
+}
+
+TEST(TestObjectFactory, syntheticBankIndependentOfThreads) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  SyntheticBankSpec spec;
+  spec.accounts = 300;
+  spec.seed = 42;
+  spec.threads = 1;
+  std::unique_ptr<Bank> serial(TestObjectFactory::getInstance()->syntheticBank(spec));
+  spec.threads = 4;
+  std::unique_ptr<Bank> parallel(TestObjectFactory::getInstance()->syntheticBank(spec));
+
+  expectSameBank(*serial, *parallel);
+}
+
+TEST(TestObjectFactory, saveLoadRoundTrip) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  SyntheticBankSpec spec;
+  spec.accounts = 100;
+  std::unique_ptr<Bank> bank(TestObjectFactory::getInstance()->syntheticBank(spec));
+  std::string path = ::testing::TempDir() + "atm_bank_roundtrip.bin";
+
+  ASSERT_TRUE(TestObjectFactory::getInstance()->saveBank(*bank, path));
+  std::unique_ptr<Bank> loaded(TestObjectFactory::getInstance()->loadBank(path));
+  std::remove(path.c_str());
+
+  ASSERT_TRUE(nullptr != loaded);
+  expectSameBank(*bank, *loaded);
+}
+
+TEST(TestObjectFactory, loadBankRejectsBadFile) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  std::string path = ::testing::TempDir() + "atm_bank_bad.bin";
+  FILE* file = std::fopen(path.c_str(), "wb");
+  std::fputs("not a bank", file);
+  std::fclose(file);
+
+  Bank* loaded = TestObjectFactory::getInstance()->loadBank(path);
+  std::remove(path.c_str());
+
+  ASSERT_TRUE(nullptr == loaded);
+  ASSERT_TRUE(nullptr == TestObjectFactory::getInstance()->loadBank(path));
+}
+
+TEST(TestObjectFactory, loadBankRejectsBadLengths) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  SyntheticBankSpec spec;
+  spec.accounts = 3;
+  std::unique_ptr<Bank> bank(TestObjectFactory::getInstance()->syntheticBank(spec));
+  std::string path = ::testing::TempDir() + "atm_bank_lengths.bin";
+  ASSERT_TRUE(TestObjectFactory::getInstance()->saveBank(*bank, path));
+  std::ifstream in(path, std::ios::binary);
+  std::string good((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  in.close();
+
+  // Lengths far beyond what the file holds fail cleanly instead of sizing from them
+  const std::uint64_t huge = 0x0fffffffffffffffULL;
+  const std::size_t countOffset = 8;
+  const std::size_t passwordOffset = countOffset + sizeof(std::uint64_t);
+  const std::uint32_t passwordLength = static_cast<std::uint32_t>(std::strlen(bank->accountAt(0)->getPassword()));
+  const std::size_t ledgerOffset = passwordOffset + sizeof(std::uint32_t) + passwordLength + sizeof(double);
+  const std::size_t offsets[] = {countOffset, passwordOffset, ledgerOffset};
+  for (std::size_t offset : offsets) {
+    std::string bad = good;
+    std::memcpy(&bad[offset], &huge, (offset == passwordOffset) ? sizeof(std::uint32_t) : sizeof(huge));
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out << bad;
+    out.close();
+    ASSERT_TRUE(nullptr == TestObjectFactory::getInstance()->loadBank(path)) << offset;
+  }
+  std::remove(path.c_str());
+}
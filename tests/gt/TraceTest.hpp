@@ -0,0 +1,44 @@
+#include "gtest/gtest.h"
+#include "Trace.hxx"
+
+#include <sstream>
+#include <string>
+
+TEST(Trace, disabledRecordsNothing) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  Trace::clear();
+  Trace::setEnabled(false);
+  { TraceSpan span("Trace::disabled"); }
+  std::ostringstream out;
+  Trace::writeChromeJson(out);
+  ASSERT_EQ(out.str().find("Trace::disabled"), std::string::npos);
+}
+
+TEST(Trace, exportsChromeJson) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  Trace::clear();
+  Trace::setEnabled(true);
+  { TraceSpan span("Trace::\"quoted\""); }
+  Trace::setEnabled(false);
+  std::ostringstream out;
+  Trace::writeChromeJson(out);
+  std::string json = out.str();
+  ASSERT_EQ(json.find("{\"traceEvents\":["), 0u);
+  ASSERT_NE(json.find("\"name\":\"Trace::\\\"quoted\\\"\""), std::string::npos);
+  ASSERT_NE(json.find("\"ph\":\"X\""), std::string::npos);
+}
+
+TEST(Trace, ringKeepsNewestEvents) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  Trace::clear();
+  for (std::size_t i = 0; i < Trace::EVENTS_PER_THREAD; i++) {
+    Trace::record("old", i, 1);
+  }
+  Trace::record("newest", Trace::EVENTS_PER_THREAD, 1);
+  std::ostringstream out;
+  Trace::writeChromeJson(out);
+  std::string json = out.str();
+  ASSERT_NE(json.find("\"newest\""), std::string::npos);
+  ASSERT_EQ(json.find("\"ts\":0.000,"), std::string::npos);
+  Trace::clear();
+}
@@ -0,0 +1,129 @@
+#include "gtest/gtest.h"
+#include "Account.hxx"
+#include "Bank.hxx"
+#include "TestObjectFactory.hxx"
+#include "TransactionQuery.hxx"
+
+#include <memory>
+
+
+static void fillQueryBank(Bank& bank) {
+  Account* a = bank.addAccount();
+  a->deposit(1000.0);
+  a->debit(600.0);
+  a->debit(50.0);
+  a->recordBalanceInquiry();
+  Account* b = bank.addAccount();
+  b->deposit(10.0);
+  Account* c = bank.addAccount();
+  c->debit(700.0);
+  c->debit(800.0);
+  c->deposit(5.0);
+}
+
+TEST(TransactionQuery, filterAndAggregate) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  Bank bank;
+  fillQueryBank(bank);
+  TransactionQuery query;
+  query.requestTypes = requestBit(UserRequest::REQUEST_WITHDRAW);
+  query.minAmount = 500.0;
+  query.groupByAccount = true;
+  query.topK = 2;
+
+  QueryResult result = runQuery(bank, query);
+
+  ASSERT_EQ(3u, result.accounts);
+  ASSERT_EQ(8u, result.entries);
+  ASSERT_EQ(3u, result.count);
+  ASSERT_EQ(2100.0, result.sum);
+  ASSERT_EQ(2u, result.groups.size());
+  ASSERT_EQ(0, result.groups[0].account);
+  ASSERT_EQ(1u, result.groups[0].count);
+  ASSERT_EQ(600.0, result.groups[0].sum);
+  ASSERT_EQ(2, result.groups[1].account);
+  ASSERT_EQ(1500.0, result.groups[1].sum);
+  ASSERT_EQ(2u, result.top.size());
+  ASSERT_EQ(800.0, result.top[0].amount);
+  ASSERT_EQ(2, result.top[0].account);
+  ASSERT_EQ(1u, result.top[0].entry);
+  ASSERT_EQ(700.0, result.top[1].amount);
+}
+
+TEST(TransactionQuery, lastEntriesOnly) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  Bank bank;
+  fillQueryBank(bank);
+  TransactionQuery query;
+  query.requestTypes = requestBit(UserRequest::REQUEST_WITHDRAW);
+  query.lastEntries = 2;
+
+  QueryResult result = runQuery(bank, query);
+
+  // Account 0: debit 50 (the inquiry is the other entry); account 2: debit 800
+  ASSERT_EQ(5u, result.entries);
+  ASSERT_EQ(2u, result.count);
+  ASSERT_EQ(850.0, result.sum);
+  ASSERT_TRUE(result.groups.empty());
+  ASSERT_TRUE(result.top.empty());
+}
+
+TEST(TransactionQuery, periodOnly) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  SyntheticBankSpec spec;
+  spec.accounts = 200;
+  std::unique_ptr<Bank> bank(TestObjectFactory::getInstance()->syntheticBank(spec));
+  TransactionQuery query;
+  query.period.from = spec.firstTime + static_cast<LedgerTime>(100 * spec.meanGap);
+  query.period.to = spec.firstTime + static_cast<LedgerTime>(300 * spec.meanGap);
+  query.topK = 10;
+
+  std::size_t inPeriod = 0;
+  for (int n = 0; n < bank->accountCount(); n++) {
+    TransactionView ledger = bank->accountAt(n)->transactions();
+    for (std::size_t i = 0; i < ledger.size(); i++) {
+      inPeriod += query.period.contains(ledger.time(i)) ? 1 : 0;
+    }
+  }
+
+  QueryResult result = runQuery(*bank, query);
+  ASSERT_GT(inPeriod, 0u);
+  ASSERT_EQ(inPeriod, result.entries);
+  ASSERT_EQ(10u, result.top.size());
+  for (const QueryMatch& match : result.top) {
+    TransactionView ledger = bank->accountAt(match.account)->transactions();
+    ASSERT_TRUE(query.period.contains(ledger.time(match.entry)));
+    ASSERT_EQ(match.amount, std::get<1>(ledger[match.entry]));
+  }
+}
+
+TEST(TransactionQuery, independentOfThreads) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  SyntheticBankSpec spec;
+  spec.accounts = 3000;
+  spec.maxLedgerLength = 2000;
+  std::unique_ptr<Bank> bank(TestObjectFactory::getInstance()->syntheticBank(spec));
+  TransactionQuery query;
+  query.minAmount = 100.0;
+  query.maxAmount = 2000.0;
+  query.groupByAccount = true;
+  query.topK = 50;
+
+  query.threads = 1;
+  QueryResult serial = runQuery(*bank, query);
+  query.threads = 4;
+  QueryResult parallel = runQuery(*bank, query);
+
+  ASSERT_GT(serial.count, 0u);
+  ASSERT_EQ(serial.count, parallel.count);
+  ASSERT_EQ(serial.sum, parallel.sum);
+  ASSERT_EQ(serial.groups.size(), parallel.groups.size());
+  ASSERT_EQ(50u, parallel.top.size());
+  for (std::size_t i = 0; i < serial.top.size(); i++) {
+    ASSERT_EQ(serial.top[i].account, parallel.top[i].account);
+    ASSERT_EQ(serial.top[i].entry, parallel.top[i].entry);
+    if (i > 0) {
+      ASSERT_GE(parallel.top[i - 1].amount, parallel.top[i].amount);
+    }
+  }
+}
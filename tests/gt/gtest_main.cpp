@@ -1,9 +1,32 @@
 
 #include "gtest/gtest.h"
 
+#define ATM_DEFINE_ALLOCATION_HOOKS
+#include "AllocationCounter.hpp"
+
+#include "ATMTest.hpp"
 #include "AccountTest.hpp"
+#include "AllocationTest.hpp"
+#include "AnomalyDetectorTest.hpp"
+#include "AsyncDisplayTest.hpp"
 #include "BankTest.hpp"
 #include "BaseDisplayTest.hpp"
+#include "BufferedDisplayTest.hpp"
+#include "BulkImportTest.hpp"
+#include "ColumnarExportTest.hpp"
+#include "EventSchedulerTest.hpp"
+#include "FormatTest.hpp"
+#include "InterestAccrualTest.hpp"
+#include "LatencyHistogramTest.hpp"
+#include "LedgerFeedTest.hpp"
+#include "LogShippingTest.hpp"
+#include "MemoryBudgetTest.hpp"
+#include "ReconciliationTest.hpp"
+#include "RequestTraceTest.hpp"
+#include "StatementEngineTest.hpp"
+#include "TestObjectFactoryTest.hpp"
+#include "TraceTest.hpp"
+#include "TransactionQueryTest.hpp"
 
 
 int main(int argc, char **argv) {
@@ -0,0 +1,174 @@
+#include "gtest/gtest.h"
+#include "ATM.hxx"
+#include "Account.hxx"
+#include "Bank.hxx"
+#include "NullDisplay.hxx"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Scale with ATM_STRESS_OPS (operations per thread) and ATM_STRESS_THREADS
+// (highest thread count; runs 1, 2, 4, ... up to it).
+static long stressEnv(const char* name, long fallback) {
+  const char* value = std::getenv(name);
+  return value ? std::atol(value) : fallback;
+}
+
+static std::string stressPassword(int accountNumber) {
+  return "pw" + std::to_string(accountNumber);
+}
+
+struct StressResult {
+  double seconds;
+  long operations;
+};
+
+// Every thread drives its own ATM against the shared bank and keeps the net
+// amount it moved into each account. Amounts are whole numbers so the sums
+// are exact and any lost update shows up as a mismatch.
+static StressResult runStressWorkload(Bank& bank, int accounts, int threads, long opsPerThread,
+                                      std::vector<std::vector<double>>& netPerThread) {
+  netPerThread.assign(threads, std::vector<double>(accounts, 0.0));
+  std::vector<std::thread> workers;
+
+  auto start = std::chrono::steady_clock::now();
+  for (int t = 0; t < threads; t++) {
+    workers.emplace_back([&bank, &netPerThread, accounts, opsPerThread, t]() {
+      std::mt19937 gen(static_cast<unsigned>(1000 + t));
+      std::uniform_int_distribution<int> pickAccount(0, accounts - 1);
+      std::uniform_int_distribution<int> pickOp(0, 99);
+      std::uniform_int_distribution<int> pickAmount(1, 100);
+      std::vector<double>& net = netPerThread[t];
+      std::vector<std::string> passwords;
+      for (int a = 0; a < accounts; a++) {
+        passwords.push_back(stressPassword(a));
+      }
+
+      NullDisplay display;
+      ATM atm(&bank, &display);
+      int current = pickAccount(gen);
+      atm.viewAccount(current, passwords[current]);
+
+      for (long i = 0; i < opsPerThread; i++) {
+        int op = pickOp(gen);
+        double amount = pickAmount(gen);
+        if (op < 15) {
+          current = pickAccount(gen);
+          atm.viewAccount(current, passwords[current]);
+        } else if (op < 45) {
+          atm.fillUserRequest(UserRequest::REQUEST_DEPOSIT, amount);
+          net[current] += amount;
+        } else if (op < 70) {
+          atm.fillUserRequest(UserRequest::REQUEST_WITHDRAW, amount);
+          net[current] -= amount;
+        } else if (op < 90) {
+          int to = pickAccount(gen);
+          if (bank.transfer(current, to, amount)) {
+            net[current] -= amount;
+            net[to] += amount;
+          }
+        } else {
+          atm.fillUserRequest(UserRequest::REQUEST_BALANCE, 0.0);
+        }
+      }
+    });
+  }
+  for (std::thread& worker : workers) {
+    worker.join();
+  }
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  return StressResult{elapsed.count(), opsPerThread * threads};
+}
+
+static Bank* stressBank(int accounts) {
+  Bank* bank = new Bank;
+  for (int a = 0; a < accounts; a++) {
+    bank->addAccount()->setPassword(stressPassword(a).c_str());
+  }
+  return bank;
+}
+
+// Deposits minus withdrawals over the ledger; balance inquiries do not post
+static double ledgerNet(Account& account) {
+  double sum = 0.0;
+  account.forEachTransaction([&sum](const Transaction& entry) {
+    if (std::get<0>(entry) == UserRequest::REQUEST_DEPOSIT) {
+      sum += std::get<1>(entry);
+    } else if (std::get<0>(entry) == UserRequest::REQUEST_WITHDRAW) {
+      sum -= std::get<1>(entry);
+    }
+  });
+  return sum;
+}
+
+TEST(BankStress, mixedWorkloadKeepsInvariants) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  const int accounts = 64;
+  const long opsPerThread = stressEnv("ATM_STRESS_OPS", 50000);
+  const long maxThreads = stressEnv("ATM_STRESS_THREADS", 8);
+
+  std::printf("%8s %12s %14s %16s\n", "threads", "ops", "ops/s", "ops/s/thread");
+  for (int threads = 1; threads <= maxThreads; threads *= 2) {
+    std::unique_ptr<Bank> bank(stressBank(accounts));
+    std::vector<std::vector<double>> netPerThread;
+    StressResult result = runStressWorkload(*bank, accounts, threads, opsPerThread, netPerThread);
+
+    double opsPerSecond = result.operations / result.seconds;
+    std::printf("%8d %12ld %14.0f %16.0f\n", threads, result.operations, opsPerSecond, opsPerSecond / threads);
+    ::testing::Test::RecordProperty("ops_per_second_" + std::to_string(threads) + "_threads",
+                                    std::to_string(static_cast<long>(opsPerSecond)));
+
+    double bankTotal = 0.0;
+    double expectedTotal = 0.0;
+    for (int a = 0; a < accounts; a++) {
+      double expected = 0.0;
+      for (const std::vector<double>& net : netPerThread) {
+        expected += net[a];
+      }
+      Account* account = bank->getAccount(a, stressPassword(a));
+      ASSERT_NE(account, nullptr);
+      // No lost updates: every posting any thread made is in the balance
+      ASSERT_EQ(account->getBalance(), expected) << "account " << a << ", " << threads << " threads";
+      // The ledger explains the balance
+      ASSERT_EQ(ledgerNet(*account), account->getBalance()) << "account " << a;
+      bankTotal += account->getBalance();
+      expectedTotal += expected;
+    }
+    ASSERT_EQ(bankTotal, expectedTotal);
+  }
+}
+
+TEST(BankStress, concurrentAccountCreationAndLookup) {
+  ::testing::Test::RecordProperty("cpptest_filename", __FILE__);
+  const int perThread = static_cast<int>(stressEnv("ATM_STRESS_OPS", 50000) / 10);
+  const int threads = 4;
+  Bank bank;
+  std::vector<std::thread> workers;
+  std::vector<int> misses(threads, 0);
+  for (int t = 0; t < threads; t++) {
+    workers.emplace_back([&bank, &misses, perThread, t]() {
+      for (int i = 0; i < perThread; i++) {
+        Account* account = bank.addAccount();
+        int number = account->getAccountNumber();
+        if (bank.getAccount(number, "") != account) {
+          misses[t]++;
+        }
+      }
+    });
+  }
+  for (std::thread& worker : workers) {
+    worker.join();
+  }
+  ASSERT_EQ(bank.accountCount(), perThread * threads);
+  for (int t = 0; t < threads; t++) {
+    ASSERT_EQ(misses[t], 0);
+  }
+  for (int n = 0; n < bank.accountCount(); n++) {
+    ASSERT_EQ(bank.getAccount(n, "")->getAccountNumber(), n);
+  }
+}
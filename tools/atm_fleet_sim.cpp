@@ -0,0 +1,522 @@
+// Discrete-event simulation of an ATM fleet sharing one Bank.
+//
+//   atm_fleet_sim [--terminals N] [--accounts N] [--shards N] [--cores N]
+//                 [--seconds S] [--arrivals-per-hour R] [--think-ms T]
+//                 [--requests-per-session K] [--seed S]
+//                 [--sla-p99-us U [--sweep-to N]]
+//
+// Every terminal is a real ATM over the shared bank, so each simulated call
+// also runs against the library. Time, though, is virtual: customers arrive
+// at each terminal as a Poisson process, log in to a Zipf-chosen account and
+// issue a geometric number of requests separated by exponential think
+// times. A call holds one of --cores servers for a modeled service time,
+// and deposits and withdrawals also hold their account's shard (account
+// number modulo --shards) exclusively, which is where hot accounts queue.
+//
+// With --sla-p99-us and --sweep-to the run is repeated with the terminal
+// count doubling until the p99 response time breaks the SLA.
+
+#include "ATM.hxx"
+#include "Bank.hxx"
+#include "EventScheduler.hxx"
+#include "LatencyHistogram.hxx"
+#include "NullDisplay.hxx"
+#include "SyntheticData.hxx"
+#include "TestObjectFactory.hxx"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+using SimATM = BasicATM<StaticDisplayPolicy<NullDisplay>>;
+using Time = EventScheduler<int>::Time;
+
+namespace
+{
+    const double NS_PER_US = 1e3;
+    const double NS_PER_MS = 1e6;
+    const double NS_PER_S = 1e9;
+
+    struct Config
+    {
+        int terminals = 1000;
+        int accounts = 100000;
+        int shards = 64;
+        unsigned cores = 8;
+        double seconds = 600.0;
+        double arrivalsPerHour = 20.0;
+        double thinkMs = 3000.0;
+        double requestsPerSession = 3.0;
+        std::uint64_t seed = 1;
+        double slaP99Us = 0.0;
+        int sweepTo = 0;
+
+        // Modeled service time per call, indexed by LatencyKind
+        double serviceUs[static_cast<int>(LatencyKind::KIND_COUNT)] = {50, 5, 20, 60, 60, 150};
+    };
+
+    int usage()
+    {
+        std::fprintf(stderr,
+            "usage: atm_fleet_sim [--terminals N] [--accounts N] [--shards N] [--cores N]\n"
+            "                     [--seconds S] [--arrivals-per-hour R] [--think-ms T]\n"
+            "                     [--requests-per-session K] [--seed S]\n"
+            "                     [--sla-p99-us U [--sweep-to N]]\n");
+        return (2);
+    }
+
+    bool parseOptions(int argc, char** argv, Config& config)
+    {
+        for (int i = 1; i < argc; i += 2)
+        {
+            if (i + 1 >= argc)
+            {
+                return (false);
+            }
+            std::string arg = argv[i];
+            const char* value = argv[i + 1];
+            if (arg == "--terminals") config.terminals = std::atoi(value);
+            else if (arg == "--accounts") config.accounts = std::atoi(value);
+            else if (arg == "--shards") config.shards = std::atoi(value);
+            else if (arg == "--cores") config.cores = static_cast<unsigned>(std::atoi(value));
+            else if (arg == "--seconds") config.seconds = std::atof(value);
+            else if (arg == "--arrivals-per-hour") config.arrivalsPerHour = std::atof(value);
+            else if (arg == "--think-ms") config.thinkMs = std::atof(value);
+            else if (arg == "--requests-per-session") config.requestsPerSession = std::atof(value);
+            else if (arg == "--seed") config.seed = std::strtoull(value, nullptr, 10);
+            else if (arg == "--sla-p99-us") config.slaP99Us = std::atof(value);
+            else if (arg == "--sweep-to") config.sweepTo = std::atoi(value);
+            else return (false);
+        }
+        return ((config.terminals > 0) && (config.accounts > 0) && (config.shards > 0) && (config.cores > 0));
+    }
+
+    enum class EventType : std::uint8_t { CUSTOMER_ARRIVES, ISSUE_CALL, CALL_DONE };
+
+    struct SimEvent
+    {
+        EventType type;
+        std::uint32_t terminal;
+    };
+
+    struct Call
+    {
+        LatencyKind kind = LatencyKind::VIEW_ACCOUNT;
+        UserRequest request = UserRequest::REQUEST_INVALID;
+        double amount = 0.0;
+        int shard = -1;           // held exclusively when >= 0
+        Time issued = 0;
+    };
+
+    struct Terminal
+    {
+        explicit Terminal(std::uint64_t seed) : rng(seed) {}
+
+        std::unique_ptr<SimATM> atm;
+        SplitMix64 rng;
+        bool busy = false;
+        std::uint32_t waiting = 0;
+        int account = 0;
+        int remaining = 0;
+        Call call;
+    };
+
+    struct Shard
+    {
+        Shard() : wait(new LatencyHistogram) {}
+
+        bool busy = false;
+        Time grantedAt = 0;
+        Time busyTime = 0;
+        std::deque<std::uint32_t> queue;
+        std::size_t maxQueue = 0;
+        std::uint64_t writes = 0;
+        std::unique_ptr<LatencyHistogram> wait;
+    };
+
+    struct Result
+    {
+        Result() :
+            response(new LatencyHistogram[static_cast<int>(LatencyKind::KIND_COUNT)]),
+            all(new LatencyHistogram)
+        {
+        }
+
+        std::uint64_t calls = 0;
+        std::uint64_t sessions = 0;
+        Time simulated = 0;
+        double realSeconds = 0.0;
+        double coreUtilization = 0.0;
+        std::uint32_t maxTerminalQueue = 0;
+        std::unique_ptr<LatencyHistogram[]> response;
+        std::unique_ptr<LatencyHistogram> all;
+        std::vector<Shard> shards;
+    };
+
+    double exponential(SplitMix64& rng, double mean)
+    {
+        return (-std::log(1.0 - rng.uniform()) * mean);
+    }
+
+    class FleetSimulation
+    {
+        public:
+
+            FleetSimulation(const Config& config, Bank& bank, Result& result) :
+                myConfig(config),
+                myBank(bank),
+                myResult(result),
+                myPickAccount(static_cast<std::uint64_t>(config.accounts), 1.1),
+                myFreeCores(config.cores)
+            {
+                myResult.shards.resize(static_cast<std::size_t>(config.shards));
+                SplitMix64 seeds(config.seed);
+                for (int t = 0; t < config.terminals; t++)
+                {
+                    myTerminals.emplace_back(seeds());
+                    myTerminals.back().atm.reset(new SimATM(&myBank, &myDisplay));
+                }
+            }
+
+            void run()
+            {
+                auto realStart = std::chrono::steady_clock::now();
+                myEnd = static_cast<Time>(myConfig.seconds * NS_PER_S);
+                for (std::uint32_t t = 0; t < myTerminals.size(); t++)
+                {
+                    scheduleArrival(t);
+                }
+
+                SimEvent event;
+                while (myScheduler.next(event))
+                {
+                    switch (event.type)
+                    {
+                        case EventType::CUSTOMER_ARRIVES:
+                            customerArrives(event.terminal); break;
+                        case EventType::ISSUE_CALL:
+                            issueCall(event.terminal); break;
+                        case EventType::CALL_DONE:
+                            callDone(event.terminal); break;
+                    }
+                }
+
+                myResult.simulated = myScheduler.now();
+                myResult.coreUtilization = (myResult.simulated == 0) ? 0.0 :
+                    static_cast<double>(myCoreBusyTime) / (static_cast<double>(myResult.simulated) * myConfig.cores);
+                myResult.realSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - realStart).count();
+            }
+
+        private:
+
+            void scheduleArrival(std::uint32_t t)
+            {
+                Time at = myScheduler.now() + static_cast<Time>(
+                    exponential(myTerminals[t].rng, 3600.0 * NS_PER_S / myConfig.arrivalsPerHour));
+                if (at < myEnd)
+                {
+                    myScheduler.schedule(at, SimEvent{EventType::CUSTOMER_ARRIVES, t});
+                }
+            }
+
+            void customerArrives(std::uint32_t t)
+            {
+                Terminal& terminal = myTerminals[t];
+                scheduleArrival(t);
+                if (terminal.busy)
+                {
+                    myResult.maxTerminalQueue = std::max(myResult.maxTerminalQueue, ++terminal.waiting);
+                    return;
+                }
+                startSession(t);
+            }
+
+            void startSession(std::uint32_t t)
+            {
+                Terminal& terminal = myTerminals[t];
+                terminal.busy = true;
+                terminal.account = static_cast<int>(myPickAccount(terminal.rng) - 1);
+                // Geometric with the configured mean, at least one request
+                double p = 1.0 / std::max(1.0, myConfig.requestsPerSession);
+                terminal.remaining = 1 + static_cast<int>(std::log(1.0 - terminal.rng.uniform()) / std::log(1.0 - std::min(p, 0.999999)));
+                terminal.call = Call();
+                terminal.call.kind = LatencyKind::VIEW_ACCOUNT;
+                myResult.sessions++;
+                issueCall(t);
+            }
+
+            void nextRequest(Terminal& terminal)
+            {
+                double pick = terminal.rng.uniform();
+                terminal.call = Call();
+                terminal.call.request = (pick < 0.45) ? UserRequest::REQUEST_BALANCE
+                                      : (pick < 0.75) ? UserRequest::REQUEST_WITHDRAW
+                                      : (pick < 0.90) ? UserRequest::REQUEST_DEPOSIT
+                                      : UserRequest::REQUEST_TRANSACTIONS;
+                terminal.call.kind = latencyKindFor(terminal.call.request);
+                terminal.call.amount = std::floor(terminal.rng.uniform() * 20000.0) / 100.0;
+                terminal.remaining--;
+            }
+
+            void issueCall(std::uint32_t t)
+            {
+                Terminal& terminal = myTerminals[t];
+                Call& call = terminal.call;
+                call.issued = myScheduler.now();
+                bool writes = (call.request == UserRequest::REQUEST_DEPOSIT) || (call.request == UserRequest::REQUEST_WITHDRAW);
+                if (!writes)
+                {
+                    requestCore(t);
+                    return;
+                }
+
+                call.shard = terminal.account % myConfig.shards;
+                Shard& shard = myResult.shards[call.shard];
+                shard.writes++;
+                if (shard.busy)
+                {
+                    shard.queue.push_back(t);
+                    shard.maxQueue = std::max(shard.maxQueue, shard.queue.size());
+                    return;
+                }
+                grantShard(shard, t);
+            }
+
+            void grantShard(Shard& shard, std::uint32_t t)
+            {
+                shard.busy = true;
+                shard.grantedAt = myScheduler.now();
+                shard.wait->record(myScheduler.now() - myTerminals[t].call.issued);
+                requestCore(t);
+            }
+
+            void requestCore(std::uint32_t t)
+            {
+                if (myFreeCores == 0)
+                {
+                    myCoreQueue.push_back(t);
+                    return;
+                }
+                myFreeCores--;
+                startService(t);
+            }
+
+            void startService(std::uint32_t t)
+            {
+                Terminal& terminal = myTerminals[t];
+                double mean = myConfig.serviceUs[static_cast<int>(terminal.call.kind)] * NS_PER_US;
+                Time service = static_cast<Time>(mean * (0.75 + 0.5 * terminal.rng.uniform()));
+                myCoreBusyTime += service;
+                myScheduler.scheduleAfter(service, SimEvent{EventType::CALL_DONE, t});
+            }
+
+            void callDone(std::uint32_t t)
+            {
+                Terminal& terminal = myTerminals[t];
+                Call& call = terminal.call;
+
+                // The simulated call also runs against the library
+                if (call.kind == LatencyKind::VIEW_ACCOUNT)
+                {
+                    terminal.atm->viewAccount(terminal.account, TestObjectFactory::passwordFor(terminal.account));
+                }
+                else
+                {
+                    terminal.atm->fillUserRequest(call.request, call.amount);
+                }
+
+                Time response = myScheduler.now() - call.issued;
+                myResult.response[static_cast<int>(call.kind)].record(response);
+                myResult.all->record(response);
+                myResult.calls++;
+
+                if (myCoreQueue.empty())
+                {
+                    myFreeCores++;
+                }
+                else
+                {
+                    std::uint32_t next = myCoreQueue.front();
+                    myCoreQueue.pop_front();
+                    startService(next);
+                }
+
+                if (call.shard >= 0)
+                {
+                    Shard& shard = myResult.shards[call.shard];
+                    shard.busyTime += myScheduler.now() - shard.grantedAt;
+                    shard.busy = false;
+                    if (!shard.queue.empty())
+                    {
+                        std::uint32_t next = shard.queue.front();
+                        shard.queue.pop_front();
+                        grantShard(shard, next);
+                    }
+                }
+
+                if (terminal.remaining > 0)
+                {
+                    nextRequest(terminal);
+                    myScheduler.scheduleAfter(static_cast<Time>(exponential(terminal.rng, myConfig.thinkMs * NS_PER_MS)),
+                        SimEvent{EventType::ISSUE_CALL, t});
+                }
+                else if (terminal.waiting > 0)
+                {
+                    terminal.waiting--;
+                    startSession(t);
+                }
+                else
+                {
+                    terminal.busy = false;
+                }
+            }
+
+            const Config& myConfig;
+            Bank& myBank;
+            Result& myResult;
+            NullDisplay myDisplay;
+            ZipfDistribution myPickAccount;
+            EventScheduler<SimEvent> myScheduler;
+            std::vector<Terminal> myTerminals;
+            unsigned myFreeCores;
+            std::deque<std::uint32_t> myCoreQueue;
+            Time myCoreBusyTime = 0;
+            Time myEnd = 0;
+    };
+
+    void printRow(const char* name, const LatencyHistogram& histogram)
+    {
+        std::printf("  %-22s %10llu %10.1f %10.1f %10.1f %10.1f\n", name,
+            static_cast<unsigned long long>(histogram.count()),
+            histogram.valueAtPercentile(50.0) / NS_PER_US,
+            histogram.valueAtPercentile(99.0) / NS_PER_US,
+            histogram.valueAtPercentile(99.9) / NS_PER_US,
+            histogram.max() / NS_PER_US);
+    }
+
+    void printReport(const Config& config, const Result& result)
+    {
+        const double simSeconds = result.simulated / NS_PER_S;
+        std::printf("%d terminals, %u cores, %d shards: %llu calls in %llu sessions over %.0f s virtual "
+            "(%.2f s real, %.0fx)\n", config.terminals, config.cores, config.shards,
+            static_cast<unsigned long long>(result.calls), static_cast<unsigned long long>(result.sessions),
+            simSeconds, result.realSeconds, simSeconds / std::max(result.realSeconds, 1e-9));
+        std::printf("throughput %.1f calls/s, core utilization %.1f%%, longest terminal queue %u\n\n",
+            result.calls / std::max(simSeconds, 1e-9), 100.0 * result.coreUtilization, result.maxTerminalQueue);
+
+        std::printf("response time (us)\n  %-22s %10s %10s %10s %10s %10s\n",
+            "request", "count", "p50", "p99", "p99.9", "max");
+        for (int k = 0; k < static_cast<int>(LatencyKind::KIND_COUNT); k++)
+        {
+            if (result.response[k].count() != 0)
+            {
+                printRow(LatencyStats::kindName(static_cast<LatencyKind>(k)), result.response[k]);
+            }
+        }
+        printRow("all", *result.all);
+
+        // Busiest shards first; the rest are summarized
+        std::vector<int> order(result.shards.size());
+        for (std::size_t s = 0; s < order.size(); s++)
+        {
+            order[s] = static_cast<int>(s);
+        }
+        std::sort(order.begin(), order.end(), [&result](int a, int b)
+        {
+            return (result.shards[a].busyTime > result.shards[b].busyTime);
+        });
+
+        const std::size_t shown = std::min<std::size_t>(order.size(), 10);
+        std::printf("\nshard contention, %zu busiest of %zu (wait in us)\n  %-6s %10s %8s %10s %10s %10s %9s\n",
+            shown, order.size(), "shard", "writes", "util%", "wait p50", "wait p99", "wait max", "max queue");
+        for (std::size_t i = 0; i < shown; i++)
+        {
+            const Shard& shard = result.shards[order[i]];
+            std::printf("  %-6d %10llu %8.2f %10.1f %10.1f %10.1f %9zu\n", order[i],
+                static_cast<unsigned long long>(shard.writes),
+                100.0 * shard.busyTime / std::max<double>(result.simulated, 1.0),
+                shard.wait->valueAtPercentile(50.0) / NS_PER_US,
+                shard.wait->valueAtPercentile(99.0) / NS_PER_US,
+                shard.wait->max() / NS_PER_US,
+                shard.maxQueue);
+        }
+    }
+
+    std::unique_ptr<Result> simulate(const Config& config)
+    {
+        SyntheticBankSpec spec;
+        spec.accounts = config.accounts;
+        spec.seed = config.seed;
+        spec.maxLedgerLength = 16;
+        std::unique_ptr<Bank> bank(TestObjectFactory::getInstance()->syntheticBank(spec));
+
+        std::unique_ptr<Result> result(new Result);
+        FleetSimulation(config, *bank, *result).run();
+        return (result);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    Config config;
+    if (!parseOptions(argc, argv, config))
+    {
+        return (usage());
+    }
+
+    if ((config.slaP99Us <= 0.0) || (config.sweepTo <= config.terminals))
+    {
+        std::unique_ptr<Result> result = simulate(config);
+        printReport(config, *result);
+        if (config.slaP99Us > 0.0)
+        {
+            bool met = result->all->valueAtPercentile(99.0) <= config.slaP99Us * NS_PER_US;
+            std::printf("\np99 SLA of %.0f us %s\n", config.slaP99Us, met ? "met" : "BROKEN");
+            return (met ? 0 : 1);
+        }
+        return (0);
+    }
+
+    // Capacity sweep: double the fleet until p99 breaks the SLA
+    std::printf("%10s %12s %8s %10s %10s %12s\n", "terminals", "calls/s", "core%", "p50 us", "p99 us", "hot shard%");
+    Config step = config;
+    std::unique_ptr<Result> broken;
+    int lastGood = 0;
+    for (; step.terminals <= config.sweepTo; step.terminals *= 2)
+    {
+        std::unique_ptr<Result> result = simulate(step);
+        double hottest = 0.0;
+        for (const Shard& shard : result->shards)
+        {
+            hottest = std::max(hottest, 100.0 * shard.busyTime / std::max<double>(result->simulated, 1.0));
+        }
+        double p99 = result->all->valueAtPercentile(99.0) / NS_PER_US;
+        std::printf("%10d %12.1f %8.1f %10.1f %10.1f %12.2f\n", step.terminals,
+            result->calls / std::max(result->simulated / NS_PER_S, 1e-9), 100.0 * result->coreUtilization,
+            result->all->valueAtPercentile(50.0) / NS_PER_US, p99, hottest);
+        if (p99 > config.slaP99Us)
+        {
+            broken = std::move(result);
+            break;
+        }
+        lastGood = step.terminals;
+    }
+
+    if (broken)
+    {
+        std::printf("\np99 SLA of %.0f us holds up to %d terminals; breakdown at %d:\n\n",
+            config.slaP99Us, lastGood, step.terminals);
+        printReport(step, *broken);
+    }
+    else
+    {
+        std::printf("\np99 SLA of %.0f us holds up to %d terminals\n", config.slaP99Us, lastGood);
+    }
+    return (0);
+}
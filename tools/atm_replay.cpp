@@ -0,0 +1,334 @@
+// Records and replays ATM request traces.
+//
+//   atm_replay record <trace> [--accounts N] [--sessions N] [--requests N] [--seed S]
+//       Drives a synthetic bank through ATM with a recorder attached.
+//   atm_replay replay <trace> [--threads N] [--flat | --rate R | --speed X]
+//                             [--accounts N | --bank FILE]
+//       Replays a trace against a bank, sessions spread across threads, and
+//       reports throughput and latency per request type.
+//
+// Replay is open loop by default: every call is issued at the time it was
+// recorded (scaled by --speed), or at a fixed aggregate rate with --rate,
+// and latency is measured from that intended time, so queueing behind a
+// slow call is counted. --flat issues calls back to back and reports
+// service time only. Output goes to NullDisplay so display cost does not
+// skew the numbers.
+
+#include "ATM.hxx"
+#include "Account.hxx"
+#include "Bank.hxx"
+#include "LatencyHistogram.hxx"
+#include "NullDisplay.hxx"
+#include "ParallelFor.hxx"
+#include "RequestTrace.hxx"
+#include "SyntheticData.hxx"
+#include "TestObjectFactory.hxx"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using ReplayATM = BasicATM<StaticDisplayPolicy<NullDisplay>>;
+using Clock = std::chrono::steady_clock;
+
+namespace
+{
+    struct Options
+    {
+        std::string mode;
+        std::string trace;
+        std::string bank;
+        int accounts = 0;
+        int sessions = 1000;
+        int requests = 8;
+        std::uint64_t seed = 1;
+        unsigned threads = 0;
+        bool flat = false;
+        double rate = 0.0;
+        double speed = 1.0;
+    };
+
+    int usage()
+    {
+        std::fprintf(stderr,
+            "usage: atm_replay record <trace> [--accounts N] [--sessions N] [--requests N] [--seed S]\n"
+            "       atm_replay replay <trace> [--threads N] [--flat | --rate R | --speed X]\n"
+            "                                 [--accounts N | --bank FILE]\n");
+        return (2);
+    }
+
+    bool parseOptions(int argc, char** argv, Options& options)
+    {
+        if (argc < 3)
+        {
+            return (false);
+        }
+        options.mode = argv[1];
+        options.trace = argv[2];
+        for (int i = 3; i < argc; i++)
+        {
+            std::string arg = argv[i];
+            const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+            if (arg == "--flat")
+            {
+                options.flat = true;
+                continue;
+            }
+            if (!value)
+            {
+                return (false);
+            }
+            i++;
+            if (arg == "--accounts") options.accounts = std::atoi(value);
+            else if (arg == "--sessions") options.sessions = std::atoi(value);
+            else if (arg == "--requests") options.requests = std::atoi(value);
+            else if (arg == "--seed") options.seed = std::strtoull(value, nullptr, 10);
+            else if (arg == "--threads") options.threads = static_cast<unsigned>(std::atoi(value));
+            else if (arg == "--rate") options.rate = std::atof(value);
+            else if (arg == "--speed") options.speed = std::atof(value);
+            else if (arg == "--bank") options.bank = value;
+            else return (false);
+        }
+        return ((options.mode == "record") || (options.mode == "replay"));
+    }
+
+    // Replay signs in with the password the bank holds, so it runs against
+    // a saved bank as well as a synthetic one. Nothing changes passwords
+    // while a replay runs, so the unsynchronized read is safe.
+    std::string passwordOf(Bank& bank, int account)
+    {
+        Account* target = bank.accountAt(account);
+        return (target ? std::string(target->getPassword()) : std::string());
+    }
+
+    // Sessions log in to a Zipf-chosen account, then issue a mix of requests
+    int record(const Options& options)
+    {
+        SyntheticBankSpec spec;
+        spec.accounts = (options.accounts > 0) ? options.accounts : 10000;
+        spec.seed = options.seed;
+        spec.maxLedgerLength = 64;
+        std::unique_ptr<Bank> bank(TestObjectFactory::getInstance()->syntheticBank(spec));
+
+        RequestTraceWriter writer(options.trace);
+        if (!writer.good())
+        {
+            std::fprintf(stderr, "cannot write %s\n", options.trace.c_str());
+            return (1);
+        }
+
+        NullDisplay display;
+        SplitMix64 rng(options.seed);
+        ZipfDistribution pickAccount(static_cast<std::uint64_t>(spec.accounts), 1.1);
+        for (int s = 0; s < options.sessions; s++)
+        {
+            ReplayATM atm(bank.get(), &display);
+            atm.setRecorder(&writer);
+            int account = static_cast<int>(pickAccount(rng) - 1);
+            atm.viewAccount(account, TestObjectFactory::passwordFor(account));
+            for (int r = 0; r < options.requests; r++)
+            {
+                double pick = rng.uniform();
+                double amount = std::floor(rng.uniform() * 50000.0) / 100.0;
+                UserRequest request = (pick < 0.45) ? UserRequest::REQUEST_BALANCE
+                                    : (pick < 0.70) ? UserRequest::REQUEST_WITHDRAW
+                                    : (pick < 0.90) ? UserRequest::REQUEST_DEPOSIT
+                                    : UserRequest::REQUEST_TRANSACTIONS;
+                atm.fillUserRequest(request, amount);
+            }
+        }
+
+        std::uint64_t count = writer.recordCount();
+        if (!writer.close())
+        {
+            std::fprintf(stderr, "error writing %s\n", options.trace.c_str());
+            return (1);
+        }
+        std::printf("recorded %llu calls in %d sessions to %s\n",
+            static_cast<unsigned long long>(count), options.sessions, options.trace.c_str());
+        return (0);
+    }
+
+    LatencyKind kindOf(const RequestTraceRecord& record)
+    {
+        return ((record.kind == RequestTraceRecord::Kind::VIEW_ACCOUNT)
+            ? LatencyKind::VIEW_ACCOUNT : latencyKindFor(record.request));
+    }
+
+    struct WorkerStats
+    {
+        WorkerStats() :
+            response(new LatencyHistogram[static_cast<int>(LatencyKind::KIND_COUNT)]),
+            service(new LatencyHistogram[static_cast<int>(LatencyKind::KIND_COUNT)])
+        {
+        }
+
+        std::unique_ptr<LatencyHistogram[]> response;
+        std::unique_ptr<LatencyHistogram[]> service;
+    };
+
+    std::uint64_t nanosecondsBetween(Clock::time_point from, Clock::time_point to)
+    {
+        return (static_cast<std::uint64_t>(std::max<std::int64_t>(0,
+            std::chrono::duration_cast<std::chrono::nanoseconds>(to - from).count())));
+    }
+
+    void printRow(const char* name, const LatencyHistogram& histogram)
+    {
+        std::printf("  %-22s %10llu %10.1f %10.1f %10.1f %10.1f\n", name,
+            static_cast<unsigned long long>(histogram.count()),
+            histogram.valueAtPercentile(50.0) / 1000.0,
+            histogram.valueAtPercentile(99.0) / 1000.0,
+            histogram.valueAtPercentile(99.9) / 1000.0,
+            histogram.max() / 1000.0);
+    }
+
+    void printTable(const char* title, const std::vector<WorkerStats>& workers,
+        std::unique_ptr<LatencyHistogram[]> WorkerStats::* which)
+    {
+        std::printf("%s (us)\n  %-22s %10s %10s %10s %10s %10s\n",
+            title, "request", "count", "p50", "p99", "p99.9", "max");
+        LatencyHistogram total;
+        for (int k = 0; k < static_cast<int>(LatencyKind::KIND_COUNT); k++)
+        {
+            LatencyHistogram merged;
+            for (const WorkerStats& worker : workers)
+            {
+                merged.merge((worker.*which)[k]);
+            }
+            if (merged.count() != 0)
+            {
+                printRow(LatencyStats::kindName(static_cast<LatencyKind>(k)), merged);
+                total.merge(merged);
+            }
+        }
+        printRow("all", total);
+    }
+
+    int replay(const Options& options)
+    {
+        std::vector<RequestTraceRecord> records;
+        if (!loadRequestTrace(options.trace, records))
+        {
+            std::fprintf(stderr, "cannot read trace %s\n", options.trace.c_str());
+            return (1);
+        }
+
+        std::unique_ptr<Bank> bank;
+        if (!options.bank.empty())
+        {
+            bank.reset(TestObjectFactory::getInstance()->loadBank(options.bank));
+            if (!bank)
+            {
+                std::fprintf(stderr, "cannot load bank %s\n", options.bank.c_str());
+                return (1);
+            }
+        }
+        else
+        {
+            int highest = 0;
+            for (const RequestTraceRecord& record : records)
+            {
+                highest = std::max(highest, record.account);
+            }
+            SyntheticBankSpec spec;
+            spec.accounts = std::max(options.accounts, highest + 1);
+            spec.maxLedgerLength = 64;
+            bank.reset(TestObjectFactory::getInstance()->syntheticBank(spec));
+        }
+
+        // Intended issue time of each call, relative to the start of replay
+        std::vector<std::uint64_t> due(records.size(), 0);
+        for (std::size_t i = 0; i < records.size(); i++)
+        {
+            if (options.rate > 0.0)
+            {
+                due[i] = static_cast<std::uint64_t>(i * 1e9 / options.rate);
+            }
+            else if (options.speed > 0.0)
+            {
+                due[i] = static_cast<std::uint64_t>(records[i].offset / options.speed);
+            }
+        }
+
+        // Sessions stay on one thread so each replays in recorded order
+        const unsigned threads = (options.threads > 0) ? options.threads : defaultThreadCount();
+        std::vector<std::vector<std::size_t>> perThread(threads);
+        for (std::size_t i = 0; i < records.size(); i++)
+        {
+            perThread[records[i].session % threads].push_back(i);
+        }
+
+        std::vector<WorkerStats> stats(threads);
+        const Clock::time_point start = Clock::now() + std::chrono::milliseconds(10);
+
+        parallelForRanges(threads, threads, [&](unsigned, std::size_t begin, std::size_t end)
+        {
+            NullDisplay display;
+            std::unordered_map<std::uint32_t, std::unique_ptr<ReplayATM>> sessions;
+            for (std::size_t t = begin; t < end; t++)
+            {
+                WorkerStats& worker = stats[t];
+                for (std::size_t i : perThread[t])
+                {
+                    const RequestTraceRecord& record = records[i];
+                    std::unique_ptr<ReplayATM>& atm = sessions[record.session];
+                    if (!atm)
+                    {
+                        atm.reset(new ReplayATM(bank.get(), &display));
+                    }
+
+                    Clock::time_point intended = start + std::chrono::nanoseconds(due[i]);
+                    if (!options.flat)
+                    {
+                        std::this_thread::sleep_until(intended);
+                    }
+
+                    Clock::time_point issued = Clock::now();
+                    if (record.kind == RequestTraceRecord::Kind::VIEW_ACCOUNT)
+                    {
+                        atm->viewAccount(record.account, passwordOf(*bank, record.account));
+                    }
+                    else
+                    {
+                        atm->fillUserRequest(record.request, record.amount);
+                    }
+                    Clock::time_point done = Clock::now();
+
+                    int kind = static_cast<int>(kindOf(record));
+                    worker.service[kind].record(nanosecondsBetween(issued, done));
+                    worker.response[kind].record(nanosecondsBetween(options.flat ? issued : intended, done));
+                }
+            }
+        });
+
+        const double seconds = nanosecondsBetween(start, Clock::now()) / 1e9;
+        std::printf("replayed %zu calls on %u threads in %.3f s: %.0f calls/s (%s)\n",
+            records.size(), threads, seconds, records.size() / seconds,
+            options.flat ? "flat out" : (options.rate > 0.0) ? "fixed rate" : "recorded timing");
+        if (!options.flat)
+        {
+            printTable("response time from intended start", stats, &WorkerStats::response);
+        }
+        printTable("service time", stats, &WorkerStats::service);
+        return (0);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if (!parseOptions(argc, argv, options))
+    {
+        return (usage());
+    }
+    return ((options.mode == "record") ? record(options) : replay(options));
+}